@@ -1148,6 +1148,32 @@ int Cs2GetTimeToNextSector(void) {
 
 //////////////////////////////////////////////////////////////////////////////
 
+/*!
+ * Returns the number of (emulated) microseconds before Cs2Exec has work to do:
+ * a pending command, the status check or the periodic response
+ * \return microseconds
+ */
+u32 Cs2GetTimeToNextEvent(void) {
+   u32 time;
+
+   if (Cs2Area->_periodiccycles >= Cs2Area->_periodictiming)
+      return 0;
+   time = (Cs2Area->_periodictiming - Cs2Area->_periodiccycles + 2) / 3;
+
+   if (Cs2Area->_statuscycles >= Cs2Area->_statustiming)
+      return 0;
+   if ((Cs2Area->_statustiming - Cs2Area->_statuscycles + 2) / 3 < time)
+      time = (Cs2Area->_statustiming - Cs2Area->_statuscycles + 2) / 3;
+
+   // Commands run once more than _commandtiming microseconds have passed
+   if (Cs2Area->_commandtiming > 0 && Cs2Area->_commandtiming + 1 < time)
+      time = Cs2Area->_commandtiming + 1;
+
+   return time;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 /*!
  * Sets the timing for periodic response(when the cd block regularly sends cd status data)
  * @param[in]  playing Whether CD is playing
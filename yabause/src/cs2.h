@@ -277,6 +277,7 @@ void FASTCALL   Cs2RapidCopyT2(void *dest, u32 count);
 
 void Cs2Exec(u32);
 int Cs2GetTimeToNextSector(void);
+u32 Cs2GetTimeToNextEvent(void);
 void Cs2Execute(void);
 void Cs2Reset(void);
 void Cs2SetTiming(int);
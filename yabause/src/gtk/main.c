@@ -69,12 +69,16 @@ NULL
 SH2Interface_struct *SH2CoreList[] = {
 &SH2Interpreter,
 &SH2DebugInterpreter,
+&SH2CachedInterpreter,
 #ifdef TEST_PSP_SH2
 &SH2PSP,
 #endif
 #ifdef SH2_DYNAREC
 &SH2Dynarec,
 #endif
+#ifdef HAVE_PLAY_JIT
+&SH2Jit,
+#endif
 NULL
 };
 
@@ -51,12 +51,14 @@ int game_width;
 int game_height;
 
 static bool one_frame_rendered = false;
+static int texture_stats_frames = 0;
 static bool hle_bios_force = false;
 static bool frameskip_enable = false;
 static int addon_cart_type = CART_NONE;
 static int numthreads = 1;
 
 static bool libretro_supports_bitmasks = false;
+static bool libretro_supports_dupe = false;
 static int16_t libretro_input_bitmask[12] = {-1,};
 static int pad_type[12] = {RETRO_DEVICE_NONE,};
 static int multitap[2] = {0,0};
@@ -466,6 +468,7 @@ M68K_struct *M68KCoreList[] = {
 SH2Interface_struct *SH2CoreList[] = {
     &SH2Interpreter,
     &SH2DebugInterpreter,
+    &SH2CachedInterpreter,
 #ifdef HAVE_PLAY_JIT
     &SH2Jit,
 #endif
@@ -519,6 +522,8 @@ int YuiSetVideoMode(int width, int height, int bpp, int fullscreen)
 
 void YuiSwapBuffers(void)
 {
+   static u32 last_skipped_frames = 0;
+   u32 skipped_frames = VIDSoftGetSkippedFrames();
    int current_width  = 320;
    int current_height = 240;
 
@@ -533,8 +538,28 @@ void YuiSwapBuffers(void)
    game_height = current_height;
 
    audio_size = soundlen;
-   video_cb(dispbuffer, game_width, game_height, game_width * 2);
+
+   /* The software renderer reused the last frame, let the frontend
+    * show it again instead of uploading the same pixels */
+   if (libretro_supports_dupe && skipped_frames != last_skipped_frames)
+      video_cb(NULL, game_width, game_height, game_width * 2);
+   else
+      video_cb(dispbuffer, game_width, game_height, game_width * 2);
+   last_skipped_frames = skipped_frames;
    one_frame_rendered = true;
+
+   /* How well the decoded VDP1 texture cache did on the last frame,
+    * logged about once a second */
+   if (log_cb && VIDCore && VIDCore->id == VIDCORE_SOFT &&
+       ++texture_stats_frames >= (yabsys.IsPal == 1 ? 50 : 60))
+   {
+      u32 hits, misses;
+      texture_stats_frames = 0;
+      VIDSoftGetVdp1TextureStats(&hits, &misses);
+      if (hits + misses)
+         log_cb(RETRO_LOG_DEBUG, "VDP1 texture cache: %u hits, %u misses (%.1f%% hit rate)\n",
+               hits, misses, hits * 100.0 / (hits + misses));
+   }
 }
 
 /************************************
@@ -1008,6 +1033,9 @@ void retro_init(void)
    if (environ_cb(RETRO_ENVIRONMENT_GET_INPUT_BITMASKS, NULL))
       libretro_supports_bitmasks = true;
 
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &libretro_supports_dupe))
+      libretro_supports_dupe = false;
+
    environ_cb(RETRO_ENVIRONMENT_SET_PERFORMANCE_LEVEL, &level);
 
    environ_cb(RETRO_ENVIRONMENT_SET_SERIALIZATION_QUIRKS, &serialization_quirks);
@@ -1186,6 +1214,7 @@ size_t retro_get_memory_size(unsigned id)
 void retro_deinit(void)
 {
    libretro_supports_bitmasks = false;
+   libretro_supports_dupe = false;
 }
 
 void retro_reset(void)
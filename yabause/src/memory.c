@@ -607,6 +607,33 @@ static void FillMemoryArea(SH2_struct *sh, unsigned short start, unsigned short
 
 //////////////////////////////////////////////////////////////////////////////
 
+static void FillMemoryPages(SH2_struct *sh, unsigned short start, unsigned short end,
+                            u8 *rmem, u8 *wmem, u32 mask)
+{
+   int i;
+
+   // Pages can only be accessed directly when nothing else needs to see the
+   // access(cache emulation, write notifications from the core, tracing)
+   if (sh->MappedMemoryReadByte != MappedMemoryReadByteNocache ||
+       sh->MappedMemoryReadWord != MappedMemoryReadWordNocache ||
+       sh->MappedMemoryReadLong != MappedMemoryReadLongNocache)
+      rmem = NULL;
+#ifndef SH2_TRACE
+   if (sh->MappedMemoryWriteByte != MappedMemoryWriteByteNocache ||
+       sh->MappedMemoryWriteWord != MappedMemoryWriteWordNocache ||
+       sh->MappedMemoryWriteLong != MappedMemoryWriteLongNocache)
+#endif
+      wmem = NULL;
+
+   for (i=start; i < (end+1); i++)
+   {
+      sh->ReadPageList[i] = rmem ? rmem + ((i << 16) & mask) : NULL;
+      sh->WritePageList[i] = wmem ? wmem + ((i << 16) & mask) : NULL;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void MappedMemoryInit(SH2_struct *msh2, SH2_struct *ssh2, SH2_struct *sh1)
 {
    SH2_struct *sh2[2] = { msh2, ssh2 };
@@ -751,6 +778,12 @@ void MappedMemoryInit(SH2_struct *msh2, SH2_struct *ssh2, SH2_struct *sh1)
                                            &Sh2HighWramMemoryWriteByte,
                                            &Sh2HighWramMemoryWriteWord,
                                            &Sh2HighWramMemoryWriteLong);
+
+      // Plain memory that can be accessed without going through a handler
+      FillMemoryPages(sh2[i], 0x000, 0xFFF, NULL, NULL, 0);
+      FillMemoryPages(sh2[i], 0x000, 0x00F, BiosRom, NULL, 0x7FFFF);
+      FillMemoryPages(sh2[i], 0x020, 0x02F, LowWram, LowWram, 0xFFFFF);
+      FillMemoryPages(sh2[i], 0x600, 0x7FF, HighWram, HighWram, 0xFFFFF);
    }
 
    if (yabsys.use_cd_block_lle)
@@ -780,7 +813,16 @@ u8 FASTCALL MappedMemoryReadByteNocache(SH2_struct *sh, u32 addr)
       case 0x5:
       {
          // Cache/Non-Cached
-         return sh->ReadByteList[(addr >> 16) & 0xFFF](sh, addr);
+         u8 *page = sh->ReadPageList[(addr >> 16) & 0xFFF];
+         u8 val;
+
+         if (page)
+            return T2ReadByte(page, addr & 0xFFFF);
+
+         SH2BusLock();
+         val = sh->ReadByteList[(addr >> 16) & 0xFFF](sh, addr);
+         SH2BusUnLock();
+         return val;
       }
 /*
       case 0x2:
@@ -835,7 +877,16 @@ u16 FASTCALL MappedMemoryReadWordNocache(SH2_struct *sh, u32 addr)
       case 0x5:
       {
          // Cache/Non-Cached
-         return sh->ReadWordList[(addr >> 16) & 0xFFF](sh, addr);
+         u8 *page = sh->ReadPageList[(addr >> 16) & 0xFFF];
+         u16 val;
+
+         if (page)
+            return T2ReadWord(page, addr & 0xFFFF);
+
+         SH2BusLock();
+         val = sh->ReadWordList[(addr >> 16) & 0xFFF](sh, addr);
+         SH2BusUnLock();
+         return val;
       }
 /*
       case 0x2:
@@ -890,7 +941,16 @@ u32 FASTCALL MappedMemoryReadLongNocache(SH2_struct *sh, u32 addr)
       case 0x5:
       {
          // Cache/Non-Cached
-         return sh->ReadLongList[(addr >> 16) & 0xFFF](sh, addr);
+         u8 *page = sh->ReadPageList[(addr >> 16) & 0xFFF];
+         u32 val;
+
+         if (page)
+            return T2ReadLong(page, addr & 0xFFFF);
+
+         SH2BusLock();
+         val = sh->ReadLongList[(addr >> 16) & 0xFFF](sh, addr);
+         SH2BusUnLock();
+         return val;
       }
 /*
       case 0x2:
@@ -954,7 +1014,16 @@ void FASTCALL MappedMemoryWriteByteNocache(SH2_struct *sh, u32 addr, u8 val)
       case 0x5:
       {
          // Cache/Non-Cached
-         sh->WriteByteList[(addr >> 16) & 0xFFF](sh, addr, val);
+         u8 *page = sh->WritePageList[(addr >> 16) & 0xFFF];
+
+         if (page)
+            T2WriteByte(page, addr & 0xFFFF, val);
+         else
+         {
+            SH2BusLock();
+            sh->WriteByteList[(addr >> 16) & 0xFFF](sh, addr, val);
+            SH2BusUnLock();
+         }
          return;
       }
 /*
@@ -1017,7 +1086,16 @@ void FASTCALL MappedMemoryWriteWordNocache(SH2_struct *sh, u32 addr, u16 val)
       case 0x5:
       {
          // Cache/Non-Cached
-         sh->WriteWordList[(addr >> 16) & 0xFFF](sh, addr, val);
+         u8 *page = sh->WritePageList[(addr >> 16) & 0xFFF];
+
+         if (page)
+            T2WriteWord(page, addr & 0xFFFF, val);
+         else
+         {
+            SH2BusLock();
+            sh->WriteWordList[(addr >> 16) & 0xFFF](sh, addr, val);
+            SH2BusUnLock();
+         }
          return;
       }
 /*
@@ -1080,7 +1158,16 @@ void FASTCALL MappedMemoryWriteLongNocache(SH2_struct *sh, u32 addr, u32 val)
       case 0x5:
       {
          // Cache/Non-Cached
-         sh->WriteLongList[(addr >> 16) & 0xFFF](sh, addr, val);
+         u8 *page = sh->WritePageList[(addr >> 16) & 0xFFF];
+
+         if (page)
+            T2WriteLong(page, addr & 0xFFFF, val);
+         else
+         {
+            SH2BusLock();
+            sh->WriteLongList[(addr >> 16) & 0xFFF](sh, addr, val);
+            SH2BusUnLock();
+         }
          return;
       }
       case 0x2:
@@ -1128,6 +1215,97 @@ void FASTCALL MappedMemoryWriteLongNocache(SH2_struct *sh, u32 addr, u32 val)
 
 //////////////////////////////////////////////////////////////////////////////
 
+// Called by the SH2Memory* functions when the host page lists have no page
+// for the address. For the listed areas that means a device, whose handler
+// can be called right away unless the access has to go through the cache or
+// the tracer.
+
+u8 FASTCALL SH2MemoryReadByteNoPage(SH2_struct *sh, u32 addr)
+{
+   if (((0x23 >> (addr >> 29)) & 1) && sh->MappedMemoryReadByte == MappedMemoryReadByteNocache)
+   {
+      u8 val;
+
+      SH2BusLock();
+      val = sh->ReadByteList[(addr >> 16) & 0xFFF](sh, addr);
+      SH2BusUnLock();
+      return val;
+   }
+   return sh->MappedMemoryReadByte(sh, addr);
+}
+
+u16 FASTCALL SH2MemoryReadWordNoPage(SH2_struct *sh, u32 addr)
+{
+   if (((0x23 >> (addr >> 29)) & 1) && sh->MappedMemoryReadWord == MappedMemoryReadWordNocache)
+   {
+      u16 val;
+
+      SH2BusLock();
+      val = sh->ReadWordList[(addr >> 16) & 0xFFF](sh, addr);
+      SH2BusUnLock();
+      return val;
+   }
+   return sh->MappedMemoryReadWord(sh, addr);
+}
+
+u32 FASTCALL SH2MemoryReadLongNoPage(SH2_struct *sh, u32 addr)
+{
+   if (((0x23 >> (addr >> 29)) & 1) && sh->MappedMemoryReadLong == MappedMemoryReadLongNocache)
+   {
+      u32 val;
+
+      SH2BusLock();
+      val = sh->ReadLongList[(addr >> 16) & 0xFFF](sh, addr);
+      SH2BusUnLock();
+      return val;
+   }
+   return sh->MappedMemoryReadLong(sh, addr);
+}
+
+void FASTCALL SH2MemoryWriteByteNoPage(SH2_struct *sh, u32 addr, u8 val)
+{
+#ifndef SH2_TRACE
+   if (((0x23 >> (addr >> 29)) & 1) && sh->MappedMemoryWriteByte == MappedMemoryWriteByteNocache)
+   {
+      SH2BusLock();
+      sh->WriteByteList[(addr >> 16) & 0xFFF](sh, addr, val);
+      SH2BusUnLock();
+      return;
+   }
+#endif
+   sh->MappedMemoryWriteByte(sh, addr, val);
+}
+
+void FASTCALL SH2MemoryWriteWordNoPage(SH2_struct *sh, u32 addr, u16 val)
+{
+#ifndef SH2_TRACE
+   if (((0x23 >> (addr >> 29)) & 1) && sh->MappedMemoryWriteWord == MappedMemoryWriteWordNocache)
+   {
+      SH2BusLock();
+      sh->WriteWordList[(addr >> 16) & 0xFFF](sh, addr, val);
+      SH2BusUnLock();
+      return;
+   }
+#endif
+   sh->MappedMemoryWriteWord(sh, addr, val);
+}
+
+void FASTCALL SH2MemoryWriteLongNoPage(SH2_struct *sh, u32 addr, u32 val)
+{
+#ifndef SH2_TRACE
+   if (((0x23 >> (addr >> 29)) & 1) && sh->MappedMemoryWriteLong == MappedMemoryWriteLongNocache)
+   {
+      SH2BusLock();
+      sh->WriteLongList[(addr >> 16) & 0xFFF](sh, addr, val);
+      SH2BusUnLock();
+      return;
+   }
+#endif
+   sh->MappedMemoryWriteLong(sh, addr, val);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 int MappedMemoryLoad(SH2_struct *sh, const char *filename, u32 addr)
 {
    FILE *fp;
@@ -1764,6 +1942,8 @@ int YabLoadStateStream(const void * stream, size_t size_stream)
    MemStateRead((void *)BupRam, 0x10000, 1, stream);
    MemStateRead((void *)HighWram, 0x100000, 1, stream);
    MemStateRead((void *)LowWram, 0x100000, 1, stream);
+   SH2WriteNotify(0x06000000, 0x100000);
+   SH2WriteNotify(0x00200000, 0x100000);
 
    MemStateRead((void *)&yabsys.DecilineCount, sizeof(int), 1, stream);
    MemStateRead((void *)&yabsys.LineCount, sizeof(int), 1, stream);
@@ -58,6 +58,7 @@ NULL
 SH2Interface_struct *SH2CoreList[] = {
 &SH2Interpreter,
 &SH2DebugInterpreter,
+&SH2CachedInterpreter,
 #ifdef SH2_DYNAREC
 &SH2Dynarec,
 #endif
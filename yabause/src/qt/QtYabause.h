@@ -74,6 +74,10 @@ extern "C"
 #ifdef SH2_TRACE
 	#include "../sh2trace.h"
 #endif
+
+#if defined(SH2_DYNAREC) && defined(DYNAREC_PROFILE)
+	#include "../sh2_dynarec/sh2_dynarec.h"
+#endif
 }
 
 #include <QString>
@@ -395,6 +395,9 @@ void YabauseThread::reloadSettings()
    mYabauseConf.use_new_scsp = (int)vs->value("Sound/NewScsp", mYabauseConf.use_new_scsp).toBool();
    mYabauseConf.use_scsp_dsp_dynarec = (int)vs->value("Sound/EnableScspDspDynarec", mYabauseConf.use_scsp_dsp_dynarec).toBool();
    mYabauseConf.use_scu_dsp_jit = (int)vs->value("Advanced/EnableScuDspDynarec", mYabauseConf.use_scu_dsp_jit).toBool();
+   mYabauseConf.use_scheduler = (int)vs->value("Advanced/Scheduler", mYabauseConf.use_scheduler).toBool();
+   mYabauseConf.use_ssh2_thread = (int)vs->value("Advanced/SSH2Thread", mYabauseConf.use_ssh2_thread).toBool();
+   mYabauseConf.ssh2_thread_skew = vs->value("Advanced/SSH2ThreadSkew", mYabauseConf.ssh2_thread_skew).toInt();
 
 	emit requestSize( QSize( vs->value( "Video/WinWidth", 0 ).toInt(), vs->value( "Video/WinHeight", 0 ).toInt() ) );
 	emit requestFullscreen( vs->value( "Video/Fullscreen", false ).toBool() );
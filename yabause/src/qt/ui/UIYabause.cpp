@@ -118,6 +118,9 @@ UIYabause::UIYabause( QWidget* parent )
 #ifndef SH2_TRACE
 	aTraceLogging->setVisible(false);
 #endif
+#if !defined(SH2_DYNAREC) || !defined(DYNAREC_PROFILE)
+	aDynarecProfile->setVisible(false);
+#endif
 
 	// create emulator thread
 	mYabauseThread = new YabauseThread( this );
@@ -790,12 +793,14 @@ void UIYabause::on_aFileSettings_triggered()
 			{
 				int num = newhash["General/NumThreads"].toInt() < 1 ? 1 : newhash["General/NumThreads"].toInt();
 				VIDSoftSetVdp1ThreadEnable(num == 1 ? 0 : 1);
+				VIDSoftSetNumVdp1Threads(num);
 				VIDSoftSetNumLayerThreads(num);
 				VIDSoftSetNumPriorityThreads(num);
 			}
 			else
 			{
 				VIDSoftSetVdp1ThreadEnable(0);
+				VIDSoftSetNumVdp1Threads(0);
 				VIDSoftSetNumLayerThreads(1);
 				VIDSoftSetNumPriorityThreads(1);
 			}
@@ -1202,6 +1207,18 @@ void UIYabause::on_aTraceLogging_triggered( bool toggled )
 	return;
 }
 
+void UIYabause::on_aDynarecProfile_triggered()
+{
+#if defined(SH2_DYNAREC) && defined(DYNAREC_PROFILE)
+	YabauseLocker locker( mYabauseThread );
+	if ( SH2Core && SH2Core->id == SH2CORE_DYNAREC )
+	{
+		sh2_dynarec_profile_report();
+		sh2_dynarec_profile_reset();
+	}
+#endif
+}
+
 void UIYabause::on_aHelpDocumentation_triggered()
 { QDesktopServices::openUrl( QUrl( aHelpDocumentation->statusTip() ) ); }
 
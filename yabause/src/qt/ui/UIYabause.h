@@ -179,6 +179,7 @@ protected slots:
 	void on_aViewDebugSH1_triggered();
 	void on_aViewDebugMemoryEditor_triggered();
 	void on_aTraceLogging_triggered( bool toggled );
+	void on_aDynarecProfile_triggered();
 	// help menu
    void on_aHelpDocumentation_triggered();
 	void on_aHelpCompatibilityList_triggered();
@@ -44,6 +44,7 @@ extern u8 *vdp1backframebuffer;
 #include <vector>
 #include <sstream>
 #include <fstream>
+#include <ctime>
 
 #define AUTO_TEST_SELECT_ADDRESS 0x7F000
 #define AUTO_TEST_STATUS_ADDRESS 0x7F004
@@ -540,7 +541,7 @@ namespace game_testing
       return true;
    }
 
-   int init_game(std::string full_path)
+   int init_game(std::string full_path, bool scheduler = false)
    {
       yabauseinit_struct yinit = { 0 };
 
@@ -564,6 +565,7 @@ namespace game_testing
       yinit.skip_load = 0;
       yinit.numthreads = 0;
       yinit.usethreads = 0;
+      yinit.use_scheduler = scheduler;
 
       YabauseDeInit();
 
@@ -780,6 +782,194 @@ namespace game_testing
    }
 }
 
+namespace game_testing
+{
+   //runs every game up to its last screenshot frame with the device event
+   //scheduler and with the plain deciline loop and reports the time per frame of each, and
+   //how many cycles each SH2 spent in idle loops that were skipped
+   double time_game(const GameData &data, bool scheduler, u64 *idle_cycles = NULL)
+   {
+      std::vector<int> start_press_frames = data.start_press_frames;
+      int last_frame = data.screenshot_frames.size() > 0 ? data.screenshot_frames.back() : 0;
+
+      if (init_game(data.path, scheduler) < 0)
+      {
+         std::cout << "Couldn't init game" << std::endl;
+         return -1;
+      }
+
+      PerPortReset();
+      PerPad_struct* pad1 = PerPadAdd(&PORTDATA1);
+
+      clock_t start_time = clock();
+
+      for (int frame_count = 0; frame_count <= last_frame; frame_count++)
+      {
+         if (start_press_frames.size() > 0 && frame_count == start_press_frames.at(0))
+         {
+            *pad1->padbits &= 0xF7;//press start
+            start_press_frames.erase(start_press_frames.begin() + 0);
+         }
+         else
+            *pad1->padbits |= 0x08;//undo press
+
+         PERCore->HandleEvents();
+      }
+
+      clock_t end_time = clock();
+
+      if (idle_cycles)
+      {
+         idle_cycles[0] = MSH2->idleCycles;
+         idle_cycles[1] = SSH2->idleCycles;
+      }
+
+      return (double)(end_time - start_time) * 1000 / CLOCKS_PER_SEC / (last_frame + 1);
+   }
+
+   int bench(const std::string path_filename, std::string game_data_filename)
+   {
+      std::cout << "Game frame times" << std::endl;
+
+      if (!load_game_data(game_data_filename))
+      {
+         std::cout << "Failed to load game paths." << std::endl;
+         return false;
+      }
+
+      if (!load_game_paths(path_filename))
+      {
+         std::cout << "Failed to load game paths." << std::endl;
+         return false;
+      }
+
+      for (int i = 0; i < game_data.size(); i++)
+      {
+         u64 idle_cycles[2];
+         double scheduled = time_game(game_data.at(i), true, idle_cycles);
+         double deciline = time_game(game_data.at(i), false);
+
+         if (scheduled < 0 || deciline < 0)
+            return 0;
+
+         std::cout << game_data.at(i).name << ": scheduled " << scheduled <<
+            " ms/frame, deciline " << deciline << " ms/frame, idle loops skipped " <<
+            idle_cycles[0] << " master / " << idle_cycles[1] << " slave cycles" << std::endl;
+      }
+
+      return 1;
+   }
+}
+
+namespace cache_testing
+{
+   //runs the same mix of reads, writes and purges through the SH2 cache and
+   //through the uncached path, and reports the throughput of each. The
+   //checksum covers the data read and the cycles charged so that changes to
+   //the cache emulation can be checked to give identical results
+   double run_accesses(bool cached, u32 count, u32 &checksum)
+   {
+      SH2_struct *sh = MSH2;
+      cache_enty *ca = &sh->onchip.cache;
+      u32 seed = 1;
+      u32 sum = 0;
+
+      sh->cycles = 0;
+
+      clock_t start_time = clock();
+
+      for (u32 i = 0; i < count; i++)
+      {
+         u32 addr;
+
+         seed = seed * 1103515245 + 12345;
+
+         //mostly a hot set that fits in the cache, with misses from a
+         //wider working set
+         if ((seed >> 24) < 192)
+            addr = 0x06000000 | ((seed >> 4) & 0x0FFC);
+         else
+            addr = 0x06000000 | ((seed >> 4) & 0xFFFC);
+
+         switch ((seed >> 16) & 7)
+         {
+         case 0:
+            if (cached)
+               cache_memory_write_l(sh, ca, addr, seed);
+            else
+               MappedMemoryWriteLongNocache(sh, addr, seed);
+            break;
+         case 1:
+            if (cached)
+               cache_memory_write_w(sh, ca, addr, seed);
+            else
+               MappedMemoryWriteWordNocache(sh, addr, seed);
+            break;
+         case 2:
+            sum = sum * 31 + (cached ? cache_memory_read_b(sh, ca, addr + 3) : MappedMemoryReadByteNocache(sh, addr + 3));
+            break;
+         case 3:
+            sum = sum * 31 + (cached ? cache_memory_read_w(sh, ca, addr + 2) : MappedMemoryReadWordNocache(sh, addr + 2));
+            break;
+         default:
+            sum = sum * 31 + (cached ? cache_memory_read_l(sh, ca, addr) : MappedMemoryReadLongNocache(sh, addr));
+            break;
+         }
+
+         if (cached && (i & 0x3FF) == 0)
+            cache_memory_write_l(sh, ca, 0x40000000 | addr, 0);//associative purge
+      }
+
+      clock_t end_time = clock();
+
+      checksum = sum * 31 + sh->cycles;
+
+      return (double)(end_time - start_time) / CLOCKS_PER_SEC;
+   }
+
+   int bench(u32 millions)
+   {
+      yabauseinit_struct yinit = { 0 };
+      u32 count = millions * 1000000;
+      u32 cached_sum, uncached_sum;
+
+      yinit.percoretype = PERCORE_DUMMY;
+      yinit.sh2coretype = SH2CORE_INTERPRETER;
+      yinit.vidcoretype = VIDCORE_DUMMY;
+      yinit.m68kcoretype = M68KCORE_DUMMY;
+      yinit.sndcoretype = SNDCORE_DUMMY;
+      yinit.cdcoretype = CDCORE_DUMMY;
+      yinit.carttype = CART_NONE;
+      yinit.regionid = REGION_AUTODETECT;
+      yinit.biospath = NULL;
+      yinit.frameskip = 0;
+      yinit.videoformattype = VIDEOFORMATTYPE_NTSC;
+      yinit.skip_load = 1;
+      yinit.sh2_cache_enabled = 1;
+
+      if (YabauseInit(&yinit) != 0)
+         return false;
+
+      //clear and enable the cache, 4-way mode
+      cache_clear(&MSH2->onchip.cache);
+      MSH2->onchip.CCR = 0x01;
+      cache_enable(&MSH2->onchip.cache);
+
+      double cached = run_accesses(true, count, cached_sum);
+      double uncached = run_accesses(false, count, uncached_sum);
+
+      std::cout << "SH2 cache accesses: " << count << std::endl;
+      std::cout << "cached:   " << (cached > 0 ? count / cached / 1000000 : 0) <<
+         " M accesses/s, checksum " << std::hex << cached_sum << std::dec << std::endl;
+      std::cout << "uncached: " << (uncached > 0 ? count / uncached / 1000000 : 0) <<
+         " M accesses/s" << std::endl;
+
+      YabauseDeInit();
+
+      return true;
+   }
+}
+
 namespace yabauseut
 {
    int start(std::string yabause_ut_filename, std::string screenshot_path, std::string framebuffer_path, bool check)
@@ -988,6 +1178,8 @@ namespace yabauseut
 //no spaces in paths allowed, include final / on directories
 //yabause game check game_data_file path_file screenshot_path fail_path
 //yabause game dump game_data_file path_file output_path
+//yabause game bench game_data_file path_file
+//yabause cache bench millions_of_accesses
 //yabause yabauseut check yabause_ut_binary_path screenshot_path framebuffer_path
 //yabause yabauseut dump yabause_ut_binary_path output_path
 int main(int argc, char *argv[])
@@ -1061,12 +1253,37 @@ int main(int argc, char *argv[])
             dummy,
             false);
       }
+      else if (args.at(2) == "bench")
+      {
+         //compare frame times of the device event scheduler and the plain deciline loop
+         if (args.size() < 5)
+         {
+            std::cout << "Not enough arguments for game bench mode." << std::endl;
+            return false;
+         }
+
+         std::string game_data_path = args.at(3);
+         std::string path_file = args.at(4);
+
+         return game_testing::bench(path_file, game_data_path);
+      }
       else
       {
          std::cout << "Unknown check/dump argment." << std::endl;
          return false;
       }
    }
+   else if (args.at(1) == "cache")
+   {
+      //sh2 cache throughput
+      if (args.at(2) == "bench")
+         return cache_testing::bench(string_to_int(args.at(3)));
+      else
+      {
+         std::cout << "Unknown cache argument." << std::endl;
+         return false;
+      }
+   }
    else if (args.at(1) == "yabauseut")
    {
       //yabauseut mode
@@ -295,11 +295,19 @@ static void DoDMA(u32 ReadAddress, unsigned int ReadAdd,
 #ifdef OPTIMIZED_DMA
       int source_type = DMAMemoryType[(ReadAddress  & 0x1FF80000) >> 19];
       int dest_type   = DMAMemoryType[(WriteAddress & 0x1FF80000) >> 19];
-      if (WriteAdd == ((dest_type & 0x2) ? 2 : 4)) {
+      // Color RAM is left to the normal path so that Vdp2ColorRamWrite*
+      // keeps Vdp2ColorRamLut up to date
+      if (WriteAdd == ((dest_type & 0x2) ? 2 : 4) && dest_type != 0x23) {
          // Writes don't skip any bytes, so use an optimized copy algorithm
          // if possible.
          const u8 *source_ptr = DMAMemoryPointer(ReadAddress);
          u8 *dest_ptr = DMAMemoryPointer(WriteAddress);
+         // The copies below bypass Vdp1RamWrite*/Vdp2RamWrite*, so mark the
+         // pages here
+         if (dest_ptr && (WriteAddress & 0x1FF00000) == 0x05E00000)
+            Vdp2RamMarkDirty(WriteAddress, TransferSize);
+         else if (dest_ptr && (WriteAddress & 0x1FF80000) == 0x05C00000)
+            Vdp1RamMarkDirty(WriteAddress, TransferSize);
 # ifdef WORDS_BIGENDIAN
          if ((source_type & 0x30) && (dest_type & 0x30)) {
             // Source and destination are both directly accessible.
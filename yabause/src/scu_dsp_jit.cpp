@@ -41,11 +41,15 @@ extern "C"
 static Jitter::CJitter jit(Jitter::CreateCodeGen());
 
 #define NUM_BLOCKS 256
+#define MAX_BLOCK_LENGTH 16
 
 struct ScuDspCodeBlock
 {
    int dirty;
-   CMemoryFunction function;
+   CMemoryFunction function;//single instruction
+   CMemoryFunction block;//straight line run starting here
+   CMemoryFunction partial;//same run stopping when timing does
+   u32 block_length;
 }scu_blocks[NUM_BLOCKS];
 
 struct ScuDspContext
@@ -86,6 +90,7 @@ struct ScuDspContext
    u32 data_ram_read_address;
 
    u32 timing;
+   u32 tail_steps;//rest of a block cut short by timing, run one at a time
 
    int need_recompile;
 };
@@ -162,28 +167,6 @@ void sign_extend_32(Jitter::CJitter & jit, size_t src_offset_lo, size_t dst_offs
    jit.PullRel(dst_offset_hi);
 }
 
-//todo write hardware test, recompile
-void do_ad2_flags(u64 input)
-{
-   u64 ac = cxt.acl | (u64)cxt.ach << 32;
-   u64 p = cxt.pl | (u64)cxt.ph << 32;
-
-   if (input == 0)
-      cxt.control |= CONTROL_Z;
-   else
-      cxt.control &= ~CONTROL_Z;
-
-   if (input & 0x800000000000)
-      cxt.control |= CONTROL_S;
-   else
-      cxt.control &= ~CONTROL_S;
-
-   if (((ac & 0xffffffffffff) + (p & 0xffffffffffff)) & (0x1000000000000))
-      cxt.control |= CONTROL_C;
-   else
-      cxt.control &= ~CONTROL_C;
-}
-
 void do_zero_flag()
 {
    //control &= ~CONTROL_Z;
@@ -361,23 +344,71 @@ void recompile_alu(Jitter::CJitter & jit, u32 instruction)
       do_alu_op(instr);
       break;
    case 0x6: // AD2
-      //temp = (acl | (ach << 32)) + (pl | (ph << 32))
-      //aluh = temp >> 32
-      //alul = temp & 0xffffffff
+      //done as two 32 bit adds so a block never merges constants into
+      //a 64 bit value and has no call that reads back the accumulators
+
+      //alul = acl + pl;
       jit.PushRel(offsetof(ScuDspContext, acl));
-      jit.PushRel(offsetof(ScuDspContext, ach));
-      jit.MergeTo64();
       jit.PushRel(offsetof(ScuDspContext, pl));
-      jit.PushRel(offsetof(ScuDspContext, ph));
-      jit.MergeTo64();
-      jit.Add64();
-      jit.PushTop();
+      jit.Add();
+      jit.PullRel(offsetof(ScuDspContext, alul));
+
+      //carry = alul < acl;
+      jit.PushRel(offsetof(ScuDspContext, alul));
+      jit.PushRel(offsetof(ScuDspContext, acl));
+      jit.Cmp(Jitter::CONDITION_BL);
       jit.PushTop();
-      jit.ExtHigh64();
+
+      //aluh = ach + ph + carry;
+      jit.PushRel(offsetof(ScuDspContext, ach));
+      jit.Add();
+      jit.PushRel(offsetof(ScuDspContext, ph));
+      jit.Add();
       jit.PullRel(offsetof(ScuDspContext, aluh));
-      jit.ExtLow64();
-      jit.PullRel(offsetof(ScuDspContext, alul));
-      jit.Call(reinterpret_cast<void*>(&do_ad2_flags), 1, Jitter::CJitter::RETURN_VALUE_NONE);
+
+      //control &= ~CONTROL_C;
+      //control |= (((ach & 0xffff) + (ph & 0xffff) + carry) >> 16) << 20;
+      jit.PushRel(offsetof(ScuDspContext, ach));
+      jit.PushCst(0xffff);
+      jit.And();
+      jit.Add();
+      jit.PushRel(offsetof(ScuDspContext, ph));
+      jit.PushCst(0xffff);
+      jit.And();
+      jit.Add();
+      jit.Srl(16);
+      jit.Shl(20);
+      jit.PushRel(offsetof(ScuDspContext, control));
+      jit.PushCst(~CONTROL_C);
+      jit.And();
+      jit.Or();
+      jit.PullRel(offsetof(ScuDspContext, control));
+
+      //control &= ~CONTROL_Z;
+      //control |= ((alul | aluh) == 0) << 21;
+      jit.PushRel(offsetof(ScuDspContext, alul));
+      jit.PushRel(offsetof(ScuDspContext, aluh));
+      jit.Or();
+      jit.PushCst(0);
+      jit.Cmp(Jitter::CONDITION_EQ);
+      jit.Shl(21);
+      jit.PushRel(offsetof(ScuDspContext, control));
+      jit.PushCst(~CONTROL_Z);
+      jit.And();
+      jit.Or();
+      jit.PullRel(offsetof(ScuDspContext, control));
+
+      //control &= ~CONTROL_S;
+      //control |= (aluh & 0x8000) << 7;
+      jit.PushRel(offsetof(ScuDspContext, aluh));
+      jit.PushCst(0x8000);
+      jit.And();
+      jit.Shl(7);
+      jit.PushRel(offsetof(ScuDspContext, control));
+      jit.PushCst(~CONTROL_S);
+      jit.And();
+      jit.Or();
+      jit.PullRel(offsetof(ScuDspContext, control));
       break;
    case 0x8: // SR
    case 0x9: // RR
@@ -529,7 +560,7 @@ void recompile_move_immediate(u32 instruction, int is_imm_d)
       jit.And();
       jit.PullRel(offsetof(ScuDspContext, top));
 
-      jit.PushCst(data);
+      jit.PushCst(data & 0xFF);
       jit.PullRel(offsetof(ScuDspContext, jump_addr));
 
       jit.PushCst(0);
@@ -1064,7 +1095,10 @@ void dsp_dma03(u32 inst)
          u32 Adr = (cxt.ra0 << 2);
          cxt.program[i] = MappedMemoryReadLongNocache(MSH2, Adr);
          cxt.ra0 += incl;
+         scu_blocks[i & 0xff].dirty = 1;
       }
+
+      cxt.need_recompile = 1;
    }
    else {
 
@@ -1223,19 +1257,10 @@ void do_lps_btm(size_t pc_top)
 
 void recompile_loop(u32 instruction)
 {
-   jit.PushCst(instruction);
-   jit.PushCst(0x8000000);
-   jit.And();
-   jit.PushCst(0);
-   jit.BeginIf(Jitter::CONDITION_NE);
-   {
+   if (instruction & 0x8000000)
       do_lps_btm(offsetof(ScuDspContext, pc));
-   }
-   jit.Else();
-   {
+   else
       do_lps_btm(offsetof(ScuDspContext, top));
-   }
-   jit.EndIf();
 }
 
 void recompile_end(u32 instruction)
@@ -1246,11 +1271,7 @@ void recompile_end(u32 instruction)
    jit.And();
    jit.PullRel(offsetof(ScuDspContext, control));
 
-   jit.PushCst(instruction);
-   jit.PushCst(0x8000000);
-   jit.And();
-   jit.PushCst(0);
-   jit.BeginIf(Jitter::CONDITION_NE);
+   if (instruction & 0x8000000)
    {
       //control.e = 1;
       jit.PushRel(offsetof(ScuDspContext, control));
@@ -1260,7 +1281,6 @@ void recompile_end(u32 instruction)
 
       jit.Call(reinterpret_cast<void*>(&ScuSendDSPEnd), 0, Jitter::CJitter::RETURN_VALUE_NONE);
    }
-   jit.EndIf();
 
    //control &= ~0xFF;
    //control |= (pc + 1) & 0xFF;
@@ -1321,7 +1341,40 @@ void handle_delayed_jumps()
    jit.EndIf();
 }
 
-void recompile_instruction(u32 pc) 
+void set_pc(u32 pc)
+{
+   jit.PushCst(pc & 0xFF);
+   jit.PullRel(offsetof(ScuDspContext, pc));
+}
+
+void subtract_timing(u32 steps)
+{
+   jit.PushRel(offsetof(ScuDspContext, timing));
+   jit.PushCst(steps);
+   jit.Sub();
+   jit.PullRel(offsetof(ScuDspContext, timing));
+}
+
+//jumps, loops and mvi to pc take effect after the next instruction
+int is_delayed_branch(u32 instruction)
+{
+   u32 op = (instruction >> 28) & 0xF;
+
+   if ((instruction >> 30) == 2)
+      return ((instruction >> 26) & 0xF) == 0xC;
+
+   return (instruction >> 30) == 3 && (op == 0x0D || op == 0x0E);
+}
+
+//dma and end call out of the generated code
+int ends_block(u32 instruction)
+{
+   u32 op = (instruction >> 28) & 0xF;
+
+   return (instruction >> 30) == 3 && (op == 0x0C || op == 0x0F);
+}
+
+void recompile_instruction_body(u32 pc)
 {
    u32 instruction = cxt.program[pc];
 
@@ -1363,51 +1416,212 @@ void recompile_instruction(u32 pc)
    }
 
    recompile_multiply(pc);
+}
+
+void recompile_instruction(u32 pc)
+{
+   recompile_instruction_body(pc);
 
    increment_pc();
 
    handle_delayed_jumps();
 }
 
-void scu_dsp_jit_exec(u32 cycles)
+//compiles instructions from pc up to and including the delay slot of the
+//first jump or loop, or the first dma or end. the block is only entered with
+//no jump pending, so pc and the delayed jump state are known at compile time
+//until the first branch. the full block is only entered with enough timing
+//left to run all of it and updates timing once. one whose branch lands back
+//on its first instruction (lps, or btm/jmp to the top) loops in place while
+//timing lasts. the partial block checks timing before every instruction
+//instead, it is only used to run out the end of a slice. blocks are kept
+//short since the jitter's optimizer is quadratic in straight line code
+void recompile_block(u32 pc, int partial)
 {
-   cxt.timing = cycles / 2;
+   u32 start = pc;
+   u32 length = 0;
+   u32 instruction;
+   int in_delay_slot = 0;
+   Jitter::CJitter::LABEL top;
+
+   Framework::CMemStream stream;
+   stream.Seek(0, Framework::STREAM_SEEK_DIRECTION::STREAM_SEEK_SET);
+   jit.SetStream(&stream);
+   jit.Begin();
+
+   top = jit.CreateLabel();
+   jit.MarkLabel(top);
 
-   if (cxt.need_recompile)
+   for (;;)
    {
-      //todo recompile into basic blocks and handle jumps/loops
-      for (int i = 0; i < NUM_BLOCKS; i++)
+      int branch;
+
+      instruction = cxt.program[pc];
+      branch = is_delayed_branch(instruction);
+
+      if (partial && length)
       {
-         if (!scu_blocks[i].dirty)
-            continue;
+         jit.PushRel(offsetof(ScuDspContext, timing));
+         jit.PushCst(0);
+         jit.BeginIf(Jitter::CONDITION_NE);
+      }
+
+      recompile_instruction_body(pc);
 
-         Framework::CMemStream stream;
-         stream.Seek(0, Framework::STREAM_SEEK_DIRECTION::STREAM_SEEK_SET);
-         jit.SetStream(&stream);
-         jit.Begin();
-         recompile_instruction(i);
-         jit.End();
+      pc = (pc + 1) & 0xFF;
+      set_pc(pc);
 
-         scu_blocks[i].function = CMemoryFunction(stream.GetBuffer(), stream.GetSize());
-         scu_blocks[i].dirty = 0;
+      if (branch || in_delay_slot)
+         handle_delayed_jumps();
+
+      if (partial)
+         subtract_timing(1);
+
+      length++;
+
+      if (in_delay_slot || ends_block(instruction) || length == MAX_BLOCK_LENGTH)
+         break;
+
+      in_delay_slot = branch;
+   }
+
+   if (partial)
+   {
+      for (u32 i = 1; i < length; i++)
+         jit.EndIf();
+   }
+   else if ((instruction >> 28) == 0x0F)
+   {
+      //end stops the dsp for the rest of the slice
+      jit.PushCst(0);
+      jit.PullRel(offsetof(ScuDspContext, timing));
+   }
+   else
+   {
+      subtract_timing(length);
+
+      if (in_delay_slot && !ends_block(instruction))
+      {
+         //if (pc == start && jump_addr == 0xFFFFFFFF && timing >= length) goto top;
+         jit.PushRel(offsetof(ScuDspContext, pc));
+         jit.PushCst(start);
+         jit.BeginIf(Jitter::CONDITION_EQ);
+         {
+            jit.PushRel(offsetof(ScuDspContext, jump_addr));
+            jit.PushCst(0xFFFFFFFF);
+            jit.BeginIf(Jitter::CONDITION_EQ);
+            {
+               jit.PushRel(offsetof(ScuDspContext, timing));
+               jit.PushCst(length - 1);
+               jit.BeginIf(Jitter::CONDITION_GT);
+               {
+                  jit.Goto(top);
+               }
+               jit.EndIf();
+            }
+            jit.EndIf();
+         }
+         jit.EndIf();
       }
-      cxt.need_recompile = 0;
    }
 
+   jit.End();
+
+   if (partial)
+      scu_blocks[start].partial = CMemoryFunction(stream.GetBuffer(), stream.GetSize());
+   else
+      scu_blocks[start].block = CMemoryFunction(stream.GetBuffer(), stream.GetSize());
+
+   scu_blocks[start].block_length = length;
+}
+
+void recompile_program()
+{
+   for (int i = 0; i < NUM_BLOCKS; i++)
+   {
+      //a changed instruction can be in any block, they are rebuilt on demand
+      scu_blocks[i].block = CMemoryFunction();
+      scu_blocks[i].partial = CMemoryFunction();
+      scu_blocks[i].block_length = 0;
+
+      if (!scu_blocks[i].dirty)
+         continue;
+
+      Framework::CMemStream stream;
+      stream.Seek(0, Framework::STREAM_SEEK_DIRECTION::STREAM_SEEK_SET);
+      jit.SetStream(&stream);
+      jit.Begin();
+      recompile_instruction(i);
+      jit.End();
+
+      scu_blocks[i].function = CMemoryFunction(stream.GetBuffer(), stream.GetSize());
+      scu_blocks[i].dirty = 0;
+   }
+   cxt.need_recompile = 0;
+}
+
+void scu_dsp_jit_exec(u32 cycles)
+{
+   cxt.timing = cycles / 2;
+
    if (cxt.control & CONTROL_EX)
    {
       while (cxt.timing > 0)
       {
-         scu_blocks[cxt.pc].function(&cxt);
+         struct ScuDspCodeBlock * block;
+
+         //program ram can be written by dma while running
+         if (cxt.need_recompile)
+            recompile_program();
+
+         block = &scu_blocks[cxt.pc];
+
+         if (!cxt.tail_steps && cxt.jump_addr == 0xFFFFFFFF)
+         {
+            u32 timing = cxt.timing;
+
+            if (!block->block_length)
+               recompile_block(cxt.pc, 0);
+
+            //blocks update timing themselves
+            if (timing >= block->block_length)
+            {
+               block->block(&cxt);
+               continue;
+            }
+
+            if (block->partial.IsEmpty())
+               recompile_block(cxt.pc, 1);
+
+            block->partial(&cxt);
+
+            //finish the block one instruction at a time next time, so blocks
+            //are only ever entered where they were first compiled from
+            if (cxt.control & CONTROL_EX)
+               cxt.tail_steps = block->block_length - timing;
+
+            continue;
+         }
+
+         block->function(&cxt);
          cxt.timing--;
+
+         if (cxt.tail_steps)
+            cxt.tail_steps--;
       }
    }
+   else if (cxt.need_recompile)
+      recompile_program();
 }
 
 extern "C" void scu_dsp_jit_set_program(u32 val)
 {
-   cxt.need_recompile = 1;
-   scu_blocks[cxt.pc].dirty = 1;
+   //programs are often uploaded again unchanged, keep their code
+   if (cxt.program[cxt.pc] != val || scu_blocks[cxt.pc].function.IsEmpty())
+   {
+      cxt.need_recompile = 1;
+      scu_blocks[cxt.pc].dirty = 1;
+   }
 
    cxt.program[cxt.pc] = val;
    cxt.pc++;
@@ -1436,7 +1650,10 @@ extern "C" void scu_dsp_jit_set_program_control(u32 val)
    cxt.control = (cxt.control & 0x00FC0000) | (val & 0x060380FF);
 
    if (cxt.control & CONTROL_LE)
+   {
       cxt.pc = cxt.control & 0xFF;
+      cxt.tail_steps = 0;
+   }
 }
 
 extern "C" u32 scu_dsp_jit_get_program_control()
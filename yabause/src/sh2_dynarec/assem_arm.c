@@ -2084,6 +2084,12 @@ void emit_writeword(int rt, int addr)
   assem_debug("str %s,fp+%d\n",regname[rt],offset);
   output_w32(0xe5800000|rd_rn_rm(rt,FP,0)|offset);
 }
+void emit_subfrommem(int addr,int r)
+{
+  emit_readword(addr,HOST_TEMPREG);
+  emit_sub(HOST_TEMPREG,r,HOST_TEMPREG);
+  emit_writeword(HOST_TEMPREG,addr);
+}
 void emit_writehword(int rt, int addr)
 {
   u32 offset = addr-(u32)&dynarec_local;
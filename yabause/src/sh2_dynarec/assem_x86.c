@@ -31,6 +31,8 @@ int slave_reg[22];
 int slave_cc; // Cycle count
 int slave_pc; // Virtual PC
 void * slave_ip; // Translated PC
+int master_idle_cc; // Cycles skipped in idle loops
+int slave_idle_cc;
 
 void FASTCALL WriteInvalidateLong(u32 addr, u32 val);
 void FASTCALL WriteInvalidateWord(u32 addr, u32 val);
@@ -2470,6 +2472,21 @@ void emit_subfrommem(int addr,int r)
   output_w32((int)addr);
 }
 
+// Increment a 64-bit counter in memory, used by the profiler
+void emit_incmem64(int addr)
+{
+  assem_debug("add $1,%x\n",addr);
+  output_byte(0x83);
+  output_modrm(0,5,0);
+  output_w32((int)addr);
+  output_byte(1);
+  assem_debug("adc $0,%x\n",addr+4);
+  output_byte(0x83);
+  output_modrm(0,5,2);
+  output_w32((int)addr+4);
+  output_byte(0);
+}
+
 void emit_flds(int r)
 {
   assem_debug("flds (%%%s)\n",regname[r]);
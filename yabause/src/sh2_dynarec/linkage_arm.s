@@ -38,6 +38,8 @@
 	.global	slave_cc
 	.global	slave_pc
 	.global	slave_ip
+	.global	master_idle_cc
+	.global	slave_idle_cc
 	.global	mini_ht_master
 	.global	mini_ht_slave
 	.global	restore_candidate
@@ -53,7 +55,7 @@ sh2_dynarec_target:
 	.type	dynarec_local, %object
 	.size	dynarec_local, 64
 dynarec_local:
-	.space	64+88+12+88+12+28+256+256+512+4194304
+	.space	64+88+12+88+12+28+8+256+256+512+4194304
 master_reg = dynarec_local + 64
 	.type	master_reg, %object
 	.size	master_reg, 88
@@ -100,8 +102,14 @@ scucycles = sh2cycles + 4
 rccount = scucycles + 4
 	.type	rccount, %object
 	.size	rccount, 4
+master_idle_cc = rccount + 4
+	.type	master_idle_cc, %object
+	.size	master_idle_cc, 4
+slave_idle_cc = master_idle_cc + 4
+	.type	slave_idle_cc, %object
+	.size	slave_idle_cc, 4
 
-mini_ht_master = rccount + 4
+mini_ht_master = slave_idle_cc + 4
 	.type	mini_ht_master, %object
 	.size	mini_ht_master, 256
 mini_ht_slave = mini_ht_master + 256
@@ -28,6 +28,7 @@
 
 #include "../memory.h"
 #include "../sh2core.h"
+#include "../sh2idle.h"
 #include "../yabause.h"
 #include "sh2_dynarec.h"
 
@@ -93,6 +94,7 @@ struct ll_entry
   u32 ba[MAXBLOCK];
   char is_ds[MAXBLOCK];
   char ooo[MAXBLOCK];
+  char idle_loop[MAXBLOCK];
   u64 unneeded_reg[MAXBLOCK];
   u64 branch_unneeded_reg[MAXBLOCK];
   signed char regmap_pre[MAXBLOCK][HOST_REGS];
@@ -131,6 +133,29 @@ struct ll_entry
   u32 recent_write_index=0;
   unsigned int slave;
   u32 invalidate_count;
+#ifdef DYNAREC_PROFILE
+  // Every straight-line run of translated code counts how many times it
+  // runs, each compile of a block owns a range of these counters
+  #define PROFILE_COUNTERS 1048576
+  #define PROFILE_BLOCKS 131072
+  struct profile_block
+  {
+    u32 vaddr; // Block start, bit 0 set for the slave
+    u32 counter; // First counter
+    u32 counters;
+    u32 compiled; // Compiled since the last reset
+    u64 compile_ticks;
+  };
+  u64 profile_count[PROFILE_COUNTERS];
+  u16 profile_cycles[PROFILE_COUNTERS]; // Cycles of the run of code
+  u32 profile_counter_count;
+  struct profile_block profile_blocks[PROFILE_BLOCKS];
+  struct profile_block *profile_current;
+  u32 profile_block_count;
+  u32 profile_invalidations[2048]; // Invalidations of compiled code per page
+  u32 profile_compiles;
+  u64 profile_compile_ticks;
+#endif
   extern int master_reg[22];
   extern int master_cc;
   extern int master_pc; // Virtual PC
@@ -139,6 +164,8 @@ struct ll_entry
   extern int slave_cc;
   extern int slave_pc; // Virtual PC
   extern void * slave_ip; // Translated PC
+  extern int master_idle_cc; // Cycles skipped in idle loops
+  extern int slave_idle_cc;
   extern u8 restore_candidate[512];
 
   /* registers that may be allocated */
@@ -932,6 +959,9 @@ void invalidate_blocks(u32 firstblock,u32 lastblock)
   }
   //printf("first=%d last=%d\n",first,last);
   while(first<=last) {
+    #ifdef DYNAREC_PROFILE
+    if(jump_in[first]) profile_invalidations[first]++;
+    #endif
     invalidate_page(first);
     first++;
   }
@@ -3559,6 +3589,14 @@ void ds_assemble_entry(int i)
   emit_jmp(0);
 }
 
+// Idle loop: count the rest of the time slice as skipped and make the
+// next cycle check end it
+void do_idle(int cc)
+{
+  emit_subfrommem(slave?(int)&slave_idle_cc:(int)&master_idle_cc,cc);
+  emit_andimm(cc,3,cc);
+}
+
 void do_cc(int i,signed char i_regmap[],int *adj,int addr,int taken,int invert)
 {
   int count;
@@ -3582,13 +3620,12 @@ void do_cc(int i,signed char i_regmap[],int *adj,int addr,int taken,int invert)
   if(itype[i]==CJUMP) *adj-=2+cycles[i]; // Two extra cycles for taken BT/BF
   if(itype[i]==SJUMP) *adj-=1+cycles[i]+cycles[i+1]; // One extra cycle for taken BT/BF with delay slot
   count=ccadj[i]+((taken==NODS)?0:cycles[i]+cycles[i+1]);
-  if(taken==TAKEN && i==(ba[i]-start)>>1 && source[i+1]==0) {
+  if(taken==TAKEN && idle_loop[i]) {
     // Idle loop
     // FIXME
     //if(count&1) emit_addimm_and_set_flags(2*(count+2),HOST_CCREG);
     idle=(int)out;
-    //emit_subfrommem(&idlecount,HOST_CCREG); // Count idle cycles
-    emit_andimm(HOST_CCREG,3,HOST_CCREG);
+    do_idle(HOST_CCREG);
     jaddr=(int)out;
     emit_jmp(0);
   }
@@ -3722,7 +3759,7 @@ void ujump_assemble(int i,struct regstat *i_regs)
   u64 bc_unneeded;
   int cc,adj;
   signed char *i_regmap=i_regs->regmap;
-  if(i==(ba[i]-start)>>1) assem_debug("idle loop\n");
+  if(idle_loop[i]) assem_debug("idle loop\n");
   address_generation(i+1,i_regs,regs[i].regmap_entry);
   #ifdef REG_PREFETCH
   int temp=get_reg(branch_regs[i].regmap,PTEMP);
@@ -4060,8 +4097,8 @@ void cjump_assemble(int i,struct regstat *i_regs)
   match=match_bt(regs[i].regmap,regs[i].dirty,ba[i]);
   assem_debug("match=%d\n",match);
   internal=internal_branch(ba[i]);
-  if(i==(ba[i]-start)>>1) assem_debug("idle loop\n");
-  if(!match) invert=1;
+  if(idle_loop[i]) assem_debug("idle loop\n");
+  if(!match||idle_loop[i]) invert=1;
   #ifdef CORTEX_A8_BRANCH_PREDICTION_HACK
   if(i>(ba[i]-start)>>1) invert=1;
   #endif
@@ -4129,6 +4166,7 @@ void cjump_assemble(int i,struct regstat *i_regs)
     }
     if(invert) {
       if(taken) set_jump_target(taken,(pointer)out);
+      if(idle_loop[i]) do_idle(cc);
       #ifdef CORTEX_A8_BRANCH_PREDICTION_HACK
       if(match&&(!internal||!is_ds[(ba[i]-start)>>1])) {
         if(adj) {
@@ -4178,8 +4216,8 @@ void sjump_assemble(int i,struct regstat *i_regs)
   match=match_bt(branch_regs[i].regmap,branch_regs[i].dirty,ba[i]);
   assem_debug("match=%d\n",match);
   internal=internal_branch(ba[i]);
-  if(i==(ba[i]-start)>>1) assem_debug("idle loop\n");
-  if(!match) invert=1;
+  if(idle_loop[i]) assem_debug("idle loop\n");
+  if(!match||idle_loop[i]) invert=1;
   #ifdef CORTEX_A8_BRANCH_PREDICTION_HACK
   if(i>(ba[i]-start)>>1) invert=1;
   #endif
@@ -4268,6 +4306,7 @@ void sjump_assemble(int i,struct regstat *i_regs)
       }
       if(invert) {
         if(taken) set_jump_target(taken,(pointer)out);
+        if(idle_loop[i]) do_idle(cc);
         #ifdef CORTEX_A8_BRANCH_PREDICTION_HACK
         if(match&&(!internal||!is_ds[(ba[i]-start)>>1])) {
           if(adj) {
@@ -4352,6 +4391,7 @@ void sjump_assemble(int i,struct regstat *i_regs)
       store_regs_bt(branch_regs[i].regmap,branch_regs[i].dirty,ba[i]);
       //do_cc(i,i_regmap,&adj,ba[i],TAKEN,0);
       assem_debug("cycle count (adj)\n");
+      if(idle_loop[i]) do_idle(cc);
       /*if(adj)*/ //emit_addimm(cc,CLOCK_DIVIDER*(ccadj[i]+cycles[i]+cycles[i+1]-adj),cc);
       if(adj) emit_addimm(cc,-CLOCK_DIVIDER*adj,cc);
       load_regs_bt(branch_regs[i].regmap,branch_regs[i].dirty,ba[i]);
@@ -5322,6 +5362,53 @@ void sh2_dynarec_cleanup()
   for(n=0;n<2048;n++) ll_clear(jump_dirty+n);
 }
 
+#ifdef DYNAREC_PROFILE
+#ifdef __arm__
+#error "The dynarec profiler is only implemented for x86 and x86-64 hosts"
+#endif
+void profile_begin_block()
+{
+  if(profile_block_count>=PROFILE_BLOCKS) {
+    profile_current=NULL;
+    return;
+  }
+  profile_current=&profile_blocks[profile_block_count];
+  profile_current->vaddr=start+slave;
+  profile_current->counter=profile_counter_count;
+}
+
+// Count executions of the code from instruction i up to the next branch
+// or branch target
+void profile_run(int i)
+{
+  int run_cycles=0;
+  if(!profile_current||profile_counter_count>=PROFILE_COUNTERS) return;
+  do {
+    run_cycles+=cycles[i];
+    if(itype[i]==UJUMP||itype[i]==RJUMP||itype[i]==SJUMP) {
+      run_cycles+=cycles[i+1]; // Delay slot
+      break;
+    }
+    if(itype[i]==CJUMP) break;
+    i++;
+  } while(i<slen&&!bt[i]);
+  profile_cycles[profile_counter_count]=run_cycles;
+  emit_incmem64((int)&profile_count[profile_counter_count]);
+  profile_counter_count++;
+}
+
+void profile_end_block(u64 ticks)
+{
+  profile_compiles++;
+  profile_compile_ticks+=ticks;
+  if(!profile_current) return;
+  profile_current->counters=profile_counter_count-profile_current->counter;
+  profile_current->compiled=1;
+  profile_current->compile_ticks=ticks;
+  profile_block_count++;
+}
+#endif
+
 int sh2_recompile_block(int addr)
 {
   pointer beginning;
@@ -5335,6 +5422,9 @@ int sh2_recompile_block(int addr)
   u32 p_constmap[SH2_REGS];
   u32 p_isconst=0;
   int cached_addr;
+  #ifdef DYNAREC_PROFILE
+  u64 compile_start=YabauseGetTicks();
+  #endif
 
   //if(Count==365117028) tracedebug=1;
   assem_debug("NOTCOMPILED: addr = %x -> %x\n", (int)addr, (int)out);
@@ -6126,6 +6216,23 @@ int sh2_recompile_block(int addr)
     }
   }
 
+  // Flag idle loops, backward branches over code that doesn't write
+  // memory or depend on the previous time round
+  for(i=0;i<slen;i++)
+  {
+    idle_loop[i]=0;
+    if(itype[i]==CJUMP||itype[i]==SJUMP||(itype[i]==UJUMP&&rt1[i]!=PR))
+    {
+      if(ba[i]>=start && ba[i]<=start+i*2 && i<slen-1) {
+        int t=(ba[i]-start)>>1;
+        int end=(itype[i]==CJUMP)?i:i+1;
+        // Can't be entered other than from the top
+        for(j=t+1;j<=end;j++) if(bt[j]) break;
+        if(j>end) idle_loop[i]=SH2idleLoopCheck(source+t,i-t+1);
+      }
+    }
+  }
+
   // Do constant propagation
   p_isconst=0;
   for(i=0;i<slen;i++)
@@ -7806,6 +7913,9 @@ int sh2_recompile_block(int addr)
   linkcount=0;stubcount=0;
   ds=0;is_delayslot=0;
   beginning=(pointer)out;
+  #ifdef DYNAREC_PROFILE
+  profile_begin_block();
+  #endif
   for(i=0;i<slen;i++)
   {
     //if(ds) printf("ds: ");
@@ -7834,6 +7944,10 @@ int sh2_recompile_block(int addr)
       // branch target entry point
       instr_addr[i]=(pointer)out;
       assem_debug("<->\n");
+      #ifdef DYNAREC_PROFILE
+      if(i==0||bt[i]||itype[i-1]==CJUMP||(i>1&&itype[i-2]==SJUMP))
+        profile_run(i);
+      #endif
       // load regs
       if(regs[i].regmap_entry[HOST_CCREG]==CCREG&&regs[i].regmap[HOST_CCREG]!=CCREG)
         wb_register(CCREG,regs[i].regmap_entry,regs[i].wasdirty);
@@ -8163,6 +8277,9 @@ int sh2_recompile_block(int addr)
     expirep=(expirep+1)&65535;
   }
   }
+  #ifdef DYNAREC_PROFILE
+  profile_end_block(YabauseGetTicks()-compile_start);
+  #endif
   return 0;
 }
 
@@ -8210,6 +8327,135 @@ void DynarecSlaveHandleInterrupts()
   //printf("master_cc=%d slave_cc=%d\n",master_cc,slave_cc);
 }
 
+// Translated idle loops count the cycles they skip in 32 bits, move them
+// over once a frame before they can wrap
+void sh2_dynarec_count_idle()
+{
+  MSH2->idleCycles += (u32)master_idle_cc / CLOCK_DIVIDER;
+  SSH2->idleCycles += (u32)slave_idle_cc / CLOCK_DIVIDER;
+  master_idle_cc = slave_idle_cc = 0;
+}
+
+#ifdef DYNAREC_PROFILE
+struct profile_summary
+{
+  u32 vaddr;
+  u32 compiles;
+  u64 runs;
+  u64 cycles;
+  u64 compile_ticks;
+};
+
+static int profile_cmp_vaddr(const void *a,const void *b)
+{
+  const struct profile_block *pa=a;
+  const struct profile_block *pb=b;
+  if(pa->vaddr!=pb->vaddr) return pa->vaddr<pb->vaddr?-1:1;
+  return pa->counter<pb->counter?-1:pa->counter>pb->counter;
+}
+
+static int profile_cmp_cycles(const void *a,const void *b)
+{
+  const struct profile_summary *pa=a;
+  const struct profile_summary *pb=b;
+  if(pa->cycles!=pb->cycles) return pa->cycles>pb->cycles?-1:1;
+  return pa->compiles>pb->compiles?-1:pa->compiles<pb->compiles;
+}
+
+static int profile_cmp_invalidations(const void *a,const void *b)
+{
+  u32 pa=profile_invalidations[*(const u32 *)a];
+  u32 pb=profile_invalidations[*(const u32 *)b];
+  return pa>pb?-1:pa<pb;
+}
+
+// Print the blocks that ran the most cycles, how often each was compiled
+// and the pages whose code was overwritten the most
+void sh2_dynarec_profile_report()
+{
+  struct profile_block *blocks;
+  struct profile_summary *summary;
+  u32 pages[2048];
+  u64 total_cycles=0;
+  u32 count=0;
+  u32 i,j;
+
+  blocks=malloc(profile_block_count*sizeof(struct profile_block)+1);
+  summary=malloc(profile_block_count*sizeof(struct profile_summary)+1);
+  if(!blocks||!summary) {
+    free(blocks);
+    free(summary);
+    return;
+  }
+
+  // Merge every compile of the same address
+  memcpy(blocks,profile_blocks,profile_block_count*sizeof(struct profile_block));
+  qsort(blocks,profile_block_count,sizeof(struct profile_block),profile_cmp_vaddr);
+  for(i=0;i<profile_block_count;i++) {
+    if(!count||summary[count-1].vaddr!=blocks[i].vaddr) {
+      memset(&summary[count],0,sizeof(struct profile_summary));
+      summary[count++].vaddr=blocks[i].vaddr;
+    }
+    summary[count-1].compiles+=blocks[i].compiled;
+    summary[count-1].compile_ticks+=blocks[i].compile_ticks;
+    if(blocks[i].counters) summary[count-1].runs+=profile_count[blocks[i].counter];
+    for(j=blocks[i].counter;j<blocks[i].counter+blocks[i].counters;j++)
+      summary[count-1].cycles+=profile_count[j]*profile_cycles[j];
+  }
+  for(i=0;i<count;i++) total_cycles+=summary[i].cycles;
+  qsort(summary,count,sizeof(struct profile_summary),profile_cmp_cycles);
+
+  printf("SH2 dynarec profile: %u compiles of %u blocks, %.1f ms compiling\n",
+         profile_compiles,count,yabsys.tickfreq?(double)profile_compile_ticks*1000/yabsys.tickfreq:0.0);
+  if(profile_block_count>=PROFILE_BLOCKS||profile_counter_count>=PROFILE_COUNTERS)
+    printf("Profile buffers full, later blocks were not counted, reset the profile to count them\n");
+  printf("   address  cpu       runs         cycles       %%  compiles  compile ms\n");
+  for(i=0;i<count&&i<50;i++) {
+    printf("  %08x  %s %10llu %14llu  %5.1f%%  %8u  %10.2f\n",
+           summary[i].vaddr&~1,summary[i].vaddr&1?"ssh2":"msh2",
+           (unsigned long long)summary[i].runs,(unsigned long long)summary[i].cycles,
+           total_cycles?(double)summary[i].cycles*100/total_cycles:0.0,summary[i].compiles,
+           yabsys.tickfreq?(double)summary[i].compile_ticks*1000/yabsys.tickfreq:0.0);
+  }
+
+  // Pages 0-1023 are the BIOS and low work RAM, 1024-2047 high work RAM
+  for(i=0;i<2048;i++) pages[i]=i;
+  qsort(pages,2048,sizeof(u32),profile_cmp_invalidations);
+  printf("Most invalidated pages:\n");
+  for(i=0;i<20&&profile_invalidations[pages[i]];i++) {
+    printf("  %08x  %u\n",pages[i]<1024?pages[i]<<12:0x06000000+((pages[i]&1023)<<12),
+           profile_invalidations[pages[i]]);
+  }
+
+  free(blocks);
+  free(summary);
+}
+
+// Throw away all translated code, since it increments the counters of the
+// compile it came from, and start counting from scratch. Dirty blocks are
+// dropped too so they can't be restored with their old counters.
+void sh2_dynarec_profile_reset()
+{
+  int n;
+  invalidate_all_pages();
+  for(n=0;n<2048;n++) ll_clear(jump_in+n);
+  for(n=0;n<2048;n++) ll_clear(jump_out+n);
+  for(n=0;n<2048;n++) ll_clear(jump_dirty+n);
+  for(n=0;n<65536;n++)
+    hash_table[n][0]=hash_table[n][2]=-1;
+  memset(restore_candidate,0,sizeof(restore_candidate));
+  memset(cached_code,0,sizeof(cached_code));
+
+  memset(profile_count,0,sizeof(profile_count));
+  memset(profile_invalidations,0,sizeof(profile_invalidations));
+  profile_counter_count=0;
+  profile_block_count=0;
+  profile_current=NULL;
+  profile_compiles=0;
+  profile_compile_ticks=0;
+}
+#endif
+
 void SH2InterpreterSendInterrupt(SH2_struct *context, u8 level, u8 vector);
 int SH2InterpreterGetInterrupts(SH2_struct *context,
                                 interrupt_struct interrupts[MAX_INTERRUPTS]);
@@ -8219,6 +8465,9 @@ void SH2InterpreterSetInterrupts(SH2_struct *context, int num_interrupts,
 int SH2DynarecInit(enum SHMODELTYPE model, SH2_struct *msh, SH2_struct *ssh) {return 0;}
 
 void SH2DynarecDeInit() {
+  #ifdef DYNAREC_PROFILE
+  sh2_dynarec_profile_report();
+  #endif
   sh2_dynarec_cleanup();
 }
    
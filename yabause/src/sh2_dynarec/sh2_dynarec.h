@@ -8,5 +8,10 @@ int verify_dirty(pointer addr);
 void invalidate_all_pages(void);
 
 void YabauseDynarecOneFrameExec(int, int);
+void sh2_dynarec_count_idle(void);
+#ifdef DYNAREC_PROFILE
+void sh2_dynarec_profile_report(void);
+void sh2_dynarec_profile_reset(void);
+#endif
 
 #endif
@@ -43,9 +43,9 @@ extern "C"
       SH2CORE_JIT,
       "SH Jit",
 
-      SH2InterpreterInit,
-      SH2InterpreterDeInit,
-      SH2InterpreterReset,
+      SH2JitInit,
+      SH2JitDeInit,
+      SH2JitReset,
       SH2JitExec,
 
       SH2JitGetRegisters,
@@ -72,7 +72,7 @@ extern "C"
       SH2InterpreterGetInterrupts,
       SH2InterpreterSetInterrupts,
 
-      NULL  // SH2WriteNotify not used
+      SH2JitWriteNotify
    };
 }
 
@@ -84,30 +84,79 @@ extern "C"
 #define SH1_ROM_SIZE 0x10000
 #define MAX_SH1_BLOCKS (SH1_ROM_SIZE / 2)
 
+// SH2 blocks are looked up through a page table covering the 512 MB
+// physical space (cache-through mirrors fold onto the cached addresses)
+#define SH2_JIT_PAGE_SHIFT 12
+#define SH2_JIT_PAGE_SIZE (1 << SH2_JIT_PAGE_SHIFT)
+#define SH2_JIT_NUM_PAGES (0x20000000 >> SH2_JIT_PAGE_SHIFT)
+#define SH2_JIT_LINE_SHIFT 5
+#define SH2_JIT_LINES_PER_PAGE (SH2_JIT_PAGE_SIZE >> SH2_JIT_LINE_SHIFT)
+#define SH2_JIT_MAX_BLOCK_INSTRUCTIONS 256
+
+#include <algorithm>
+#include <vector>
+
 #include "MemStream.h"
 #include "MemoryFunction.h"
 #include "Jitter_CodeGenFactory.h"
 #include "Jitter.h"
 #include "offsetof_def.h"
 
+#define MAX_BLOCK_LINKS 2
+
 struct ShCodeBlock
 {
    int dirty;
    CMemoryFunction function;
    u32 start_pc;
    u32 end_pc;
+   u32 phys_start;
+   u32 phys_end;
+   // static successors (branch target / fall through) and the blocks they
+   // resolved to, followed by the dispatcher without a table lookup
+   u32 link_pc[MAX_BLOCK_LINKS];
+   ShCodeBlock *link[MAX_BLOCK_LINKS];
+   std::vector<ShCodeBlock *> incoming;
+   // the block branches back to its own start and nothing in it changes
+   // from one time round to the next, see SH2idleLoopCheck
+   int idle;
 }code_blocks[MAX_SH1_BLOCKS];
 
+struct ShBlockPage
+{
+   ShCodeBlock *blocks[SH2_JIT_PAGE_SIZE / 2];
+   u32 num_blocks;
+   u8 code_lines[SH2_JIT_LINES_PER_PAGE];
+};
+
+static ShBlockPage *sh2_block_pages[SH2_JIT_NUM_PAGES];
+
+// Invalidated blocks can still be on the host stack (a block may overwrite
+// its own code), so they are only freed once control is back in SH2JitExec
+static std::vector<ShCodeBlock *> retired_blocks;
+
 static Jitter::CJitter jit(Jitter::CreateCodeGen());
 
 u32 basic_block = 0;
+static enum SHMODELTYPE compile_model = SHMT_SH1;
+static u32 block_exits[MAX_BLOCK_LINKS];
+static int num_block_exits = 0;
+
+static void add_block_exit(u32 pc)
+{
+   if (num_block_exits < MAX_BLOCK_LINKS)
+      block_exits[num_block_exits++] = pc;
+}
 
 typedef void (FASTCALL *jit_opcode_func)(u16 instruction, u32 recompile_addr);
 static jit_opcode_func decode(enum SHMODELTYPE model, u16 instruction);
 
+static void emit_interpreter_fallback(u16 instruction);
+
 static void FASTCALL SH2undecoded(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   // Lets the interpreter raise the exception (or handle the bios call)
+   emit_interpreter_fallback(instruction);
 }
 
 static void add_cycles(u32 cycles_to_add)
@@ -117,8 +166,11 @@ static void add_cycles(u32 cycles_to_add)
    jit.Add();
    jit.PullRel(offsetof(Sh2JitContext, cycles));
 
-   jit.PushCst(cycles_to_add);
-   jit.Call(reinterpret_cast<void*>(&sh1_dma_exec), 1, Jitter::CJitter::RETURN_VALUE_NONE);
+   if (compile_model == SHMT_SH1)
+   {
+      jit.PushCst(cycles_to_add);
+      jit.Call(reinterpret_cast<void*>(&sh1_dma_exec), 1, Jitter::CJitter::RETURN_VALUE_NONE);
+   }
 }
 
 static void increment_pc()
@@ -131,36 +183,69 @@ static void increment_pc()
 
 SH2_struct *current;
 
+static INLINE u32 sh2_jit_phys_addr(u32 addr)
+{
+   addr &= 0x1FFFFFFF;
+
+   if ((addr & 0x1E000000) == 0x06000000) // High Work Ram and its mirrors
+      return 0x06000000 | (addr & 0xFFFFF);
+   if ((addr & 0x1FF00000) == 0x00000000) // Bios
+      return addr & 0x7FFFF;
+
+   return addr;
+}
+
+static void sh2_jit_invalidate_range(u32 start, u32 length);
+
+static INLINE void sh2_jit_check_write(u32 addr, u32 size)
+{
+   ShBlockPage *page;
+   u32 phys;
+
+   // Only the cached and cache-through areas can hold translated code
+   if (current->model != SHMT_SH2 || (addr & 0xC0000000))
+      return;
+
+   phys = sh2_jit_phys_addr(addr);
+   page = sh2_block_pages[phys >> SH2_JIT_PAGE_SHIFT];
+
+   if (page && page->code_lines[(phys & (SH2_JIT_PAGE_SIZE - 1)) >> SH2_JIT_LINE_SHIFT])
+      sh2_jit_invalidate_range(phys, size);
+}
+
 void mapped_memory_write_byte(u32 addr, u32 data)
 {
-   current->MappedMemoryWriteByte(current, addr, data);
+   SH2MemoryWriteByte(current, addr, data);
+   sh2_jit_check_write(addr, 1);
 }
 
 void mapped_memory_write_word(u32 addr, u32 data)
 {
-   current->MappedMemoryWriteWord(current, addr, data);
+   SH2MemoryWriteWord(current, addr, data);
+   sh2_jit_check_write(addr, 2);
 }
 
 void mapped_memory_write_long(u32 addr, u32 data)
 {
-   current->MappedMemoryWriteLong(current, addr, data);
+   SH2MemoryWriteLong(current, addr, data);
+   sh2_jit_check_write(addr, 4);
 }
 
 u32 mapped_memory_read_byte(u32 addr)
 {
-   u8 val = current->MappedMemoryReadByte(current, addr);
+   u8 val = SH2MemoryReadByte(current, addr);
    return val;
 }
 
 u32 mapped_memory_read_word(u32 addr)
 {
-   u16 val = current->MappedMemoryReadWord(current, addr);
+   u16 val = SH2MemoryReadWord(current, addr);
    return val;
 }
 
 u32 mapped_memory_read_long(u32 addr)
 {
-   u32 val = current->MappedMemoryReadLong(current, addr);
+   u32 val = SH2MemoryReadLong(current, addr);
    return val;
 }
 
@@ -178,15 +263,74 @@ static void FASTCALL SH2div0u(u16 instruction, u32 recompile_addr)
    add_cycles(1);
 }
 
+static u16 fetch_instruction(SH2_struct *context, u32 addr)
+{
+   if (yabsys.sh2_cache_enabled && (addr & 0xC0000000) == 0xC0000000)
+      return DataArrayReadWord(context, addr);
+
+   return ((fetchfunc *)context->fetchlist)[(addr >> 20) & 0x0FF](context, addr);
+}
+
 void recompile_sh2_instruction(u32 recompile_addr)
 {
-   u16 instruction = ((fetchfunc *)current->fetchlist)[(recompile_addr >> 20) & 0x0FF](current, recompile_addr);
+   u16 instruction = fetch_instruction(current, recompile_addr);
 
-   jit_opcode_func func = decode(SHMT_SH1, instruction);
+   jit_opcode_func func = decode(compile_model, instruction);
 
    func(instruction, recompile_addr);
 }
 
+//Instructions without a native translation are run through the
+//interpreter's opcode table on a copy of the jit registers
+static void interpreter_fallback(u32 instruction)
+{
+   Sh2JitContext *ctx = &current->jit;
+   u32 cycles = current->cycles;
+   s32 cycles_diff;
+
+   for (int i = 0; i < 16; i++)
+      current->regs.R[i] = ctx->r[i];
+
+   current->regs.SR.all = ctx->sr;
+   current->regs.GBR = ctx->gbr;
+   current->regs.VBR = ctx->vbr;
+   current->regs.MACH = ctx->mach;
+   current->regs.MACL = ctx->macl;
+   current->regs.PR = ctx->pr;
+   current->regs.PC = ctx->pc;
+
+   current->cycles = 0;
+   current->instruction = instruction;
+   ((opcodefunc *)current->opcodes)[instruction](current);
+   cycles_diff = current->cycles;
+   current->cycles = cycles;
+
+   for (int i = 0; i < 16; i++)
+      ctx->r[i] = current->regs.R[i];
+
+   ctx->sr = current->regs.SR.all;
+   ctx->gbr = current->regs.GBR;
+   ctx->vbr = current->regs.VBR;
+   ctx->mach = current->regs.MACH;
+   ctx->macl = current->regs.MACL;
+   ctx->pr = current->regs.PR;
+   ctx->pc = current->regs.PC;
+   ctx->cycles += cycles_diff;
+
+   if (current->model == SHMT_SH1)
+      sh1_dma_exec(cycles_diff);
+}
+
+//the jitter propagates constants across calls, so the block has to end
+//here since the interpreter changes the context behind its back
+static void emit_interpreter_fallback(u16 instruction)
+{
+   jit.PushCst(instruction);
+   jit.Call(reinterpret_cast<void*>(&interpreter_fallback), 1, Jitter::CJitter::RETURN_VALUE_NONE);
+
+   basic_block = 1;
+}
+
 void SH2delay(u32 recompile_addr)
 {
    recompile_sh2_instruction(recompile_addr);
@@ -289,10 +433,12 @@ static void FASTCALL SH2sett(u16 instruction, u32 recompile_addr)
    add_cycles(1);
 }
 
-//needs special handling probably
+//pc is left on the sleep so it is executed again until an interrupt
 static void FASTCALL SH2sleep(u16 instruction, u32 recompile_addr)
 {
    add_cycles(3);
+
+   basic_block = 1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -994,7 +1140,7 @@ static void FASTCALL SH2ldcmgbr(u16 instruction, u32 recompile_addr)
 
 static void FASTCALL SH2ldcmvbr(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   SH2ldcmgbr_template(instruction, 0);
 }
 
 static void FASTCALL SH2ldsmach(u16 instruction, u32 recompile_addr)
@@ -1587,22 +1733,22 @@ static void FASTCALL SH2cmpstr(u16 instruction, u32 recompile_addr)
 
 static void FASTCALL SH2div1(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   emit_interpreter_fallback(instruction);
 }
 
 static void FASTCALL SH2div0s(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   emit_interpreter_fallback(instruction);
 }
 
 static void FASTCALL SH2dmuls(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   emit_interpreter_fallback(instruction);
 }
 
 static void FASTCALL SH2dmulu(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   emit_interpreter_fallback(instruction);
 }
 
 static void FASTCALL SH2ext(u16 instruction, u32 is_unsigned, u32 is_word)
@@ -1657,22 +1803,22 @@ static void FASTCALL SH2extuw(u16 instruction, u32 recompile_addr)
 
 static void FASTCALL SH2macw(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   emit_interpreter_fallback(instruction);
 }
 
 static void FASTCALL SH2macl(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   emit_interpreter_fallback(instruction);
 }
 
 static void FASTCALL SH2mull(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   emit_interpreter_fallback(instruction);
 }
 
 static void FASTCALL SH2muls(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   emit_interpreter_fallback(instruction);
 }
 
 static void FASTCALL SH2mulu(u16 instruction, u32 recompile_addr)
@@ -1704,7 +1850,7 @@ static void FASTCALL SH2neg(u16 instruction, u32 recompile_addr)
 
 static void FASTCALL SH2negc(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   emit_interpreter_fallback(instruction);
 }
 
 static void FASTCALL SH2sub(u16 instruction, u32 recompile_addr)
@@ -1771,7 +1917,7 @@ static void FASTCALL SH2subc(u16 instruction, u32 recompile_addr)
 
 static void FASTCALL SH2subv(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   emit_interpreter_fallback(instruction);
 }
 
 #define ALU_AND 0
@@ -2049,10 +2195,13 @@ static void FASTCALL SH2mova(u16 instruction, u32 recompile_addr)
    add_cycles(1);
 }
 
-static void FASTCALL SH2bf_template(u16 instruction, u32 is_bt)
+static void FASTCALL SH2bf_template(u16 instruction, u32 is_bt, u32 recompile_addr)
 {
    s32 disp = (((s32)(s8)instruction) * 2) + 4;
 
+   add_block_exit(recompile_addr + disp);
+   add_block_exit(recompile_addr + 2);
+
    jit.PushRel(offsetof(Sh2JitContext, sr));
    jit.PushCst(SR_T);
    jit.And();
@@ -2078,13 +2227,16 @@ static void FASTCALL SH2bf_template(u16 instruction, u32 is_bt)
 
 static void FASTCALL SH2bf(u16 instruction, u32 recompile_addr)
 {
-   SH2bf_template(instruction, 0);
+   SH2bf_template(instruction, 0, recompile_addr);
 }
 
 static void FASTCALL SH2bfs_template(u16 instruction, int is_bts, u32 recompile_addr)
 {
    s32 disp = (s32)(s8)instruction;
 
+   add_block_exit(recompile_addr + (disp * 2) + 4);
+   add_block_exit(recompile_addr + 2);
+
    jit.PushRel(offsetof(Sh2JitContext, sr));
    jit.PushCst(SR_T);
    jit.And();
@@ -2121,7 +2273,7 @@ static void FASTCALL SH2bfs(u16 instruction, u32 recompile_addr)
 
 static void FASTCALL SH2bt(u16 instruction, u32 recompile_addr)
 {
-   SH2bf_template(instruction, 1);
+   SH2bf_template(instruction, 1, recompile_addr);
 }
 
 static void FASTCALL SH2bts(u16 instruction, u32 recompile_addr)
@@ -2158,6 +2310,8 @@ static void FASTCALL SH2bra(u16 instruction, u32 recompile_addr)
 
    disp = sign_extend_12(disp);
 
+   add_block_exit(recompile_addr + (disp * 2) + 4);
+
    pc_add_bra_disp(disp);
 
    add_cycles(2);
@@ -2172,6 +2326,8 @@ static void FASTCALL SH2bsr(u16 instruction, u32 recompile_addr)
 
    disp = sign_extend_12(disp);
 
+   add_block_exit(recompile_addr + (disp * 2) + 4);
+
    jit.PushRel(offsetof(Sh2JitContext, pc));
    jit.PushCst(4);
    jit.Add();
@@ -2734,54 +2890,407 @@ static INLINE void SH2HandleInterrupts(SH2_struct *context)
    }
 }
 
-void recompile_and_exec(SH2_struct *context)
+static void compile_block(SH2_struct *context, ShCodeBlock *block)
 {
-   assert((context->jit.pc & 0xfff00000) == 0);
+   Framework::CMemStream stream;
+   stream.Seek(0, Framework::STREAM_SEEK_DIRECTION::STREAM_SEEK_SET);
+   jit.SetStream(&stream);
+   jit.Begin();
+   basic_block = 0;
+   num_block_exits = 0;
+   compile_model = context->model;
+   u32 current_pc = context->jit.pc;
+   block->start_pc = current_pc;
+   for (int count = 1;; count++)
+   {
+      u16 instr = context->instruction = fetch_instruction(context, current_pc);
+      jit_opcode_func func = decode(compile_model, instr);
+
+      func(instr, current_pc);
+
+      if (basic_block)
+         break;
+
+      //keep blocks inside one page so invalidation only has to look back one page
+      if (count >= SH2_JIT_MAX_BLOCK_INSTRUCTIONS ||
+         ((current_pc + 2) & (SH2_JIT_PAGE_SIZE - 1)) == 0)
+      {
+         add_block_exit(current_pc + 2);
+         break;
+      }
+
+      current_pc += 2;
+   }
+
+   jit.End();
+
+   block->function = CMemoryFunction(stream.GetBuffer(), stream.GetSize());
+   block->end_pc = current_pc;
+
+   for (int i = 0; i < MAX_BLOCK_LINKS; i++)
+   {
+      block->link_pc[i] = i < num_block_exits ? block_exits[i] : 0xFFFFFFFF;
+      block->link[i] = NULL;
+   }
 
-   if (code_blocks[context->jit.pc / 2].function.IsEmpty())
+   block->idle = 0;
+
+   for (int i = 0; i < num_block_exits && compile_model == SHMT_SH2; i++)
    {
-      Framework::CMemStream stream;
-      stream.Seek(0, Framework::STREAM_SEEK_DIRECTION::STREAM_SEEK_SET);
-      jit.SetStream(&stream);
-      jit.Begin();
-      basic_block = 0;
-      u32 current_pc = context->jit.pc;
-      code_blocks[context->jit.pc / 2].start_pc = current_pc;
-      for (;;)
+      if (block_exits[i] == block->start_pc)
       {
-         u16 instr = context->instruction = ((fetchfunc *)context->fetchlist)[(current_pc >> 20) & 0x0FF](context, current_pc);
-         jit_opcode_func func = decode(SHMT_SH1, instr);
+         //the block plus a possible delay slot
+         u16 loop[SH2_JIT_MAX_BLOCK_INSTRUCTIONS + 1];
+         int count = ((block->end_pc - block->start_pc) >> 1) + 1;
 
-         func(instr, current_pc);
+         for (int j = 0; j <= count; j++)
+            loop[j] = fetch_instruction(context, block->start_pc + j * 2);
 
-         if (basic_block)
-            break;
+         block->idle = SH2idleLoopCheck(loop, count);
+      }
+   }
+}
 
-         current_pc += 2;
+static void link_block(ShCodeBlock *from, int exit, ShCodeBlock *to)
+{
+   from->link[exit] = to;
+   to->incoming.push_back(from);
+}
+
+static void unlink_block(ShCodeBlock *block)
+{
+   for (auto from : block->incoming)
+   {
+      for (int i = 0; i < MAX_BLOCK_LINKS; i++)
+      {
+         if (from->link[i] == block)
+            from->link[i] = NULL;
       }
+   }
 
-      jit.End();
+   block->incoming.clear();
 
-      code_blocks[context->jit.pc / 2].function = CMemoryFunction(stream.GetBuffer(), stream.GetSize());
-      code_blocks[context->jit.pc / 2].end_pc = current_pc;
+   for (int i = 0; i < MAX_BLOCK_LINKS; i++)
+   {
+      ShCodeBlock *to = block->link[i];
 
+      if (to)
+      {
+         to->incoming.erase(std::remove(to->incoming.begin(), to->incoming.end(), block), to->incoming.end());
+         block->link[i] = NULL;
+      }
    }
+}
 
-   code_blocks[context->jit.pc / 2].function(&context->jit);
+static void sh2_jit_mark_code(u32 phys_start, u32 phys_end)
+{
+   for (u32 addr = phys_start & ~((1 << SH2_JIT_LINE_SHIFT) - 1); addr < phys_end; addr += 1 << SH2_JIT_LINE_SHIFT)
+   {
+      ShBlockPage *page = sh2_block_pages[(addr >> SH2_JIT_PAGE_SHIFT) & (SH2_JIT_NUM_PAGES - 1)];
+
+      if (page)
+         page->code_lines[(addr & (SH2_JIT_PAGE_SIZE - 1)) >> SH2_JIT_LINE_SHIFT] = 1;
+   }
 }
 
-extern "C"
+static void sh2_jit_rebuild_code_lines(u32 page_index)
 {
-   FASTCALL void SH2JitExec(SH2_struct *context, u32 cycles)
+   ShBlockPage *page = sh2_block_pages[page_index];
+   u32 page_start = page_index << SH2_JIT_PAGE_SHIFT;
+
+   if (!page)
+      return;
+
+   memset(page->code_lines, 0, sizeof(page->code_lines));
+
+   if (page->num_blocks)
    {
-      SH2HandleInterrupts(context);
+      for (int i = 0; i < SH2_JIT_PAGE_SIZE / 2; i++)
+      {
+         ShCodeBlock *block = page->blocks[i];
 
-      current = context;
+         if (block)
+            sh2_jit_mark_code(block->phys_start, block->phys_end);
+      }
+   }
+
+   // delay slots of blocks in the previous page can spill into this one
+   if (page_index > 0 && sh2_block_pages[page_index - 1])
+   {
+      ShBlockPage *prev = sh2_block_pages[page_index - 1];
+
+      for (int i = 0; prev->num_blocks && i < SH2_JIT_PAGE_SIZE / 2; i++)
+      {
+         ShCodeBlock *block = prev->blocks[i];
+
+         if (block && block->phys_end > page_start)
+            sh2_jit_mark_code(page_start, block->phys_end);
+      }
+   }
+}
+
+static void sh2_jit_retire_block(ShBlockPage *page, int index)
+{
+   unlink_block(page->blocks[index]);
+   page->blocks[index]->dirty = 1;
+   retired_blocks.push_back(page->blocks[index]);
+   page->blocks[index] = NULL;
+   page->num_blocks--;
+}
+
+static void sh2_jit_free_retired_blocks()
+{
+   for (auto block : retired_blocks)
+      delete block;
+
+   retired_blocks.clear();
+}
+
+static void sh2_jit_invalidate_range(u32 start, u32 length)
+{
+   u32 end = start + length;
+   u32 first_page = start >> SH2_JIT_PAGE_SHIFT;
+   u32 last_page = (end - 1) >> SH2_JIT_PAGE_SHIFT;
+
+   if (first_page > 0)
+      first_page--;
+
+   if (last_page >= SH2_JIT_NUM_PAGES)
+      last_page = SH2_JIT_NUM_PAGES - 1;
+
+   for (u32 page_index = first_page; page_index <= last_page; page_index++)
+   {
+      ShBlockPage *page = sh2_block_pages[page_index];
+      int found = 0;
+
+      if (!page || !page->num_blocks)
+         continue;
 
-      while (context->jit.cycles < cycles)
+      for (int i = 0; i < SH2_JIT_PAGE_SIZE / 2; i++)
       {
-         recompile_and_exec(context);
+         ShCodeBlock *block = page->blocks[i];
+
+         if (block && block->phys_start < end && block->phys_end > start)
+         {
+            sh2_jit_retire_block(page, i);
+            found = 1;
+         }
+      }
+
+      if (found)
+      {
+         sh2_jit_rebuild_code_lines(page_index);
+
+         if (page_index + 1 < SH2_JIT_NUM_PAGES)
+            sh2_jit_rebuild_code_lines(page_index + 1);
+      }
+   }
+}
+
+static void sh2_jit_flush_blocks()
+{
+   for (u32 i = 0; i < SH2_JIT_NUM_PAGES; i++)
+   {
+      ShBlockPage *page = sh2_block_pages[i];
+
+      if (!page)
+         continue;
+
+      for (int j = 0; j < SH2_JIT_PAGE_SIZE / 2; j++)
+         delete page->blocks[j];
+
+      delete page;
+      sh2_block_pages[i] = NULL;
+   }
+
+   sh2_jit_free_retired_blocks();
+}
+
+static void sh1_jit_flush_blocks()
+{
+   for (int i = 0; i < MAX_SH1_BLOCKS; i++)
+   {
+      code_blocks[i].function = CMemoryFunction();
+      code_blocks[i].incoming.clear();
+
+      for (int j = 0; j < MAX_BLOCK_LINKS; j++)
+         code_blocks[i].link[j] = NULL;
+   }
+}
+
+static ShCodeBlock *sh2_jit_lookup_block(SH2_struct *context)
+{
+   u32 pc = context->jit.pc;
+   u32 phys = sh2_jit_phys_addr(pc);
+   u32 page_index = phys >> SH2_JIT_PAGE_SHIFT;
+   ShBlockPage *page = sh2_block_pages[page_index];
+   int index = (phys & (SH2_JIT_PAGE_SIZE - 1)) >> 1;
+
+   if (!page)
+      page = sh2_block_pages[page_index] = new ShBlockPage();
+
+   ShCodeBlock *block = page->blocks[index];
+
+   // the same physical block can be entered through a cache-through mirror,
+   // pc relative constants are baked in so recompile for the new address
+   if (block && block->start_pc == pc)
+      return block;
+
+   if (block)
+      sh2_jit_retire_block(page, index);
+
+   block = new ShCodeBlock();
+   compile_block(context, block);
+   block->phys_start = phys;
+   block->phys_end = phys + (block->end_pc - pc) + 4;
+
+   if (page_index + 1 < SH2_JIT_NUM_PAGES && !sh2_block_pages[page_index + 1] &&
+      ((block->phys_end - 1) >> SH2_JIT_PAGE_SHIFT) != page_index)
+      sh2_block_pages[page_index + 1] = new ShBlockPage();
+
+   page->blocks[index] = block;
+   page->num_blocks++;
+   sh2_jit_mark_code(block->phys_start, block->phys_end);
+
+   return block;
+}
+
+static ShCodeBlock *sh1_jit_lookup_block(SH2_struct *context)
+{
+   ShCodeBlock *block;
+
+   assert((context->jit.pc & 0xfff00000) == 0);
+
+   block = &code_blocks[context->jit.pc / 2];
+
+   if (block->function.IsEmpty())
+      compile_block(context, block);
+
+   return block;
+}
+
+static ShCodeBlock *lookup_block(SH2_struct *context)
+{
+   if (context->model == SHMT_SH1)
+      return sh1_jit_lookup_block(context);
+
+   // the data array and on-chip areas aren't tracked, run those uncached
+   if (context->jit.pc & 0xC0000000)
+      return NULL;
+
+   return sh2_jit_lookup_block(context);
+}
+
+//follows the link of the previous block when it exited to one of its static
+//successors, otherwise goes through the block table and links the exit
+static ShCodeBlock *next_block(SH2_struct *context, ShCodeBlock *prev)
+{
+   u32 pc = context->jit.pc;
+   ShCodeBlock *block;
+   int exit = -1;
+
+   if (prev && !prev->dirty)
+   {
+      for (int i = 0; i < MAX_BLOCK_LINKS; i++)
+      {
+         if (prev->link_pc[i] == pc)
+         {
+            if (prev->link[i])
+               return prev->link[i];
+
+            exit = i;
+            break;
+         }
       }
+   }
+
+   block = lookup_block(context);
+
+   // the lookup may have replaced prev, a retired block can't hold links
+   if (block && exit >= 0 && !prev->dirty)
+      link_block(prev, exit, block);
+
+   return block;
+}
+
+static void run_blocks(SH2_struct *context, u32 cycles)
+{
+   ShCodeBlock *block = NULL;
+
+   while (context->jit.cycles < (s32)cycles)
+   {
+      block = next_block(context, block);
+
+      if (block)
+      {
+         block->function(&context->jit);
+
+         //an idle loop went round once, it will keep going until an
+         //interrupt or a write from elsewhere so skip to the end of the slice
+         if (block->idle && !block->dirty && context->jit.pc == block->start_pc &&
+            context->jit.cycles < (s32)cycles)
+         {
+            context->idleCycles += cycles - context->jit.cycles;
+            context->jit.cycles = cycles;
+         }
+      }
+      else
+      {
+         ShCodeBlock uncached;
+         compile_block(context, &uncached);
+         uncached.function(&context->jit);
+      }
+
+      if (!retired_blocks.empty())
+      {
+         if (block && block->dirty)
+            block = NULL;
+
+         sh2_jit_free_retired_blocks();
+      }
+   }
+}
+
+extern "C"
+{
+   int SH2JitInit(enum SHMODELTYPE model, SH2_struct *msh, SH2_struct *ssh)
+   {
+      if (model == SHMT_SH2)
+         sh2_jit_flush_blocks();
+      else
+         sh1_jit_flush_blocks();
+
+      return SH2InterpreterInit(model, msh, ssh);
+   }
+
+   //////////////////////////////////////////////////////////////////////////////
+
+   void SH2JitDeInit()
+   {
+      sh2_jit_flush_blocks();
+      sh1_jit_flush_blocks();
+
+      SH2InterpreterDeInit();
+   }
+
+   //////////////////////////////////////////////////////////////////////////////
+
+   void SH2JitReset(SH2_struct *context)
+   {
+      context->jit.cycles = 0;
+
+      SH2InterpreterReset(context);
+   }
+
+   //////////////////////////////////////////////////////////////////////////////
+
+   FASTCALL void SH2JitExec(SH2_struct *context, u32 cycles)
+   {
+      current = context;
+
+      SH2HandleInterrupts(context);
+
+      run_blocks(context, cycles);
 
       if (UNLIKELY(context->jit.cycles < cycles))
          context->jit.cycles = 0;
@@ -2791,6 +3300,16 @@ extern "C"
 
    //////////////////////////////////////////////////////////////////////////////
 
+   void SH2JitWriteNotify(u32 start, u32 length)
+   {
+      if ((start & 0xC0000000) || length == 0)
+         return;
+
+      sh2_jit_invalidate_range(sh2_jit_phys_addr(start), length);
+   }
+
+   //////////////////////////////////////////////////////////////////////////////
+
    void SH2JitGetRegisters(SH2_struct *context, sh2regs_struct *regs)
    {
       for(int i = 0; i < 16; i++)
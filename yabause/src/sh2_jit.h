@@ -68,6 +68,7 @@ int SH2JitGetInterrupts(SH2_struct *context,
                                 interrupt_struct interrupts[MAX_INTERRUPTS]);
 void SH2JitSetInterrupts(SH2_struct *context, int num_interrupts,
                                  const interrupt_struct interrupts[MAX_INTERRUPTS]);
+void SH2JitWriteNotify(u32 start, u32 length);
 
 extern SH2Interface_struct SH2Jit;
 
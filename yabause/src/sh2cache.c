@@ -45,6 +45,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include "smpc.h"
 #include "cs2.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 
 #define AREA_MASK   (0xE0000000)
 #define TAG_MASK   (0x1FFFFC00)
@@ -70,11 +76,10 @@ void cache_clear(cache_enty * ca){
       for (way = 0; way < 4; way++)
       {
          int i = 0;
-         ca->way[way][entry].tag = 0;
-         
+         ca->tag[entry][way] = 0;
+
          for (i = 0; i < 16; i++)
-            ca->way[way][entry].data[i] = 0;
-         ca->way[way][entry].v = 0;
+            ca->data[entry][way][i] = 0;
       }
 	}
 	return;
@@ -89,62 +94,104 @@ void cache_disable(cache_enty * ca){
 	ca->enable = 0;
 }
 
+void cache_load_v1(cache_enty * ca, const cache_enty_v1 * old){
+   int entry = 0;
+   ca->enable = old->enable;
+
+   for (entry = 0; entry < 64; entry++){
+      int way = 0;
+      ca->lru[entry] = old->lru[entry] & 0x3F;
+
+      for (way = 0; way < 4; way++)
+      {
+         int i = 0;
+         ca->tag[entry][way] = old->way[way][entry].tag & TAG_MASK;
+         if (old->way[way][entry].v)
+            ca->tag[entry][way] |= CACHE_TAG_VALID;
+
+         for (i = 0; i < 16; i++)
+            ca->data[entry][way][i] = old->way[way][entry].data[i];
+      }
+   }
+}
+
 //lru is updated
 //when cache hit occurs during a read
 //when cache hit occurs during a write
 //when replacement occurs after a cache miss
 
-static INLINE void update_lru(int way, u32*lru)
-{
-   if (way == 3)
-   {
-      *lru = *lru | 0xb;//set bits 3, 1, 0
-      return;
-   }
-   else if (way == 2)
-   {
-      *lru = *lru & 0x3E;//set bit 0 to 0
-      *lru = *lru | 0x14;//set bits 4 and 2
-      return;
+//new lru bits after an access to each way:
+//way 3 sets bits 3, 1, 0
+//way 2 unsets bit 0 and sets bits 4 and 2
+//way 1 sets bit 5 and unsets bits 2 and 1
+//way 0 unsets bits 5, 4, 3
+static const u8 lru_update[4][64] = {
+   { // way 0
+      0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+      0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+      0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+      0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07
+   },
+   { // way 1
+      0x20, 0x21, 0x20, 0x21, 0x20, 0x21, 0x20, 0x21, 0x28, 0x29, 0x28, 0x29, 0x28, 0x29, 0x28, 0x29,
+      0x30, 0x31, 0x30, 0x31, 0x30, 0x31, 0x30, 0x31, 0x38, 0x39, 0x38, 0x39, 0x38, 0x39, 0x38, 0x39,
+      0x20, 0x21, 0x20, 0x21, 0x20, 0x21, 0x20, 0x21, 0x28, 0x29, 0x28, 0x29, 0x28, 0x29, 0x28, 0x29,
+      0x30, 0x31, 0x30, 0x31, 0x30, 0x31, 0x30, 0x31, 0x38, 0x39, 0x38, 0x39, 0x38, 0x39, 0x38, 0x39
+   },
+   { // way 2
+      0x14, 0x14, 0x16, 0x16, 0x14, 0x14, 0x16, 0x16, 0x1C, 0x1C, 0x1E, 0x1E, 0x1C, 0x1C, 0x1E, 0x1E,
+      0x14, 0x14, 0x16, 0x16, 0x14, 0x14, 0x16, 0x16, 0x1C, 0x1C, 0x1E, 0x1E, 0x1C, 0x1C, 0x1E, 0x1E,
+      0x34, 0x34, 0x36, 0x36, 0x34, 0x34, 0x36, 0x36, 0x3C, 0x3C, 0x3E, 0x3E, 0x3C, 0x3C, 0x3E, 0x3E,
+      0x34, 0x34, 0x36, 0x36, 0x34, 0x34, 0x36, 0x36, 0x3C, 0x3C, 0x3E, 0x3E, 0x3C, 0x3C, 0x3E, 0x3E
+   },
+   { // way 3
+      0x0B, 0x0B, 0x0B, 0x0B, 0x0F, 0x0F, 0x0F, 0x0F, 0x0B, 0x0B, 0x0B, 0x0B, 0x0F, 0x0F, 0x0F, 0x0F,
+      0x1B, 0x1B, 0x1B, 0x1B, 0x1F, 0x1F, 0x1F, 0x1F, 0x1B, 0x1B, 0x1B, 0x1B, 0x1F, 0x1F, 0x1F, 0x1F,
+      0x2B, 0x2B, 0x2B, 0x2B, 0x2F, 0x2F, 0x2F, 0x2F, 0x2B, 0x2B, 0x2B, 0x2B, 0x2F, 0x2F, 0x2F, 0x2F,
+      0x3B, 0x3B, 0x3B, 0x3B, 0x3F, 0x3F, 0x3F, 0x3F, 0x3B, 0x3B, 0x3B, 0x3B, 0x3F, 0x3F, 0x3F, 0x3F
    }
-   else if (way == 1)
-   {
-      *lru = *lru | (1 << 5);//set bit 5
-      *lru = *lru & 0x39;//unset bits 2 and 1
-      return;
-   }
-   else
-   {
-      *lru = *lru & 0x7;//unset bits 5,4,3
-      return;
+};
+
+//way to replace on a miss for the lru bits:
+//4-way mode: way 0 if bits 5, 4, 3 are 1, way 1 if bit 5 is zero and bits
+//2 and 1 are 1, way 2 if bits 4, 2 are zero and bit 0 is 1, way 3 if bits
+//3, 1, 0 are zero, otherwise way 0
+//2-way mode: way 2 if bit 0 is 1, otherwise way 3
+static const u8 lru_replace[2][64] = {
+   { // 4-way mode
+      3, 2, 0, 2, 3, 0, 1, 1, 0, 2, 0, 2, 0, 0, 1, 1,
+      3, 0, 0, 0, 3, 0, 1, 1, 0, 0, 0, 0, 0, 0, 1, 1,
+      3, 2, 0, 2, 3, 0, 0, 0, 0, 2, 0, 2, 0, 0, 0, 0,
+      3, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+   },
+   { // 2-way mode
+      3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2,
+      3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2,
+      3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2,
+      3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2
    }
+};
 
-   //should not happen
-}
+//first way that hit in a 4 bit hit mask, -1 on a miss. Address array
+//writes can put a line in more than one way, the lowest way wins
+static const s8 hit_way[16] = { -1, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0 };
 
-static INLINE int select_way_to_replace(SH2_struct *sh, u32 lru)
+static INLINE int cache_lookup(const cache_enty * ca, u32 entry, u32 tagaddr)
 {
-   if (sh->onchip.CCR & (1 << 3))//2-way mode
-   {
-      if ((lru & 1) == 1)
-         return 2;
-      else
-         return 3;
-   }
-   else
-   {
-      if ((lru & 0x38) == 0x38)//bits 5, 4, 3 must be 1
-         return 0;
-      else if ((lru & 0x26) == 0x6)//bit 5 must be zero. bits 2 and 1 must be 1
-         return 1;
-      else if ((lru & 0x15) == 1)//bits 4, 2 must be zero. bit 0 must be 1
-         return 2;
-      else if ((lru & 0xB) == 0)//bits 3, 1, 0 must be zero
-         return 3;
-   }
-
-   //should not happen
-   return 0;
+#if defined(__SSE2__)
+   __m128i tags = _mm_loadu_si128((const __m128i *)ca->tag[entry]);
+   __m128i hit = _mm_cmpeq_epi32(tags, _mm_set1_epi32(tagaddr | CACHE_TAG_VALID));
+   return hit_way[_mm_movemask_ps(_mm_castsi128_ps(hit))];
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+   static const u32 way_bits[4] = { 1, 2, 4, 8 };
+   uint32x4_t hit = vceqq_u32(vld1q_u32(ca->tag[entry]), vdupq_n_u32(tagaddr | CACHE_TAG_VALID));
+   return hit_way[vaddvq_u32(vandq_u32(hit, vld1q_u32(way_bits)))];
+#else
+   const u32 *tags = ca->tag[entry];
+   u32 match = tagaddr | CACHE_TAG_VALID;
+   return hit_way[(tags[0] == match) | ((tags[1] == match) << 1) |
+      ((tags[2] == match) << 2) | ((tags[3] == match) << 3)];
+#endif
 }
 
 //values are from console measurements and have extra delays included
@@ -327,29 +374,17 @@ void cache_memory_write_b(SH2_struct *sh, cache_enty * ca, u32 addr, u8 val){
 	switch (addr & AREA_MASK){
 	case CACHE_USE:
 	{
-      u32 tagaddr = 0;
       u32 entry = 0;
+      int way = 0;
 		if (ca->enable == 0){
 			MappedMemoryWriteByteNocache(sh, addr, val);
 			return;
 		}
-		tagaddr = (addr & TAG_MASK);
 		entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
-		if (ca->way[0][entry].v && ca->way[0][entry].tag == tagaddr){
-			ca->way[0][entry].data[addr&LINE_MASK] = val;
-         update_lru(0, &ca->lru[entry]);
-		}
-		else if (ca->way[1][entry].v && ca->way[1][entry].tag == tagaddr){
-			ca->way[1][entry].data[addr&LINE_MASK] = val;
-         update_lru(1, &ca->lru[entry]);
-		}
-		else if (ca->way[2][entry].v && ca->way[2][entry].tag == tagaddr){
-			ca->way[2][entry].data[addr&LINE_MASK] = val;
-         update_lru(2, &ca->lru[entry]);
-		}
-		else if (ca->way[3][entry].v && ca->way[3][entry].tag == tagaddr){
-			ca->way[3][entry].data[addr&LINE_MASK] = val;
-         update_lru(3, &ca->lru[entry]);
+		way = cache_lookup(ca, entry, addr & TAG_MASK);
+		if (way >= 0){
+			ca->data[entry][way][addr&LINE_MASK] = val;
+         ca->lru[entry] = lru_update[way][ca->lru[entry]];
 		}
 		MappedMemoryWriteByteNocache(sh, addr, val);
 	}
@@ -369,34 +404,20 @@ void cache_memory_write_w(SH2_struct *sh, cache_enty * ca, u32 addr, u16 val){
 	switch (addr & AREA_MASK){
 	case CACHE_USE:
 	{
-      u32 tagaddr = 0;
       u32 entry = 0;
+      int way = 0;
 		if (ca->enable == 0){
 			MappedMemoryWriteWordNocache(sh, addr, val);
 			return;
 		}
 
-		tagaddr = (addr & TAG_MASK);
 		entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
-		if (ca->way[0][entry].v && ca->way[0][entry].tag == tagaddr){
-			ca->way[0][entry].data[addr&LINE_MASK] = val >> 8;
-			ca->way[0][entry].data[(addr&LINE_MASK) + 1] = val;
-         update_lru(0, &ca->lru[entry]);
-		}
-		else if (ca->way[1][entry].v && ca->way[1][entry].tag == tagaddr){
-			ca->way[1][entry].data[addr&LINE_MASK] = val >> 8;
-			ca->way[1][entry].data[(addr&LINE_MASK) + 1] = val;
-         update_lru(1, &ca->lru[entry]);
-		}
-		else if (ca->way[2][entry].v && ca->way[2][entry].tag == tagaddr){
-			ca->way[2][entry].data[addr&LINE_MASK] = val >> 8;
-			ca->way[2][entry].data[(addr&LINE_MASK) + 1] = val;
-         update_lru(2, &ca->lru[entry]);
-		}
-		else if (ca->way[3][entry].v && ca->way[3][entry].tag == tagaddr){
-			ca->way[3][entry].data[addr&LINE_MASK] = val >> 8;
-			ca->way[3][entry].data[(addr&LINE_MASK) + 1] = val;
-         update_lru(3, &ca->lru[entry]);
+		way = cache_lookup(ca, entry, addr & TAG_MASK);
+		if (way >= 0){
+			u8 *data = &ca->data[entry][way][addr&LINE_MASK];
+			data[0] = val >> 8;
+			data[1] = val;
+         ca->lru[entry] = lru_update[way][ca->lru[entry]];
 		}
 
 		// write through
@@ -423,10 +444,10 @@ void cache_memory_write_l(SH2_struct *sh, cache_enty * ca, u32 addr, u32 val){
       u32 entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
       for (i = 0; i < 3; i++)
       {
-         if (ca->way[i][entry].tag == tagaddr)
+         if ((ca->tag[entry][i] & ~CACHE_TAG_VALID) == tagaddr)
          {
             //only v bit is changed, the rest of the data remains
-            ca->way[i][entry].v = 0;
+            ca->tag[entry][i] &= ~CACHE_TAG_VALID;
             break;
          }
       }
@@ -434,43 +455,22 @@ void cache_memory_write_l(SH2_struct *sh, cache_enty * ca, u32 addr, u32 val){
    break;
 	case CACHE_USE:
 	{
-      u32 tagaddr = 0;
       u32 entry = 0;
+      int way = 0;
 		if (ca->enable == 0){
 			MappedMemoryWriteLongNocache(sh, addr, val);
 			return;
 		}
 
-		tagaddr = (addr & TAG_MASK);
 		entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
-		if (ca->way[0][entry].v && ca->way[0][entry].tag == tagaddr){
-			ca->way[0][entry].data[(addr&LINE_MASK)] = ((val >> 24) & 0xFF);
-			ca->way[0][entry].data[(addr&LINE_MASK) + 1] = ((val >> 16) & 0xFF);
-			ca->way[0][entry].data[(addr&LINE_MASK) + 2] = ((val >> 8) & 0xFF);
-			ca->way[0][entry].data[(addr&LINE_MASK) + 3] = ((val >> 0) & 0xFF);
-         update_lru(0, &ca->lru[entry]);
-		}
-		else if (ca->way[1][entry].v && ca->way[1][entry].tag == tagaddr){
-			ca->way[1][entry].data[(addr&LINE_MASK)] = ((val >> 24) & 0xFF);
-			ca->way[1][entry].data[(addr&LINE_MASK) + 1] = ((val >> 16) & 0xFF);
-			ca->way[1][entry].data[(addr&LINE_MASK) + 2] = ((val >> 8) & 0xFF);
-			ca->way[1][entry].data[(addr&LINE_MASK) + 3] = ((val >> 0) & 0xFF);
-         update_lru(1, &ca->lru[entry]);
-		}
-		else if (ca->way[2][entry].v && ca->way[2][entry].tag == tagaddr){
-			ca->way[2][entry].data[(addr&LINE_MASK)] = ((val >> 24) & 0xFF);
-			ca->way[2][entry].data[(addr&LINE_MASK) + 1] = ((val >> 16) & 0xFF);
-			ca->way[2][entry].data[(addr&LINE_MASK) + 2] = ((val >> 8) & 0xFF);
-			ca->way[2][entry].data[(addr&LINE_MASK) + 3] = ((val >> 0) & 0xFF);
-         update_lru(2, &ca->lru[entry]);
-
-		}
-		else if (ca->way[3][entry].v && ca->way[3][entry].tag == tagaddr){
-			ca->way[3][entry].data[(addr&LINE_MASK)] = ((val >> 24) & 0xFF);
-			ca->way[3][entry].data[(addr&LINE_MASK) + 1] = ((val >> 16) & 0xFF);
-			ca->way[3][entry].data[(addr&LINE_MASK) + 2] = ((val >> 8) & 0xFF);
-			ca->way[3][entry].data[(addr&LINE_MASK) + 3] = ((val >> 0) & 0xFF);
-         update_lru(3, &ca->lru[entry]);
+		way = cache_lookup(ca, entry, addr & TAG_MASK);
+		if (way >= 0){
+			u8 *data = &ca->data[entry][way][addr&LINE_MASK];
+			data[0] = ((val >> 24) & 0xFF);
+			data[1] = ((val >> 16) & 0xFF);
+			data[2] = ((val >> 8) & 0xFF);
+			data[3] = ((val >> 0) & 0xFF);
+         ca->lru[entry] = lru_update[way][ca->lru[entry]];
 		}
 
 		// write through
@@ -608,53 +608,43 @@ void sh2_refill_cache(SH2_struct *sh, cache_enty * ca, int lruway, u32 entry, u3
 
    for (i = 0; i < 16; i += 4) {
       u32 val = sh2_cache_refill_read(sh, (addr & 0xFFFFFFF0) + i);
-      ca->way[lruway][entry].data[i + 0] = (val >> 24) & 0xff;
-      ca->way[lruway][entry].data[i + 1] = (val >> 16) & 0xff;
-      ca->way[lruway][entry].data[i + 2] = (val >> 8) & 0xff;
-      ca->way[lruway][entry].data[i + 3] = (val >> 0) & 0xff;
+      ca->data[entry][lruway][i + 0] = (val >> 24) & 0xff;
+      ca->data[entry][lruway][i + 1] = (val >> 16) & 0xff;
+      ca->data[entry][lruway][i + 2] = (val >> 8) & 0xff;
+      ca->data[entry][lruway][i + 3] = (val >> 0) & 0xff;
+   }
+}
+
+//finds the way holding addr, refilling the least recently used way on a
+//miss, and updates the lru bits
+static INLINE u8 *cache_read_line(SH2_struct *sh, cache_enty * ca, u32 addr)
+{
+   u32 tagaddr = (addr & TAG_MASK);
+   u32 entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
+   int way = cache_lookup(ca, entry, tagaddr);
+
+   if (way < 0)
+   {
+      // cache miss
+      way = lru_replace[(sh->onchip.CCR >> 3) & 1][ca->lru[entry]];
+      ca->tag[entry][way] = tagaddr;
+
+      sh2_refill_cache(sh, ca, way, entry, addr);
+
+      ca->tag[entry][way] |= CACHE_TAG_VALID; //becomes valid
    }
+
+   ca->lru[entry] = lru_update[way][ca->lru[entry]];
+   return &ca->data[entry][way][addr&LINE_MASK];
 }
 
 u8 cache_memory_read_b(SH2_struct *sh, cache_enty * ca, u32 addr){
 	switch (addr & AREA_MASK){
 	case CACHE_USE:
-	{
-      u32 tagaddr = 0;
-      u32 entry = 0;
-      int i = 0;
-      int lruway = 0;
 		if (ca->enable == 0){
 			return MappedMemoryReadByteNocache(sh, addr);
 		}
-		tagaddr = (addr & TAG_MASK);
-		entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
-		if (ca->way[0][entry].v && ca->way[0][entry].tag == tagaddr){
-         update_lru(0, &ca->lru[entry]);
-			return ca->way[0][entry].data[addr&LINE_MASK];
-		}
-		else if (ca->way[1][entry].v && ca->way[1][entry].tag == tagaddr){
-         update_lru(1, &ca->lru[entry]);
-			return ca->way[1][entry].data[addr&LINE_MASK];
-		}
-		else if (ca->way[2][entry].v && ca->way[2][entry].tag == tagaddr){
-         update_lru(2, &ca->lru[entry]);
-			return ca->way[2][entry].data[addr&LINE_MASK];
-		}
-		else if (ca->way[3][entry].v && ca->way[3][entry].tag == tagaddr){
-         update_lru(3, &ca->lru[entry]);
-			return ca->way[3][entry].data[addr&LINE_MASK];
-		}
-		// cache miss
-      lruway = select_way_to_replace(sh, ca->lru[entry]);
-      update_lru(lruway, &ca->lru[entry]);
-		ca->way[lruway][entry].tag = tagaddr;
-
-      sh2_refill_cache(sh, ca, lruway, entry, addr);
-
-      ca->way[lruway][entry].v = 1; //becomes valid
-		return ca->way[lruway][entry].data[addr&LINE_MASK];
-	}
-	break;
+		return cache_read_line(sh, ca, addr)[0];
 	case CACHE_THROUGH:
       sh->cycles += get_cache_through_timing_read_byte_word(addr);
 		return MappedMemoryReadByteNocache(sh, addr);
@@ -671,41 +661,12 @@ u16 cache_memory_read_w(SH2_struct *sh, cache_enty * ca, u32 addr){
 	switch (addr & AREA_MASK){
 	case CACHE_USE:
 	{
-      u32 tagaddr = 0;
-      u32 entry = 0;
-      int i = 0;
-      int lruway = 0;
+      const u8 *data;
 		if (ca->enable == 0){
 			return MappedMemoryReadWordNocache(sh, addr);
 		}
-	   tagaddr = (addr & TAG_MASK);
-		entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
-		if (ca->way[0][entry].v && ca->way[0][entry].tag == tagaddr){
-         update_lru(0, &ca->lru[entry]);
-			return ((u16)(ca->way[0][entry].data[addr&LINE_MASK]) << 8) | ca->way[0][entry].data[(addr&LINE_MASK) + 1];
-		}
-		else if (ca->way[1][entry].v && ca->way[1][entry].tag == tagaddr){
-         update_lru(1, &ca->lru[entry]);
-			return ((u16)(ca->way[1][entry].data[addr&LINE_MASK]) << 8) | ca->way[1][entry].data[(addr&LINE_MASK) + 1];
-		}
-		else if (ca->way[2][entry].v && ca->way[2][entry].tag == tagaddr){
-         update_lru(2, &ca->lru[entry]);
-			return ((u16)(ca->way[2][entry].data[addr&LINE_MASK]) << 8) | ca->way[2][entry].data[(addr&LINE_MASK) + 1];
-		}
-		else if (ca->way[3][entry].v && ca->way[3][entry].tag == tagaddr){
-         update_lru(3, &ca->lru[entry]);
-			return ((u16)(ca->way[3][entry].data[addr&LINE_MASK]) << 8) | ca->way[3][entry].data[(addr&LINE_MASK) + 1];
-		}
-
-		// cache miss
-		lruway = select_way_to_replace(sh, ca->lru[entry]);
-      update_lru(lruway, &ca->lru[entry]);
-		ca->way[lruway][entry].tag = tagaddr;
-
-      sh2_refill_cache(sh, ca, lruway, entry, addr);
-
-      ca->way[lruway][entry].v = 1; //becomes valid
-		return ((u16)(ca->way[lruway][entry].data[addr&LINE_MASK]) << 8) | ca->way[lruway][entry].data[(addr&LINE_MASK) + 1];
+		data = cache_read_line(sh, ca, addr);
+		return ((u16)(data[0]) << 8) | data[1];
 	}
 	break;
 	case CACHE_THROUGH:
@@ -723,56 +684,15 @@ u32 cache_memory_read_l(SH2_struct *sh, cache_enty * ca, u32 addr){
 	switch (addr & AREA_MASK){
 	case CACHE_USE:
 	{
-      u32 tagaddr = 0;
-      u32 entry = 0;
-      int i = 0;
-      int lruway = 0;
+      const u8 *data;
 		if (ca->enable == 0){
 			return MappedMemoryReadLongNocache(sh, addr);
 		}
-		tagaddr = (addr & TAG_MASK);
-	   entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
-
-		if (ca->way[0][entry].v && ca->way[0][entry].tag == tagaddr){
-         update_lru(0, &ca->lru[entry]);
-			return ((u32)(ca->way[0][entry].data[addr&LINE_MASK]) << 24) |
-				((u32)(ca->way[0][entry].data[(addr&LINE_MASK) + 1]) << 16) |
-				((u32)(ca->way[0][entry].data[(addr&LINE_MASK) + 2]) << 8) |
-				((u32)(ca->way[0][entry].data[(addr&LINE_MASK) + 3]) << 0);
-		}
-		else if (ca->way[1][entry].v && ca->way[1][entry].tag == tagaddr){
-         update_lru(1, &ca->lru[entry]);
-			return ((u32)(ca->way[1][entry].data[addr&LINE_MASK]) << 24) |
-				((u32)(ca->way[1][entry].data[(addr&LINE_MASK) + 1]) << 16) |
-				((u32)(ca->way[1][entry].data[(addr&LINE_MASK) + 2]) << 8) |
-				((u32)(ca->way[1][entry].data[(addr&LINE_MASK) + 3]) << 0);
-		}
-		else if (ca->way[2][entry].v && ca->way[2][entry].tag == tagaddr){
-         update_lru(2, &ca->lru[entry]);
-			return ((u32)(ca->way[2][entry].data[addr&LINE_MASK]) << 24) |
-				((u32)(ca->way[2][entry].data[(addr&LINE_MASK) + 1]) << 16) |
-				((u32)(ca->way[2][entry].data[(addr&LINE_MASK) + 2]) << 8) |
-				((u32)(ca->way[2][entry].data[(addr&LINE_MASK) + 3]) << 0);
-		}
-		else if (ca->way[3][entry].v && ca->way[3][entry].tag == tagaddr){
-         update_lru(3, &ca->lru[entry]);
-			return ((u32)(ca->way[3][entry].data[addr&LINE_MASK]) << 24) |
-				((u32)(ca->way[3][entry].data[(addr&LINE_MASK) + 1]) << 16) |
-				((u32)(ca->way[3][entry].data[(addr&LINE_MASK) + 2]) << 8) |
-				((u32)(ca->way[3][entry].data[(addr&LINE_MASK) + 3]) << 0);
-			}
-		// cache miss
-		lruway = select_way_to_replace(sh, ca->lru[entry]);
-      update_lru(lruway, &ca->lru[entry]);
-		ca->way[lruway][entry].tag = tagaddr;
-
-      sh2_refill_cache(sh, ca, lruway, entry, addr);
-
-      ca->way[lruway][entry].v = 1; //becomes valid
-		return ((u32)(ca->way[lruway][entry].data[addr&LINE_MASK]) << 24) |
-			((u32)(ca->way[lruway][entry].data[(addr&LINE_MASK) + 1]) << 16) |
-			((u32)(ca->way[lruway][entry].data[(addr&LINE_MASK) + 2]) << 8) |
-			((u32)(ca->way[lruway][entry].data[(addr&LINE_MASK) + 3]) << 0);
+		data = cache_read_line(sh, ca, addr);
+		return ((u32)(data[0]) << 24) |
+			((u32)(data[1]) << 16) |
+			((u32)(data[2]) << 8) |
+			((u32)(data[3]) << 0);
 	}
 	break;
 	case CACHE_THROUGH:
@@ -785,4 +705,3 @@ u32 cache_memory_read_l(SH2_struct *sh, cache_enty * ca, u32 addr){
 	}
 	return 0;
 }
-
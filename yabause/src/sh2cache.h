@@ -1,17 +1,30 @@
 #ifndef _SH2_CACHE_H_
 #define _SH2_CACHE_H_
 
-typedef struct _cache_line{
+//the valid bit is kept in the tag word, where the address array has it
+#define CACHE_TAG_VALID (1 << 2)
+
+//the tags of the four ways of an entry are next to each other so that they
+//can be compared all at once
+typedef struct _cache_enty{
+	u32 enable;
+	u32 lru[64];
+	u32 tag[64][4];
+	u8 data[64][4][16];
+} cache_enty;
+
+//layout of cache_enty in version 1 save states
+typedef struct _cache_line_v1{
 	u32 tag;
    int v;
 	u8 data[16];
-} cache_line;
+} cache_line_v1;
 
-typedef struct _cache_enty{
+typedef struct _cache_enty_v1{
 	u32 enable;
 	u32 lru[64];
-	cache_line way[4][64];
-} cache_enty;
+	cache_line_v1 way[4][64];
+} cache_enty_v1;
 
 #ifdef __cplusplus
 extern "C"{
@@ -20,6 +33,7 @@ extern "C"{
 void cache_clear(cache_enty * ca);
 void cache_enable(cache_enty * ca);
 void cache_disable(cache_enty * ca);
+void cache_load_v1(cache_enty * ca, const cache_enty_v1 * old);
 void cache_memory_write_b(SH2_struct *sh, cache_enty * ca, u32 addr, u8 val);
 void cache_memory_write_w(SH2_struct *sh, cache_enty * ca, u32 addr, u16 val);
 void cache_memory_write_l(SH2_struct *sh, cache_enty * ca, u32 addr, u32 val);
@@ -23,6 +23,7 @@
 */
 
 #include <stdlib.h>
+#include <stddef.h>
 #include "sh2core.h"
 #include "debug.h"
 #include "memory.h"
@@ -38,6 +39,8 @@
 #include "assert.h"
 #include "smpc.h"
 #include "scu.h"
+#include "sh2int.h"
+#include "threads.h"
 
 // SH1/SH2 differences
 // SH1's mac.w operates at a smaller precision. 16x16+42 instead of 16x16+64
@@ -211,6 +214,8 @@ void SH1DeInit()
 
 void SH2DeInit()
 {
+   SH2ThreadStop();
+
    if (SH2Core)
       SH2Core->DeInit();
    SH2Core = NULL;
@@ -309,8 +314,23 @@ void FASTCALL SH2Exec(SH2_struct *context, u32 cycles)
 
 //////////////////////////////////////////////////////////////////////////////
 
+enum
+{
+   SH2_DEFER_INTERRUPT,
+   SH2_DEFER_INPUTCAPTURE
+};
+
+static void SH2Defer(SH2_struct *context, int type, u8 vector, u8 level);
+
 void SH2SendInterrupt(SH2_struct *context, u8 vector, u8 level)
 {
+   // The target may be running on the other thread
+   if (UNLIKELY(sh2_parallel))
+   {
+      SH2Defer(context, SH2_DEFER_INTERRUPT, vector, level);
+      return;
+   }
+
    context->core->SendInterrupt(context, vector, level);
 }
 
@@ -322,6 +342,256 @@ void SH2NMI(SH2_struct *context)
    SH2SendInterrupt(context, 0xB, 0x10);
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Slave SH2 thread
+//
+// The master runs on the emulation thread while the slave runs the same
+// number of cycles on its own thread, in chunks of at most ssh2_thread.skew
+// cycles so they never drift further apart than that. While both are
+// running, handlers for anything that isn't plain memory are called with
+// sh2_bus_mutex held, and anything that reaches into an SH2's state
+// (interrupts, input capture) is queued until the end of the chunk.
+//
+// Work ram is shared through the page lists without any checks, so a write
+// by one CPU can be seen by the other up to a chunk early or late. Games
+// that need tighter ordering than the skew window between the CPUs need a
+// smaller skew or the serial path. Since nothing tells which games those
+// are, the thread is experimental: SH2ThreadStart fails unless the build
+// defines USE_SSH2_THREAD, and even then it's only used when asked for.
+//////////////////////////////////////////////////////////////////////////////
+
+#define SH2_DEFERRED_MAX  64
+#define SH2_THREAD_SPINS  1000
+
+typedef struct
+{
+   SH2_struct *context;
+   int type;
+   u8 vector;
+   u8 level;
+} sh2deferred_struct;
+
+static struct
+{
+   int running;
+   u32 skew;
+   volatile u32 cycles;   // cycles for the slave to run, 0 when there's nothing to do
+   volatile int started;
+   volatile int done;
+   volatile int quit;
+   volatile int exited;
+   YabMutex *sync_mutex;
+   YabMutex *defer_mutex;
+   sh2deferred_struct deferred[SH2_DEFERRED_MAX];
+   int num_deferred;
+} ssh2_thread;
+
+int sh2_parallel = 0;
+YabMutex *sh2_bus_mutex = NULL;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void SH2Defer(SH2_struct *context, int type, u8 vector, u8 level)
+{
+   int i;
+
+   YabThreadLock(ssh2_thread.defer_mutex);
+
+   for (i = 0; i < ssh2_thread.num_deferred; i++)
+   {
+      sh2deferred_struct *d = &ssh2_thread.deferred[i];
+
+      if (d->context == context && d->type == type && d->vector == vector)
+      {
+         YabThreadUnLock(ssh2_thread.defer_mutex);
+         return;
+      }
+   }
+
+   if (ssh2_thread.num_deferred < SH2_DEFERRED_MAX)
+   {
+      sh2deferred_struct *d = &ssh2_thread.deferred[ssh2_thread.num_deferred++];
+
+      d->context = context;
+      d->type = type;
+      d->vector = vector;
+      d->level = level;
+   }
+
+   YabThreadUnLock(ssh2_thread.defer_mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void SH2InputCapture(SH2_struct *sh);
+
+static void SH2RunDeferred(void)
+{
+   int i;
+
+   for (i = 0; i < ssh2_thread.num_deferred; i++)
+   {
+      sh2deferred_struct *d = &ssh2_thread.deferred[i];
+
+      if (d->type == SH2_DEFER_INTERRUPT)
+         d->context->core->SendInterrupt(d->context, d->vector, d->level);
+      else
+         SH2InputCapture(d->context);
+   }
+
+   ssh2_thread.num_deferred = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void SH2SlaveThread(UNUSED void *arg)
+{
+   int spins = 0;
+
+   while (!ssh2_thread.quit)
+   {
+      u32 cycles;
+
+      if (ssh2_thread.cycles == 0)
+      {
+         // The next chunk usually follows quickly, so spin for a while
+         // before going to sleep
+         if (++spins < SH2_THREAD_SPINS)
+            YabThreadYield();
+         else
+         {
+            YabThreadSleep();
+            spins = 0;
+         }
+         continue;
+      }
+
+      YabThreadLock(ssh2_thread.sync_mutex);
+      cycles = ssh2_thread.cycles;
+      ssh2_thread.started = 1;
+      YabThreadUnLock(ssh2_thread.sync_mutex);
+
+      SH2Exec(SSH2, cycles);
+      spins = 0;
+
+      YabThreadLock(ssh2_thread.sync_mutex);
+      ssh2_thread.cycles = 0;
+      ssh2_thread.done = 1;
+      YabThreadUnLock(ssh2_thread.sync_mutex);
+   }
+
+   ssh2_thread.exited = 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int SH2ThreadStart(u32 skew)
+{
+#ifndef USE_SSH2_THREAD
+   // Experimental, see above. It has to be asked for when building
+   return -1;
+#else
+   if (ssh2_thread.running)
+      return 0;
+
+   // Only the interpreter keeps everything it needs in the SH2 context
+   if (SH2Core == NULL || SH2Core->id != SH2CORE_INTERPRETER)
+      return -1;
+
+   // Nothing stops one CPU from writing to lines the other one has cached
+   // in the middle of a chunk, so games that rely on cache emulation keep
+   // running the SH2s one after the other
+   if (yabsys.sh2_cache_enabled)
+      return -1;
+
+   ssh2_thread.sync_mutex = YabThreadCreateMutex();
+   ssh2_thread.defer_mutex = YabThreadCreateMutex();
+   sh2_bus_mutex = YabThreadCreateMutex();
+   ssh2_thread.skew = skew ? skew : 0xFFFFFFFF;
+   ssh2_thread.cycles = 0;
+   ssh2_thread.quit = 0;
+   ssh2_thread.exited = 0;
+   ssh2_thread.num_deferred = 0;
+
+   if (ssh2_thread.sync_mutex == NULL || ssh2_thread.defer_mutex == NULL ||
+       sh2_bus_mutex == NULL ||
+       YabThreadStart(YAB_THREAD_SSH2, SH2SlaveThread, NULL) != 0)
+   {
+      YabThreadFreeMutex(ssh2_thread.sync_mutex);
+      YabThreadFreeMutex(ssh2_thread.defer_mutex);
+      YabThreadFreeMutex(sh2_bus_mutex);
+      ssh2_thread.sync_mutex = ssh2_thread.defer_mutex = sh2_bus_mutex = NULL;
+      return -1;
+   }
+
+   ssh2_thread.running = 1;
+   return 0;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void SH2ThreadStop(void)
+{
+   if (!ssh2_thread.running)
+      return;
+
+   ssh2_thread.quit = 1;
+   while (!ssh2_thread.exited)
+   {
+      YabThreadWake(YAB_THREAD_SSH2);
+      YabThreadYield();
+   }
+   YabThreadWait(YAB_THREAD_SSH2);
+
+   YabThreadFreeMutex(ssh2_thread.sync_mutex);
+   YabThreadFreeMutex(ssh2_thread.defer_mutex);
+   YabThreadFreeMutex(sh2_bus_mutex);
+   ssh2_thread.sync_mutex = ssh2_thread.defer_mutex = sh2_bus_mutex = NULL;
+   ssh2_thread.running = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int SH2ThreadRunning(void)
+{
+   return ssh2_thread.running;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void SH2ExecParallel(u32 cycles)
+{
+   while (cycles > 0)
+   {
+      u32 chunk = cycles < ssh2_thread.skew ? cycles : ssh2_thread.skew;
+
+      YabThreadLock(ssh2_thread.sync_mutex);
+      sh2_parallel = 1;
+      ssh2_thread.started = 0;
+      ssh2_thread.done = 0;
+      ssh2_thread.cycles = chunk;
+      YabThreadUnLock(ssh2_thread.sync_mutex);
+
+      SH2Exec(MSH2, chunk);
+
+      // Wake the slave again in case it went to sleep before seeing the chunk
+      while (!ssh2_thread.done)
+      {
+         if (!ssh2_thread.started)
+            YabThreadWake(YAB_THREAD_SSH2);
+         YabThreadYield();
+      }
+
+      YabThreadLock(ssh2_thread.sync_mutex);
+      sh2_parallel = 0;
+      YabThreadUnLock(ssh2_thread.sync_mutex);
+
+      SH2RunDeferred();
+      cycles -= chunk;
+   }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 void SH2Step(SH2_struct *context)
@@ -801,6 +1071,27 @@ int SH2AddMemoryBreakpoint(SH2_struct *context, u32 addr, u32 flags) {
       context->bp.memorybreakpoint[context->bp.nummemorybreakpoints].oldwriteword = context->WriteWordList[(addr >> 16) & 0xFFF];
       context->bp.memorybreakpoint[context->bp.nummemorybreakpoints].oldwritelong = context->WriteLongList[(addr >> 16) & 0xFFF];
 
+      // Accesses to the page now have to go through the breakpoint functions
+      for (i = 0; i < context->bp.nummemorybreakpoints; i++)
+      {
+         if (((context->bp.memorybreakpoint[i].addr >> 16) & 0xFFF) == ((addr >> 16) & 0xFFF))
+            break;
+      }
+
+      if (i < context->bp.nummemorybreakpoints)
+      {
+         context->bp.memorybreakpoint[context->bp.nummemorybreakpoints].oldreadpage = context->bp.memorybreakpoint[i].oldreadpage;
+         context->bp.memorybreakpoint[context->bp.nummemorybreakpoints].oldwritepage = context->bp.memorybreakpoint[i].oldwritepage;
+      }
+      else
+      {
+         context->bp.memorybreakpoint[context->bp.nummemorybreakpoints].oldreadpage = context->ReadPageList[(addr >> 16) & 0xFFF];
+         context->bp.memorybreakpoint[context->bp.nummemorybreakpoints].oldwritepage = context->WritePageList[(addr >> 16) & 0xFFF];
+      }
+
+      context->ReadPageList[(addr >> 16) & 0xFFF] = NULL;
+      context->WritePageList[(addr >> 16) & 0xFFF] = NULL;
+
       if (flags & BREAK_BYTEREAD)
       {
          // Make sure function isn't already being breakpointed by another breakpoint
@@ -894,6 +1185,7 @@ static void SH2SortMemoryBreakpoints(SH2_struct *context) {
 
 int SH2DelMemoryBreakpoint(SH2_struct *context, u32 addr) {
    int i, i2;
+   int pageshared;
 
    if (context->bp.nummemorybreakpoints > 0) {
       for (i = 0; i < context->bp.nummemorybreakpoints; i++) {
@@ -902,6 +1194,7 @@ int SH2DelMemoryBreakpoint(SH2_struct *context, u32 addr) {
             // Remove memory access piggyback function to memory access function table
 
             // Make sure no other breakpoints need the breakpoint functions first
+            pageshared = 0;
             for (i2 = 0; i2 < context->bp.nummemorybreakpoints; i2++)
             {
                if (((context->bp.memorybreakpoint[i].addr >> 16) & 0xFFF) ==
@@ -910,8 +1203,15 @@ int SH2DelMemoryBreakpoint(SH2_struct *context, u32 addr) {
                {
                   // Clear the flags
                   context->bp.memorybreakpoint[i].flags &= ~context->bp.memorybreakpoint[i2].flags;
+                  pageshared = 1;
                }                
             }
+
+            if (!pageshared)
+            {
+               context->ReadPageList[(addr >> 16) & 0xFFF] = context->bp.memorybreakpoint[i].oldreadpage;
+               context->WritePageList[(addr >> 16) & 0xFFF] = context->bp.memorybreakpoint[i].oldwritepage;
+            }
             
             if (context->bp.memorybreakpoint[i].flags & BREAK_BYTEREAD)
                context->ReadByteList[(addr >> 16) & 0xFFF] = context->bp.memorybreakpoint[i].oldreadbyte;
@@ -962,6 +1262,8 @@ void SH2ClearMemoryBreakpoints(SH2_struct *context) {
       context->bp.memorybreakpoint[i].oldwritebyte = NULL;
       context->bp.memorybreakpoint[i].oldwriteword = NULL;
       context->bp.memorybreakpoint[i].oldwritelong = NULL;
+      context->bp.memorybreakpoint[i].oldreadpage = NULL;
+      context->bp.memorybreakpoint[i].oldwritepage = NULL;
    }
    context->bp.nummemorybreakpoints = 0;
 }
@@ -1864,9 +2166,8 @@ u32 FASTCALL AddressArrayReadLong(SH2_struct *sh, u32 addr) {
    {
       int way = (sh->onchip.CCR >> 6) & 3;
       int entry = (addr & 0x3FC) >> 4;
-      u32 data = sh->onchip.cache.way[way][entry].tag;
+      u32 data = sh->onchip.cache.tag[entry][way];
       data |= sh->onchip.cache.lru[entry] << 4;
-      data |= sh->onchip.cache.way[way][entry].v << 2;
       return data;
    }
    else
@@ -1880,8 +2181,7 @@ void FASTCALL AddressArrayWriteLong(SH2_struct *sh, u32 addr, u32 val)  {
    {
       int way = (sh->onchip.CCR >> 6) & 3;
       int entry = (addr & 0x3FC) >> 4;
-      sh->onchip.cache.way[way][entry].tag = addr & 0x1FFFFC00;
-      sh->onchip.cache.way[way][entry].v = (addr >> 2) & 1;
+      sh->onchip.cache.tag[entry][way] = addr & (0x1FFFFC00 | CACHE_TAG_VALID);
       sh->onchip.cache.lru[entry] = (val >> 4) & 0x3f;
    }
    else
@@ -1895,7 +2195,7 @@ u8 FASTCALL DataArrayReadByte(SH2_struct *sh, u32 addr) {
    {
       int way = (addr >> 10) & 3;
       int entry = (addr >> 4) & 0x3f;
-      return sh->onchip.cache.way[way][entry].data[addr & 0xf];
+      return sh->onchip.cache.data[entry][way][addr & 0xf];
    }
    else
       return T2ReadByte(sh->DataArray, addr & 0xFFF);
@@ -1908,7 +2208,7 @@ u16 FASTCALL DataArrayReadWord(SH2_struct *sh, u32 addr) {
    {
       int way = (addr >> 10) & 3;
       int entry = (addr >> 4) & 0x3f;
-      return ((u16)(sh->onchip.cache.way[way][entry].data[addr & 0xf]) << 8) | sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 1];
+      return ((u16)(sh->onchip.cache.data[entry][way][addr & 0xf]) << 8) | sh->onchip.cache.data[entry][way][(addr & 0xf) + 1];
    }
    else
       return T2ReadWord(sh->DataArray, addr & 0xFFF);
@@ -1921,10 +2221,10 @@ u32 FASTCALL DataArrayReadLong(SH2_struct *sh, u32 addr) {
    {
       int way = (addr >> 10) & 3;
       int entry = (addr >> 4) & 0x3f;
-      u32 data = ((u32)(sh->onchip.cache.way[way][entry].data[addr & 0xf]) << 24) |
-         ((u32)(sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 1]) << 16) |
-         ((u32)(sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 2]) << 8) |
-         ((u32)(sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 3]) << 0);
+      u32 data = ((u32)(sh->onchip.cache.data[entry][way][addr & 0xf]) << 24) |
+         ((u32)(sh->onchip.cache.data[entry][way][(addr & 0xf) + 1]) << 16) |
+         ((u32)(sh->onchip.cache.data[entry][way][(addr & 0xf) + 2]) << 8) |
+         ((u32)(sh->onchip.cache.data[entry][way][(addr & 0xf) + 3]) << 0);
       return data;
    }
    else
@@ -1938,7 +2238,7 @@ void FASTCALL DataArrayWriteByte(SH2_struct *sh, u32 addr, u8 val)  {
    {
       int way = (addr >> 10) & 3;
       int entry = (addr >> 4) & 0x3f;
-      sh->onchip.cache.way[way][entry].data[addr & 0xf] = val;
+      sh->onchip.cache.data[entry][way][addr & 0xf] = val;
    }
    else
       T2WriteByte(sh->DataArray, addr & 0xFFF, val);
@@ -1951,8 +2251,8 @@ void FASTCALL DataArrayWriteWord(SH2_struct *sh, u32 addr, u16 val)  {
    {
       int way = (addr >> 10) & 3;
       int entry = (addr >> 4) & 0x3f;
-      sh->onchip.cache.way[way][entry].data[addr & 0xf] = val >> 8;
-      sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 1] = val;
+      sh->onchip.cache.data[entry][way][addr & 0xf] = val >> 8;
+      sh->onchip.cache.data[entry][way][(addr & 0xf) + 1] = val;
    }
    else
       T2WriteWord(sh->DataArray, addr & 0xFFF, val);
@@ -1965,10 +2265,10 @@ void FASTCALL DataArrayWriteLong(SH2_struct *sh, u32 addr, u32 val)  {
    {
       int way = (addr >> 10) & 3;
       int entry = (addr >> 4) & 0x3f;
-      sh->onchip.cache.way[way][entry].data[(addr & 0xf)] = ((val >> 24) & 0xFF);
-      sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 1] = ((val >> 16) & 0xFF);
-      sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 2] = ((val >> 8) & 0xFF);
-      sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 3] = ((val >> 0) & 0xFF);
+      sh->onchip.cache.data[entry][way][(addr & 0xf)] = ((val >> 24) & 0xFF);
+      sh->onchip.cache.data[entry][way][(addr & 0xf) + 1] = ((val >> 16) & 0xFF);
+      sh->onchip.cache.data[entry][way][(addr & 0xf) + 2] = ((val >> 8) & 0xFF);
+      sh->onchip.cache.data[entry][way][(addr & 0xf) + 3] = ((val >> 0) & 0xFF);
    }
    else
       T2WriteLong(sh->DataArray, addr & 0xFFF, val);
@@ -2595,10 +2895,7 @@ void dma_tick(SH2_struct *sh, u32 *CHCR, u32 *SAR, u32 *DAR, u32 *TCR, u32 *VCRD
       dst_increment *= 4;
    }
 
-   if(dst_increment > 0)
-      SH2WriteNotify(*DAR, *DAR + dst_increment);
-   else
-      SH2WriteNotify(*DAR + dst_increment, *DAR);
+   SH2WriteNotify(*DAR, 1 << check_size);
 
    *TCR = *TCR - 1;
    *SAR = *SAR + src_increment;
@@ -2812,32 +3109,39 @@ void DMATransfer(SH2_struct *sh, u32 *CHCR, u32 *SAR, u32 *DAR, u32 *TCR, u32 *V
 // Input Capture Specific
 //////////////////////////////////////////////////////////////////////////////
 
-void FASTCALL MSH2InputCaptureWriteWord(SH2_struct *sh, UNUSED u32 addr, UNUSED u16 data)
+static void SH2InputCapture(SH2_struct *sh)
 {
    // Set Input Capture Flag
-   MSH2->onchip.FTCSR |= 0x80;
+   sh->onchip.FTCSR |= 0x80;
 
    // Copy FRC register to FICR
-   MSH2->onchip.FICR = MSH2->onchip.FRC.all;
+   sh->onchip.FICR = sh->onchip.FRC.all;
 
    // Time for an Interrupt?
-   if (MSH2->onchip.TIER & 0x80)
-      SH2SendInterrupt(MSH2, (MSH2->onchip.VCRC >> 8) & 0x7F, (MSH2->onchip.IPRB >> 8) & 0xF);
+   if (sh->onchip.TIER & 0x80)
+      SH2SendInterrupt(sh, (sh->onchip.VCRC >> 8) & 0x7F, (sh->onchip.IPRB >> 8) & 0xF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-void FASTCALL SSH2InputCaptureWriteWord(SH2_struct *sh, UNUSED u32 addr, UNUSED u16 data)
+void FASTCALL MSH2InputCaptureWriteWord(SH2_struct *sh, UNUSED u32 addr, UNUSED u16 data)
 {
-   // Set Input Capture Flag
-   SSH2->onchip.FTCSR |= 0x80;
+   // The master may be running on the other thread
+   if (UNLIKELY(sh2_parallel))
+      SH2Defer(MSH2, SH2_DEFER_INPUTCAPTURE, 0, 0);
+   else
+      SH2InputCapture(MSH2);
+}
 
-   // Copy FRC register to FICR
-   SSH2->onchip.FICR = SSH2->onchip.FRC.all;
+//////////////////////////////////////////////////////////////////////////////
 
-   // Time for an Interrupt?
-   if (SSH2->onchip.TIER & 0x80)
-      SH2SendInterrupt(SSH2, (SSH2->onchip.VCRC >> 8) & 0x7F, (SSH2->onchip.IPRB >> 8) & 0xF);
+void FASTCALL SSH2InputCaptureWriteWord(SH2_struct *sh, UNUSED u32 addr, UNUSED u16 data)
+{
+   // The slave may be running on the other thread
+   if (UNLIKELY(sh2_parallel))
+      SH2Defer(SSH2, SH2_DEFER_INPUTCAPTURE, 0, 0);
+   else
+      SH2InputCapture(SSH2);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -2862,16 +3166,16 @@ int SH2SaveState(SH2_struct *context, void ** stream)
 
 	if (context->model == SHMT_SH1)
 	{
-		offset = MemStateWriteHeader(stream, "SH1 ", 1);
+		offset = MemStateWriteHeader(stream, "SH1 ", 2);
 	}
 	else if (context->model == SHMT_SH2)
 	{
 		// Write header
 		if (context->isslave == 0)
-			offset = MemStateWriteHeader(stream, "MSH2", 1);
+			offset = MemStateWriteHeader(stream, "MSH2", 2);
 		else
 		{
-			offset = MemStateWriteHeader(stream, "SSH2", 1);
+			offset = MemStateWriteHeader(stream, "SSH2", 2);
 			MemStateWrite((void *)&yabsys.IsSSH2Running, 1, 1, stream);
 		}
 	}
@@ -2911,7 +3215,7 @@ int SH2SaveState(SH2_struct *context, void ** stream)
 
 //////////////////////////////////////////////////////////////////////////////
 
-int SH2LoadState(SH2_struct *context, const void * stream, UNUSED int version, int size)
+int SH2LoadState(SH2_struct *context, const void * stream, int version, int size)
 {
    sh2regs_struct regs;
 
@@ -2923,7 +3227,18 @@ int SH2LoadState(SH2_struct *context, const void * stream, UNUSED int version, i
    SH2SetRegisters(context, &regs);
 
    // Read onchip registers
-   MemStateRead((void *)&context->onchip, sizeof(Onchip_struct), 1, stream);
+   if (version < 2)
+   {
+      // Version 1 states have the cache lines in the old layout
+      cache_enty_v1 cache;
+
+      MemStateRead((void *)&context->onchip, offsetof(Onchip_struct, cache), 1, stream);
+      MemStateRead((void *)&cache, sizeof(cache_enty_v1), 1, stream);
+      MemStateRead((void *)&context->onchip.dma0_active, sizeof(Onchip_struct) - offsetof(Onchip_struct, dma0_active), 1, stream);
+      cache_load_v1(&context->onchip.cache, &cache);
+   }
+   else
+      MemStateRead((void *)&context->onchip, sizeof(Onchip_struct), 1, stream);
 
    // Read internal variables
    MemStateRead((void *)&context->frc, sizeof(context->frc), 1, stream);
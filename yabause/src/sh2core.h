@@ -24,6 +24,7 @@
 #include "core.h"
 #include "memory.h"
 #include "sh2cache.h"
+#include "threads.h"
 
 #define SH2CORE_DEFAULT     -1
 #define MAX_INTERRUPTS 50
@@ -306,6 +307,8 @@ typedef struct
   writebytefunc oldwritebyte;
   writewordfunc oldwriteword;
   writelongfunc oldwritelong;
+  u8 *oldreadpage;
+  u8 *oldwritepage;
 } memorybreakpoint_struct;
 
 #define MAX_BREAKPOINTS 10
@@ -374,6 +377,10 @@ struct SH2_struct
    readwordfunc ReadWordList[0x1000];
    readlongfunc ReadLongList[0x1000];
 
+   // Host memory backing each 64KB page, NULL if it needs the handler
+   u8 *ReadPageList[0x1000];
+   u8 *WritePageList[0x1000];
+
    writebytefunc MappedMemoryWriteByte;
    writewordfunc MappedMemoryWriteWord;
    writelongfunc MappedMemoryWriteLong;
@@ -409,6 +416,7 @@ struct SH2_struct
    u32 cycles;
    u8 isslave;
    u8 isIdle;
+   u64 idleCycles;   // cycles skipped in idle loops since SH2Init
    u8 isSleeping;
    u16 instruction;
    u8 breakpointEnabled;
@@ -543,10 +551,115 @@ u32 *SH2GetBacktraceList(SH2_struct *context, int *size);
 void SH2HandleStepOverOut(SH2_struct *context);
 void SH2HandleTrackInfLoop(SH2_struct *context);
 
+extern int sh2_parallel;
+extern YabMutex *sh2_bus_mutex;
+
+int SH2ThreadStart(u32 skew);
+void SH2ThreadStop(void);
+int SH2ThreadRunning(void);
+void SH2ExecParallel(u32 cycles);
+
+// Handlers for devices shared by both SH2s have to be called with the bus
+// locked while the slave is running on its own thread
+static INLINE void SH2BusLock(void)
+{
+   if (UNLIKELY(sh2_parallel))
+      YabThreadLock(sh2_bus_mutex);
+}
+
+static INLINE void SH2BusUnLock(void)
+{
+   if (UNLIKELY(sh2_parallel))
+      YabThreadUnLock(sh2_bus_mutex);
+}
+
 void DMAExec(SH2_struct *sh);
 void DMATransfer(SH2_struct *sh, u32 *CHCR, u32 *SAR, u32 *DAR, u32 *TCR, u32 *VCRDMA);
 void sh2_dma_exec(SH2_struct *sh, u32 cycles);
 
+// Direct access to plain memory pages(work ram, bios) through the host page
+// lists, falling back to the NoPage functions for everything else. The pages
+// are stored in T2 format.
+
+u8 FASTCALL SH2MemoryReadByteNoPage(SH2_struct *sh, u32 addr);
+u16 FASTCALL SH2MemoryReadWordNoPage(SH2_struct *sh, u32 addr);
+u32 FASTCALL SH2MemoryReadLongNoPage(SH2_struct *sh, u32 addr);
+void FASTCALL SH2MemoryWriteByteNoPage(SH2_struct *sh, u32 addr, u8 val);
+void FASTCALL SH2MemoryWriteWordNoPage(SH2_struct *sh, u32 addr, u16 val);
+void FASTCALL SH2MemoryWriteLongNoPage(SH2_struct *sh, u32 addr, u32 val);
+
+static INLINE u8 *SH2GetReadPage(SH2_struct *sh, u32 addr)
+{
+   // Only the cached(0x0), cache-through(0x1 and 0x5) areas are listed
+   if ((0x23 >> (addr >> 29)) & 1)
+      return sh->ReadPageList[(addr >> 16) & 0xFFF];
+   return NULL;
+}
+
+static INLINE u8 *SH2GetWritePage(SH2_struct *sh, u32 addr)
+{
+   if ((0x23 >> (addr >> 29)) & 1)
+      return sh->WritePageList[(addr >> 16) & 0xFFF];
+   return NULL;
+}
+
+static INLINE u8 SH2MemoryReadByte(SH2_struct *sh, u32 addr)
+{
+   u8 *page = SH2GetReadPage(sh, addr);
+
+   if (page)
+      return T2ReadByte(page, addr & 0xFFFF);
+   return SH2MemoryReadByteNoPage(sh, addr);
+}
+
+static INLINE u16 SH2MemoryReadWord(SH2_struct *sh, u32 addr)
+{
+   u8 *page = SH2GetReadPage(sh, addr);
+
+   if (page)
+      return T2ReadWord(page, addr & 0xFFFF);
+   return SH2MemoryReadWordNoPage(sh, addr);
+}
+
+static INLINE u32 SH2MemoryReadLong(SH2_struct *sh, u32 addr)
+{
+   u8 *page = SH2GetReadPage(sh, addr);
+
+   if (page)
+      return T2ReadLong(page, addr & 0xFFFF);
+   return SH2MemoryReadLongNoPage(sh, addr);
+}
+
+static INLINE void SH2MemoryWriteByte(SH2_struct *sh, u32 addr, u8 val)
+{
+   u8 *page = SH2GetWritePage(sh, addr);
+
+   if (page)
+      T2WriteByte(page, addr & 0xFFFF, val);
+   else
+      SH2MemoryWriteByteNoPage(sh, addr, val);
+}
+
+static INLINE void SH2MemoryWriteWord(SH2_struct *sh, u32 addr, u16 val)
+{
+   u8 *page = SH2GetWritePage(sh, addr);
+
+   if (page)
+      T2WriteWord(page, addr & 0xFFFF, val);
+   else
+      SH2MemoryWriteWordNoPage(sh, addr, val);
+}
+
+static INLINE void SH2MemoryWriteLong(SH2_struct *sh, u32 addr, u32 val)
+{
+   u8 *page = SH2GetWritePage(sh, addr);
+
+   if (page)
+      T2WriteLong(page, addr & 0xFFFF, val);
+   else
+      SH2MemoryWriteLongNoPage(sh, addr, val);
+}
+
 u8 FASTCALL OnchipReadByte(SH2_struct *sh, u32 addr);
 u16 FASTCALL OnchipReadWord(SH2_struct *sh, u32 addr);
 u32 FASTCALL OnchipReadLong(SH2_struct *sh, u32 addr);
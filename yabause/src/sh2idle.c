@@ -444,6 +444,8 @@ static u32 oldCheckCount = 0;
 
 #define DROP_IDLE {\
     idleCheckCount += cycles - context->cycles; \
+    if (context->cycles < cycles) \
+      context->idleCycles += cycles - context->cycles; \
     context->cycles = cycles;}
 #define IDLE_VERBOSE_SH2_COUNT {\
    sh2cycleCount += cycles; \
@@ -455,7 +457,10 @@ static u32 oldCheckCount = 0;
       sh2oldCycleCount = sh2cycleCount; \
     }}
 #else
-#define DROP_IDLE context->cycles = cycles;
+#define DROP_IDLE {\
+    if (context->cycles < cycles) \
+      context->idleCycles += cycles - context->cycles; \
+    context->cycles = cycles;}
 #define IDLE_VERBOSE_SH2_COUNT
 #endif
 
@@ -620,6 +625,57 @@ void FASTCALL SH2idleParse( SH2_struct *context, u32 cycles ) {
   }
 }
 
+static int SH2idleIsBranch(u16 instruction) {
+  // branches can't be followed without executing, recompilers only hand
+  // over straight loops
+
+  switch (INSTRUCTION_A(instruction))
+    {
+    case 0: return INSTRUCTION_D(instruction) == 3 || INSTRUCTION_D(instruction) == 11; //braf, bsrf, rts, sleep, rte
+    case 4: return INSTRUCTION_D(instruction) == 11 && INSTRUCTION_C(instruction) != 1; //jsr, jmp
+    case 8: return INSTRUCTION_B(instruction) >= 9 && (INSTRUCTION_B(instruction) & 1); //bt, bf, bts, bfs
+    case 10: //bra
+    case 11: return 1; //bsr
+    case 12: return INSTRUCTION_B(instruction) == 3; //trapa
+    }
+  return 0;
+}
+
+int FASTCALL SH2idleLoopCheck(const u16 *loop, int count) {
+  // try to find an idle loop while translating : <loop> holds <count>
+  // instructions, from the loop start to the branch back to it, followed by
+  // the delay slot of a delayed branch. Same test as SH2idleCheck, without
+  // executing the loop
+
+  u16 branch = loop[count-1];
+  u8 isDelayed = INSTRUCTION_A(branch)==10 || ( INSTRUCTION_A(branch)==8 && INSTRUCTION_B(branch)>=13 );
+  int pass, i;
+
+  if ( INSTRUCTION_A(branch)!=10 && ( INSTRUCTION_A(branch)!=8 || !SH2idleIsBranch(branch) ) )
+    return 0; // only bt, bf, bts, bfs and bra loops
+  if ( isDelayed && SH2idleIsBranch(loop[count]) ) return 0;
+
+  bDet = bChg = 0; // initialize markers
+
+  for ( pass = 0; pass < 2; pass++ ) {
+
+    if ( isDelayed )
+      if ( !SH2idleCheckIterate(NULL,loop[count],0) ) return 0;
+
+    for ( i = 0; i < count-1; i++ )
+      if ( SH2idleIsBranch(loop[i]) || !SH2idleCheckIterate(NULL,loop[i],0) ) return 0;
+
+    // Mark unchanged registers as deterministic registers
+
+    if ( pass == 0 ) {
+      bDet = ~bChg;
+      bDet |= destCONST;
+    }
+  }
+
+  return !~bDet;
+}
+
 /* ------------------------------------------------------ */
 /* Code markers                                           */
 /*
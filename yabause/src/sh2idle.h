@@ -22,5 +22,6 @@
 
 void FASTCALL SH2idleCheck(SH2_struct *context, u32 cycles);
 void FASTCALL SH2idleParse(SH2_struct *context, u32 cycles);
+int FASTCALL SH2idleLoopCheck(const u16 *loop, int count);
 
 #endif
@@ -111,6 +111,42 @@ SH2Interface_struct SH2DebugInterpreter = {
    NULL  // SH2WriteNotify not used
 };
 
+SH2Interface_struct SH2CachedInterpreter = {
+   SH2CORE_CACHEDINTERPRETER,
+   "SH2 Interpreter (Decode Cache)",
+
+   SH2CachedInterpreterInit,
+   SH2CachedInterpreterDeInit,
+   SH2InterpreterReset,
+   SH2CachedInterpreterExec,
+
+   SH2InterpreterGetRegisters,
+   SH2InterpreterGetGPR,
+   SH2InterpreterGetSR,
+   SH2InterpreterGetGBR,
+   SH2InterpreterGetVBR,
+   SH2InterpreterGetMACH,
+   SH2InterpreterGetMACL,
+   SH2InterpreterGetPR,
+   SH2InterpreterGetPC,
+
+   SH2InterpreterSetRegisters,
+   SH2InterpreterSetGPR,
+   SH2InterpreterSetSR,
+   SH2InterpreterSetGBR,
+   SH2InterpreterSetVBR,
+   SH2InterpreterSetMACH,
+   SH2InterpreterSetMACL,
+   SH2InterpreterSetPR,
+   SH2InterpreterSetPC,
+
+   SH2InterpreterSendInterrupt,
+   SH2InterpreterGetInterrupts,
+   SH2InterpreterSetInterrupts,
+
+   SH2CachedInterpreterWriteNotify
+};
+
 //////////////////////////////////////////////////////////////////////////////
 
 int sh2_check_wait(SH2_struct * sh, u32 addr, int size)
@@ -242,18 +278,18 @@ static void FASTCALL SH2undecoded(SH2_struct * sh)
 
    // Save regs.SR on stack
    sh->regs.R[15]-=4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[15],sh->regs.SR.all);
+   SH2MemoryWriteLong(sh, sh->regs.R[15],sh->regs.SR.all);
 
    // Save regs.PC on stack
    sh->regs.R[15]-=4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[15],sh->regs.PC + 2);
+   SH2MemoryWriteLong(sh, sh->regs.R[15],sh->regs.PC + 2);
 
    // What caused the exception? The delay slot or a general instruction?
    // 4 for General Instructions, 6 for delay slot
    vectnum = 4; //  Fix me
 
    // Jump to Exception service routine
-   sh->regs.PC = sh->MappedMemoryReadLong(sh, sh->regs.VBR+(vectnum<<2));
+   sh->regs.PC = SH2MemoryReadLong(sh, sh->regs.VBR+(vectnum<<2));
    sh->cycles++;
 }
 
@@ -365,9 +401,9 @@ static void FASTCALL SH2andm(SH2_struct * sh)
    s32 temp;
    s32 source = INSTRUCTION_CD(sh->instruction);
 
-   temp = (s32)sh->MappedMemoryReadByte(sh, sh->regs.GBR + sh->regs.R[0]);
+   temp = (s32)SH2MemoryReadByte(sh, sh->regs.GBR + sh->regs.R[0]);
    temp &= source;
-   sh->MappedMemoryWriteByte(sh, (sh->regs.GBR + sh->regs.R[0]),temp);
+   SH2MemoryWriteByte(sh, (sh->regs.GBR + sh->regs.R[0]),temp);
    sh->regs.PC += 2;
    sh->cycles += 3;
 }
@@ -969,7 +1005,7 @@ static void FASTCALL SH2ldcmgbr(SH2_struct * sh)
 {
    s32 m = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.GBR = sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   sh->regs.GBR = SH2MemoryReadLong(sh, sh->regs.R[m]);
    sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles += 3;
@@ -981,7 +1017,7 @@ static void FASTCALL SH2ldcmsr(SH2_struct * sh)
 {
    s32 m = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.SR.all = sh->MappedMemoryReadLong(sh, sh->regs.R[m]) & 0x000003F3;
+   sh->regs.SR.all = SH2MemoryReadLong(sh, sh->regs.R[m]) & 0x000003F3;
    sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles += 3;
@@ -993,7 +1029,7 @@ static void FASTCALL SH2ldcmvbr(SH2_struct * sh)
 {
    s32 m = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.VBR = sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   sh->regs.VBR = SH2MemoryReadLong(sh, sh->regs.R[m]);
    sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles += 3;
@@ -1042,7 +1078,7 @@ static void FASTCALL SH2ldsmacl(SH2_struct * sh)
 static void FASTCALL SH2ldsmmach(SH2_struct * sh)
 {
    s32 m = INSTRUCTION_B(sh->instruction);
-   sh->regs.MACH = sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   sh->regs.MACH = SH2MemoryReadLong(sh, sh->regs.R[m]);
    sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1053,7 +1089,7 @@ static void FASTCALL SH2ldsmmach(SH2_struct * sh)
 static void FASTCALL SH2ldsmmacl(SH2_struct * sh)
 {
    s32 m = INSTRUCTION_B(sh->instruction);
-   sh->regs.MACL = sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   sh->regs.MACL = SH2MemoryReadLong(sh, sh->regs.R[m]);
    sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1064,7 +1100,7 @@ static void FASTCALL SH2ldsmmacl(SH2_struct * sh)
 static void FASTCALL SH2ldsmpr(SH2_struct * sh)
 {
    s32 m = INSTRUCTION_B(sh->instruction);
-   sh->regs.PR = sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   sh->regs.PR = SH2MemoryReadLong(sh, sh->regs.R[m]);
    sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1089,9 +1125,9 @@ static void FASTCALL SH2macl(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   tempn = (s32)sh->MappedMemoryReadLong(sh, sh->regs.R[n]);
+   tempn = (s32)SH2MemoryReadLong(sh, sh->regs.R[n]);
    sh->regs.R[n] += 4;
-   tempm = (s32)sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   tempm = (s32)SH2MemoryReadLong(sh, sh->regs.R[m]);
    sh->regs.R[m] += 4;
 
    if ((s32) (tempn^tempm) < 0)
@@ -1182,9 +1218,9 @@ static void FASTCALL SH2macw(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   tempn=(s32)sh->MappedMemoryReadWord(sh, sh->regs.R[n]);
+   tempn=(s32)SH2MemoryReadWord(sh, sh->regs.R[n]);
    sh->regs.R[n]+=2;
-   tempm=(s32)sh->MappedMemoryReadWord(sh, sh->regs.R[m]);
+   tempm=(s32)SH2MemoryReadWord(sh, sh->regs.R[m]);
    sh->regs.R[m]+=2;
    templ=sh->regs.MACL;
    tempm=((s32)(s16)tempn*(s32)(s16)tempm);
@@ -1257,7 +1293,7 @@ static void FASTCALL SH2movbl(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = (s32)(s8)sh->MappedMemoryReadByte(sh, sh->regs.R[m]);
+   sh->regs.R[n] = (s32)(s8)SH2MemoryReadByte(sh, sh->regs.R[m]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1269,7 +1305,7 @@ static void FASTCALL SH2movbl0(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = (s32)(s8)sh->MappedMemoryReadByte(sh, sh->regs.R[m] + sh->regs.R[0]);
+   sh->regs.R[n] = (s32)(s8)SH2MemoryReadByte(sh, sh->regs.R[m] + sh->regs.R[0]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1281,7 +1317,7 @@ static void FASTCALL SH2movbl4(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 disp = INSTRUCTION_D(sh->instruction);
 
-   sh->regs.R[0] = (s32)(s8)sh->MappedMemoryReadByte(sh, sh->regs.R[m] + disp);
+   sh->regs.R[0] = (s32)(s8)SH2MemoryReadByte(sh, sh->regs.R[m] + disp);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1292,7 +1328,7 @@ static void FASTCALL SH2movblg(SH2_struct * sh)
 {
    s32 disp = INSTRUCTION_CD(sh->instruction);
   
-   sh->regs.R[0] = (s32)(s8)sh->MappedMemoryReadByte(sh, sh->regs.GBR + disp);
+   sh->regs.R[0] = (s32)(s8)SH2MemoryReadByte(sh, sh->regs.GBR + disp);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1304,7 +1340,7 @@ static void FASTCALL SH2movbm(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->MappedMemoryWriteByte(sh, (sh->regs.R[n] - 1),sh->regs.R[m]);
+   SH2MemoryWriteByte(sh, (sh->regs.R[n] - 1),sh->regs.R[m]);
    sh->regs.R[n] -= 1;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1317,7 +1353,7 @@ static void FASTCALL SH2movbp(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = (s32)(s8)sh->MappedMemoryReadByte(sh, sh->regs.R[m]);
+   sh->regs.R[n] = (s32)(s8)SH2MemoryReadByte(sh, sh->regs.R[m]);
    if (n != m)
      sh->regs.R[m] += 1;
    sh->regs.PC += 2;
@@ -1331,7 +1367,7 @@ static void FASTCALL SH2movbs(SH2_struct * sh)
    int b = INSTRUCTION_B(sh->instruction);
    int c = INSTRUCTION_C(sh->instruction);
 
-   sh->MappedMemoryWriteByte(sh, sh->regs.R[b], sh->regs.R[c]);
+   SH2MemoryWriteByte(sh, sh->regs.R[b], sh->regs.R[c]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1340,7 +1376,7 @@ static void FASTCALL SH2movbs(SH2_struct * sh)
 
 static void FASTCALL SH2movbs0(SH2_struct * sh)
 {
-   sh->MappedMemoryWriteByte(sh, sh->regs.R[INSTRUCTION_B(sh->instruction)] + sh->regs.R[0],
+   SH2MemoryWriteByte(sh, sh->regs.R[INSTRUCTION_B(sh->instruction)] + sh->regs.R[0],
                          sh->regs.R[INSTRUCTION_C(sh->instruction)]);
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1353,7 +1389,7 @@ static void FASTCALL SH2movbs4(SH2_struct * sh)
    s32 disp = INSTRUCTION_D(sh->instruction);
    s32 n = INSTRUCTION_C(sh->instruction);
 
-   sh->MappedMemoryWriteByte(sh, sh->regs.R[n]+disp,sh->regs.R[0]);
+   SH2MemoryWriteByte(sh, sh->regs.R[n]+disp,sh->regs.R[0]);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1364,7 +1400,7 @@ static void FASTCALL SH2movbsg(SH2_struct * sh)
 {
    s32 disp = INSTRUCTION_CD(sh->instruction);
 
-   sh->MappedMemoryWriteByte(sh, sh->regs.GBR + disp,sh->regs.R[0]);
+   SH2MemoryWriteByte(sh, sh->regs.GBR + disp,sh->regs.R[0]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1388,7 +1424,7 @@ static void FASTCALL SH2movli(SH2_struct * sh)
    s32 disp = INSTRUCTION_CD(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = sh->MappedMemoryReadLong(sh, ((sh->regs.PC + 4) & 0xFFFFFFFC) + (disp << 2));
+   sh->regs.R[n] = SH2MemoryReadLong(sh, ((sh->regs.PC + 4) & 0xFFFFFFFC) + (disp << 2));
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1405,7 +1441,7 @@ static void FASTCALL SH2movll(SH2_struct * sh)
       return;
    }
 
-   sh->regs.R[INSTRUCTION_B(sh->instruction)] = sh->MappedMemoryReadLong(sh, addr);
+   sh->regs.R[INSTRUCTION_B(sh->instruction)] = SH2MemoryReadLong(sh, addr);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1414,7 +1450,7 @@ static void FASTCALL SH2movll(SH2_struct * sh)
 
 static void FASTCALL SH2movll0(SH2_struct * sh)
 {
-   sh->regs.R[INSTRUCTION_B(sh->instruction)] = sh->MappedMemoryReadLong(sh, sh->regs.R[INSTRUCTION_C(sh->instruction)] + sh->regs.R[0]);
+   sh->regs.R[INSTRUCTION_B(sh->instruction)] = SH2MemoryReadLong(sh, sh->regs.R[INSTRUCTION_C(sh->instruction)] + sh->regs.R[0]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1427,7 +1463,7 @@ static void FASTCALL SH2movll4(SH2_struct * sh)
    s32 disp = INSTRUCTION_D(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = sh->MappedMemoryReadLong(sh, sh->regs.R[m] + (disp << 2));
+   sh->regs.R[n] = SH2MemoryReadLong(sh, sh->regs.R[m] + (disp << 2));
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1438,7 +1474,7 @@ static void FASTCALL SH2movllg(SH2_struct * sh)
 {
    s32 disp = INSTRUCTION_CD(sh->instruction);
 
-   sh->regs.R[0] = sh->MappedMemoryReadLong(sh, sh->regs.GBR + (disp << 2));
+   sh->regs.R[0] = SH2MemoryReadLong(sh, sh->regs.GBR + (disp << 2));
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1450,7 +1486,7 @@ static void FASTCALL SH2movlm(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n] - 4,sh->regs.R[m]);
+   SH2MemoryWriteLong(sh, sh->regs.R[n] - 4,sh->regs.R[m]);
    sh->regs.R[n] -= 4;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1463,7 +1499,7 @@ static void FASTCALL SH2movlp(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   sh->regs.R[n] = SH2MemoryReadLong(sh, sh->regs.R[m]);
    if (n != m) sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1476,7 +1512,7 @@ static void FASTCALL SH2movls(SH2_struct * sh)
    int b = INSTRUCTION_B(sh->instruction);
    int c = INSTRUCTION_C(sh->instruction);
 
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[b], sh->regs.R[c]);
+   SH2MemoryWriteLong(sh, sh->regs.R[b], sh->regs.R[c]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1485,7 +1521,7 @@ static void FASTCALL SH2movls(SH2_struct * sh)
 
 static void FASTCALL SH2movls0(SH2_struct * sh)
 {
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[INSTRUCTION_B(sh->instruction)] + sh->regs.R[0],
+   SH2MemoryWriteLong(sh, sh->regs.R[INSTRUCTION_B(sh->instruction)] + sh->regs.R[0],
                          sh->regs.R[INSTRUCTION_C(sh->instruction)]);
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1499,7 +1535,7 @@ static void FASTCALL SH2movls4(SH2_struct * sh)
    s32 disp = INSTRUCTION_D(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n]+(disp<<2),sh->regs.R[m]);
+   SH2MemoryWriteLong(sh, sh->regs.R[n]+(disp<<2),sh->regs.R[m]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1510,7 +1546,7 @@ static void FASTCALL SH2movlsg(SH2_struct * sh)
 {
    s32 disp = INSTRUCTION_CD(sh->instruction);
 
-   sh->MappedMemoryWriteLong(sh, sh->regs.GBR+(disp<<2),sh->regs.R[0]);
+   SH2MemoryWriteLong(sh, sh->regs.GBR+(disp<<2),sh->regs.R[0]);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1531,7 +1567,7 @@ static void FASTCALL SH2movwi(SH2_struct * sh)
    s32 disp = INSTRUCTION_CD(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = (s32)(s16)sh->MappedMemoryReadWord(sh, sh->regs.PC + (disp<<1) + 4);
+   sh->regs.R[n] = (s32)(s16)SH2MemoryReadWord(sh, sh->regs.PC + (disp<<1) + 4);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1550,7 +1586,7 @@ static void FASTCALL SH2movwl(SH2_struct * sh)
       return;
    }
 
-   sh->regs.R[n] = (s32)(s16)sh->MappedMemoryReadWord(sh, addr);
+   sh->regs.R[n] = (s32)(s16)SH2MemoryReadWord(sh, addr);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1562,7 +1598,7 @@ static void FASTCALL SH2movwl0(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = (s32)(s16)sh->MappedMemoryReadWord(sh, sh->regs.R[m]+sh->regs.R[0]);
+   sh->regs.R[n] = (s32)(s16)SH2MemoryReadWord(sh, sh->regs.R[m]+sh->regs.R[0]);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1574,7 +1610,7 @@ static void FASTCALL SH2movwl4(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 disp = INSTRUCTION_D(sh->instruction);
 
-   sh->regs.R[0] = (s32)(s16)sh->MappedMemoryReadWord(sh, sh->regs.R[m]+(disp<<1));
+   sh->regs.R[0] = (s32)(s16)SH2MemoryReadWord(sh, sh->regs.R[m]+(disp<<1));
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1585,7 +1621,7 @@ static void FASTCALL SH2movwlg(SH2_struct * sh)
 {
    s32 disp = INSTRUCTION_CD(sh->instruction);
 
-   sh->regs.R[0] = (s32)(s16)sh->MappedMemoryReadWord(sh, sh->regs.GBR+(disp<<1));
+   sh->regs.R[0] = (s32)(s16)SH2MemoryReadWord(sh, sh->regs.GBR+(disp<<1));
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1597,7 +1633,7 @@ static void FASTCALL SH2movwm(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->MappedMemoryWriteWord(sh, sh->regs.R[n] - 2,sh->regs.R[m]);
+   SH2MemoryWriteWord(sh, sh->regs.R[n] - 2,sh->regs.R[m]);
    sh->regs.R[n] -= 2;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1610,7 +1646,7 @@ static void FASTCALL SH2movwp(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = (s32)(s16)sh->MappedMemoryReadWord(sh, sh->regs.R[m]);
+   sh->regs.R[n] = (s32)(s16)SH2MemoryReadWord(sh, sh->regs.R[m]);
    if (n != m)
       sh->regs.R[m] += 2;
    sh->regs.PC += 2;
@@ -1624,7 +1660,7 @@ static void FASTCALL SH2movws(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->MappedMemoryWriteWord(sh, sh->regs.R[n],sh->regs.R[m]);
+   SH2MemoryWriteWord(sh, sh->regs.R[n],sh->regs.R[m]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1633,7 +1669,7 @@ static void FASTCALL SH2movws(SH2_struct * sh)
 
 static void FASTCALL SH2movws0(SH2_struct * sh)
 {
-   sh->MappedMemoryWriteWord(sh, sh->regs.R[INSTRUCTION_B(sh->instruction)] + sh->regs.R[0],
+   SH2MemoryWriteWord(sh, sh->regs.R[INSTRUCTION_B(sh->instruction)] + sh->regs.R[0],
                          sh->regs.R[INSTRUCTION_C(sh->instruction)]);
    sh->regs.PC+=2;
    sh->cycles++;
@@ -1646,7 +1682,7 @@ static void FASTCALL SH2movws4(SH2_struct * sh)
    s32 disp = INSTRUCTION_D(sh->instruction);
    s32 n = INSTRUCTION_C(sh->instruction);
 
-   sh->MappedMemoryWriteWord(sh, sh->regs.R[n]+(disp<<1),sh->regs.R[0]);
+   SH2MemoryWriteWord(sh, sh->regs.R[n]+(disp<<1),sh->regs.R[0]);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1657,7 +1693,7 @@ static void FASTCALL SH2movwsg(SH2_struct * sh)
 {
    s32 disp = INSTRUCTION_CD(sh->instruction);
 
-   sh->MappedMemoryWriteWord(sh, sh->regs.GBR+(disp<<1),sh->regs.R[0]);
+   SH2MemoryWriteWord(sh, sh->regs.GBR+(disp<<1),sh->regs.R[0]);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1769,9 +1805,9 @@ static void FASTCALL SH2orm(SH2_struct * sh)
    s32 temp;
    s32 source = INSTRUCTION_CD(sh->instruction);
 
-   temp = (s32)sh->MappedMemoryReadByte(sh, sh->regs.GBR + sh->regs.R[0]);
+   temp = (s32)SH2MemoryReadByte(sh, sh->regs.GBR + sh->regs.R[0]);
    temp |= source;
-   sh->MappedMemoryWriteByte(sh, sh->regs.GBR + sh->regs.R[0],temp);
+   SH2MemoryWriteByte(sh, sh->regs.GBR + sh->regs.R[0],temp);
    sh->regs.PC += 2;
    sh->cycles += 3;
 }
@@ -1882,9 +1918,9 @@ static void FASTCALL SH2rte(SH2_struct * sh)
 {
    u32 temp;
    temp=sh->regs.PC;
-   sh->regs.PC = sh->MappedMemoryReadLong(sh, sh->regs.R[15]);
+   sh->regs.PC = SH2MemoryReadLong(sh, sh->regs.R[15]);
    sh->regs.R[15] += 4;
-   sh->regs.SR.all = sh->MappedMemoryReadLong(sh, sh->regs.R[15]) & 0x000003F3;
+   sh->regs.SR.all = SH2MemoryReadLong(sh, sh->regs.R[15]) & 0x000003F3;
    sh->regs.R[15] += 4;
    sh->cycles += 4;
    SH2delay(sh, temp + 2);
@@ -2059,7 +2095,7 @@ static void FASTCALL SH2stcmgbr(SH2_struct * sh)
 {
    s32 n = INSTRUCTION_B(sh->instruction);
    sh->regs.R[n]-=4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.GBR);
+   SH2MemoryWriteLong(sh, sh->regs.R[n],sh->regs.GBR);
    sh->regs.PC+=2;
    sh->cycles += 2;
 }
@@ -2070,7 +2106,7 @@ static void FASTCALL SH2stcmsr(SH2_struct * sh)
 {
    s32 n = INSTRUCTION_B(sh->instruction);
    sh->regs.R[n]-=4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.SR.all);
+   SH2MemoryWriteLong(sh, sh->regs.R[n],sh->regs.SR.all);
    sh->regs.PC+=2;
    sh->cycles += 2;
 }
@@ -2081,7 +2117,7 @@ static void FASTCALL SH2stcmvbr(SH2_struct * sh)
 {
    s32 n = INSTRUCTION_B(sh->instruction);
    sh->regs.R[n]-=4;
-   sh->MappedMemoryWriteLong(sh,sh->regs.R[n],sh->regs.VBR);
+   SH2MemoryWriteLong(sh,sh->regs.R[n],sh->regs.VBR);
    sh->regs.PC+=2;
    sh->cycles += 2;
 }
@@ -2132,7 +2168,7 @@ static void FASTCALL SH2stsmmach(SH2_struct * sh)
 {
    s32 n = INSTRUCTION_B(sh->instruction);
    sh->regs.R[n] -= 4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.MACH);
+   SH2MemoryWriteLong(sh, sh->regs.R[n],sh->regs.MACH);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -2143,7 +2179,7 @@ static void FASTCALL SH2stsmmacl(SH2_struct * sh)
 {
    s32 n = INSTRUCTION_B(sh->instruction);
    sh->regs.R[n] -= 4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.MACL);
+   SH2MemoryWriteLong(sh, sh->regs.R[n],sh->regs.MACL);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -2154,7 +2190,7 @@ static void FASTCALL SH2stsmpr(SH2_struct * sh)
 {
    s32 n = INSTRUCTION_B(sh->instruction);
    sh->regs.R[n] -= 4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.PR);
+   SH2MemoryWriteLong(sh, sh->regs.R[n],sh->regs.PR);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -2283,7 +2319,7 @@ static void FASTCALL SH2tas(SH2_struct * sh)
    s32 temp;
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   temp=(s32)sh->MappedMemoryReadByte(sh, sh->regs.R[n]);
+   temp=(s32)SH2MemoryReadByte(sh, sh->regs.R[n]);
 
    if (temp==0)
       sh->regs.SR.part.T=1;
@@ -2291,7 +2327,7 @@ static void FASTCALL SH2tas(SH2_struct * sh)
       sh->regs.SR.part.T=0;
 
    temp|=0x00000080;
-   sh->MappedMemoryWriteByte(sh, sh->regs.R[n],temp);
+   SH2MemoryWriteByte(sh, sh->regs.R[n],temp);
    sh->regs.PC+=2;
    sh->cycles += 4;
 }
@@ -2303,10 +2339,10 @@ static void FASTCALL SH2trapa(SH2_struct * sh)
    s32 imm = INSTRUCTION_CD(sh->instruction);
 
    sh->regs.R[15]-=4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[15],sh->regs.SR.all);
+   SH2MemoryWriteLong(sh, sh->regs.R[15],sh->regs.SR.all);
    sh->regs.R[15]-=4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[15],sh->regs.PC + 2);
-   sh->regs.PC = sh->MappedMemoryReadLong(sh, sh->regs.VBR+(imm<<2));
+   SH2MemoryWriteLong(sh, sh->regs.R[15],sh->regs.PC + 2);
+   sh->regs.PC = SH2MemoryReadLong(sh, sh->regs.VBR+(imm<<2));
    sh->cycles += 8;
 }
 
@@ -2351,7 +2387,7 @@ static void FASTCALL SH2tstm(SH2_struct * sh)
    s32 temp;
    s32 i = INSTRUCTION_CD(sh->instruction);
 
-   temp=(s32)sh->MappedMemoryReadByte(sh, sh->regs.GBR+sh->regs.R[0]);
+   temp=(s32)SH2MemoryReadByte(sh, sh->regs.GBR+sh->regs.R[0]);
    temp&=i;
 
    if (temp==0)
@@ -2392,9 +2428,9 @@ static void FASTCALL SH2xorm(SH2_struct * sh)
    s32 source = INSTRUCTION_CD(sh->instruction);
    s32 temp;
 
-   temp = (s32)sh->MappedMemoryReadByte(sh, sh->regs.GBR + sh->regs.R[0]);
+   temp = (s32)SH2MemoryReadByte(sh, sh->regs.GBR + sh->regs.R[0]);
    temp ^= source;
-   sh->MappedMemoryWriteByte(sh, sh->regs.GBR + sh->regs.R[0],temp);
+   SH2MemoryWriteByte(sh, sh->regs.GBR + sh->regs.R[0],temp);
    sh->regs.PC += 2;
    sh->cycles += 3;
 }
@@ -2853,11 +2889,11 @@ static INLINE void SH2UBCInterrupt(SH2_struct *context, u32 flag)
    if (15 > context->regs.SR.part.I) // Since UBC's interrupt are always level 15
    {
       context->regs.R[15] -= 4;
-      context->MappedMemoryWriteLong(context, context->regs.R[15], context->regs.SR.all);
+      SH2MemoryWriteLong(context, context->regs.R[15], context->regs.SR.all);
       context->regs.R[15] -= 4;
-      context->MappedMemoryWriteLong(context, context->regs.R[15], context->regs.PC);
+      SH2MemoryWriteLong(context, context->regs.R[15], context->regs.PC);
       context->regs.SR.part.I = 15;
-      context->regs.PC = context->MappedMemoryReadLong(context, context->regs.VBR + (12 << 2));
+      context->regs.PC = SH2MemoryReadLong(context, context->regs.VBR + (12 << 2));
       LOG("interrupt successfully handled\n");
    }
    context->onchip.BRCR |= flag;
@@ -2872,11 +2908,11 @@ static INLINE void SH2HandleInterrupts(SH2_struct *context)
       if (context->interrupts[context->NumberOfInterrupts-1].level > context->regs.SR.part.I)
       {
          context->regs.R[15] -= 4;
-         context->MappedMemoryWriteLong(context, context->regs.R[15], context->regs.SR.all);
+         SH2MemoryWriteLong(context, context->regs.R[15], context->regs.SR.all);
          context->regs.R[15] -= 4;
-         context->MappedMemoryWriteLong(context, context->regs.R[15], context->regs.PC);
+         SH2MemoryWriteLong(context, context->regs.R[15], context->regs.PC);
          context->regs.SR.part.I = context->interrupts[context->NumberOfInterrupts-1].level;
-         context->regs.PC = context->MappedMemoryReadLong(context, context->regs.VBR + (context->interrupts[context->NumberOfInterrupts-1].vector << 2));
+         context->regs.PC = SH2MemoryReadLong(context, context->regs.VBR + (context->interrupts[context->NumberOfInterrupts-1].vector << 2));
          context->NumberOfInterrupts--;
          context->isIdle = 0;
          context->isSleeping = 0;
@@ -3029,6 +3065,595 @@ FASTCALL void SH2InterpreterExec(SH2_struct *context, u32 cycles)
    }
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Decode cache
+//
+// Instructions fetched from bios, low and high work ram are kept with their
+// handler in 4KB pages shared by both SH2s, so hot code skips the fetch
+// function and the opcode table. The common moves, adds, compares,
+// conditional branches and loads/stores also keep their register numbers,
+// immediate and cycle count so their handlers don't decode them again on
+// every run. Mirrors fold onto the same page, so nothing in an entry may
+// depend on the address it was fetched from. Entries
+// are cleared by CPU writes (the core wraps the memory write functions) and
+// by SH2WriteNotify for DMA and loaders.
+//////////////////////////////////////////////////////////////////////////////
+
+#define DECODE_PAGE_SHIFT    12
+#define DECODE_PAGE_SIZE     (1 << DECODE_PAGE_SHIFT)
+#define DECODE_REGION_PAGES  (0x100000 >> DECODE_PAGE_SHIFT)
+
+enum
+{
+   DECODE_BIOS,
+   DECODE_LWRAM,
+   DECODE_HWRAM,
+   DECODE_REGIONS
+};
+
+typedef struct sh2decoded_struct sh2decoded_struct;
+typedef void (FASTCALL *decodedfunc)(SH2_struct *, const sh2decoded_struct *);
+
+// One cached instruction. Hot opcodes also get a handler that reads its
+// operands and cycle count from here instead of decoding sh->instruction
+struct sh2decoded_struct
+{
+   opcodefunc handler;
+   decodedfunc decoded;
+   s32 imm;      // sign extended immediate or scaled displacement
+   u16 instruction;
+   u8 n;
+   u8 m;
+   u8 cycles;
+};
+
+typedef struct
+{
+   sh2decoded_struct insn[DECODE_PAGE_SIZE / 2];
+} sh2decodedpage_struct;
+
+static s8 decode_region[0x100];
+static const u32 decode_mask[DECODE_REGIONS] = { 0x7FFFF, 0xFFFFF, 0xFFFFF };
+static sh2decodedpage_struct *decode_pages[DECODE_REGIONS][DECODE_REGION_PAGES];
+
+static writebytefunc DecodeWriteByte;
+static writewordfunc DecodeWriteWord;
+static writelongfunc DecodeWriteLong;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE sh2decodedpage_struct **SH2DecodedPageSlot(u32 addr)
+{
+   int region = decode_region[(addr >> 20) & 0xFF];
+
+   if (region < 0)
+      return NULL;
+
+   return &decode_pages[region][(addr & decode_mask[region]) >> DECODE_PAGE_SHIFT];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void SH2DecodedInvalidate(u32 addr, u32 size)
+{
+   sh2decodedpage_struct **slot = SH2DecodedPageSlot(addr);
+   u32 i, first, last;
+
+   if (slot == NULL || *slot == NULL)
+      return;
+
+   // writes never cross a page, an unaligned long still only covers 2 slots
+   first = (addr & (DECODE_PAGE_SIZE - 1)) >> 1;
+   last = ((addr + size - 1) & (DECODE_PAGE_SIZE - 1)) >> 1;
+
+   for (i = first; i <= last && i < DECODE_PAGE_SIZE / 2; i++)
+      (*slot)->insn[i].handler = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2DecodeWriteByte(SH2_struct *sh, u32 addr, u8 val)
+{
+   DecodeWriteByte(sh, addr, val);
+   SH2DecodedInvalidate(addr, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2DecodeWriteWord(SH2_struct *sh, u32 addr, u16 val)
+{
+   DecodeWriteWord(sh, addr, val);
+   SH2DecodedInvalidate(addr, 2);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2DecodeWriteLong(SH2_struct *sh, u32 addr, u32 val)
+{
+   DecodeWriteLong(sh, addr, val);
+   SH2DecodedInvalidate(addr, 4);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Handlers using the pre-decoded operands. They do the same as the plain
+// ones they replace, see SH2DecodeOperands for which those are
+
+static void FASTCALL SH2Dmov(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   sh->regs.R[insn->n] = sh->regs.R[insn->m];
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dmovi(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   sh->regs.R[insn->n] = insn->imm;
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dadd(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   sh->regs.R[insn->n] += sh->regs.R[insn->m];
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Daddi(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   sh->regs.R[insn->n] += insn->imm;
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dcmpeq(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   sh->regs.SR.part.T = sh->regs.R[insn->n] == sh->regs.R[insn->m];
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dcmpge(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   sh->regs.SR.part.T = (s32)sh->regs.R[insn->n] >= (s32)sh->regs.R[insn->m];
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dcmpgt(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   sh->regs.SR.part.T = (s32)sh->regs.R[insn->n] > (s32)sh->regs.R[insn->m];
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dcmphi(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   sh->regs.SR.part.T = sh->regs.R[insn->n] > sh->regs.R[insn->m];
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dcmphs(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   sh->regs.SR.part.T = sh->regs.R[insn->n] >= sh->regs.R[insn->m];
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dcmpim(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   sh->regs.SR.part.T = sh->regs.R[0] == (u32)insn->imm;
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// A taken branch costs 2 more cycles than the cached count
+static void FASTCALL SH2Dbf(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   if (sh->regs.SR.part.T == 0)
+   {
+      sh->regs.PC += insn->imm;
+      sh->cycles += insn->cycles + 2;
+   }
+   else
+   {
+      sh->regs.PC += 2;
+      sh->cycles += insn->cycles;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dbt(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   if (sh->regs.SR.part.T == 1)
+   {
+      sh->regs.PC += insn->imm;
+      sh->cycles += insn->cycles + 2;
+   }
+   else
+   {
+      sh->regs.PC += 2;
+      sh->cycles += insn->cycles;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dmovbl(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   sh->regs.R[insn->n] = (s32)(s8)SH2MemoryReadByte(sh, sh->regs.R[insn->m]);
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dmovwl(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   u32 addr = sh->regs.R[insn->m];
+
+   if (sh2_check_wait(sh, addr, 1))
+   {
+      sh->cycles += insn->cycles;
+      return;
+   }
+
+   sh->regs.R[insn->n] = (s32)(s16)SH2MemoryReadWord(sh, addr);
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dmovll(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   u32 addr = sh->regs.R[insn->m];
+
+   if (sh2_check_wait(sh, addr, 2))
+   {
+      sh->cycles += insn->cycles;
+      return;
+   }
+
+   sh->regs.R[insn->n] = SH2MemoryReadLong(sh, addr);
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dmovll4(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   sh->regs.R[insn->n] = SH2MemoryReadLong(sh, sh->regs.R[insn->m] + insn->imm);
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dmovlp(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   sh->regs.R[insn->n] = SH2MemoryReadLong(sh, sh->regs.R[insn->m]);
+   if (insn->n != insn->m)
+      sh->regs.R[insn->m] += 4;
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dmovbs(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   SH2MemoryWriteByte(sh, sh->regs.R[insn->n], sh->regs.R[insn->m]);
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dmovws(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   SH2MemoryWriteWord(sh, sh->regs.R[insn->n], sh->regs.R[insn->m]);
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dmovls(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   SH2MemoryWriteLong(sh, sh->regs.R[insn->n], sh->regs.R[insn->m]);
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dmovls4(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   SH2MemoryWriteLong(sh, sh->regs.R[insn->n] + insn->imm, sh->regs.R[insn->m]);
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Dmovlm(SH2_struct *sh, const sh2decoded_struct *insn)
+{
+   SH2MemoryWriteLong(sh, sh->regs.R[insn->n] - 4, sh->regs.R[insn->m]);
+   sh->regs.R[insn->n] -= 4;
+   sh->regs.PC += 2;
+   sh->cycles += insn->cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// How the operands of a pre-decoded opcode are laid out
+enum
+{
+   DECODE_NM,       // Rn in bits 8-11, Rm in bits 4-7
+   DECODE_NI8,      // Rn and a sign extended 8 bit immediate
+   DECODE_I8,       // sign extended 8 bit immediate only
+   DECODE_BRANCH,   // 8 bit displacement, stored as the offset from PC
+   DECODE_NMD4L     // Rn, Rm and a 4 bit displacement in longs
+};
+
+static const struct
+{
+   opcodefunc handler;
+   decodedfunc decoded;
+   int layout;
+} decode_ops[] = {
+   { SH2mov, SH2Dmov, DECODE_NM },
+   { SH2movi, SH2Dmovi, DECODE_NI8 },
+   { SH2add, SH2Dadd, DECODE_NM },
+   { SH2addi, SH2Daddi, DECODE_NI8 },
+   { SH2cmpeq, SH2Dcmpeq, DECODE_NM },
+   { SH2cmpge, SH2Dcmpge, DECODE_NM },
+   { SH2cmpgt, SH2Dcmpgt, DECODE_NM },
+   { SH2cmphi, SH2Dcmphi, DECODE_NM },
+   { SH2cmphs, SH2Dcmphs, DECODE_NM },
+   { SH2cmpim, SH2Dcmpim, DECODE_I8 },
+   { SH2bf, SH2Dbf, DECODE_BRANCH },
+   { SH2bt, SH2Dbt, DECODE_BRANCH },
+   { SH2movbl, SH2Dmovbl, DECODE_NM },
+   { SH2movwl, SH2Dmovwl, DECODE_NM },
+   { SH2movll, SH2Dmovll, DECODE_NM },
+   { SH2movll4, SH2Dmovll4, DECODE_NMD4L },
+   { SH2movlp, SH2Dmovlp, DECODE_NM },
+   { SH2movbs, SH2Dmovbs, DECODE_NM },
+   { SH2movws, SH2Dmovws, DECODE_NM },
+   { SH2movls, SH2Dmovls, DECODE_NM },
+   { SH2movls4, SH2Dmovls4, DECODE_NMD4L },
+   { SH2movlm, SH2Dmovlm, DECODE_NM },
+   { NULL, NULL, 0 }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void SH2DecodeOperands(sh2decoded_struct *insn)
+{
+   u16 instruction = insn->instruction;
+   int i;
+
+   insn->decoded = NULL;
+   insn->n = INSTRUCTION_B(instruction);
+   insn->m = INSTRUCTION_C(instruction);
+   insn->imm = 0;
+   // All of the opcodes above take one cycle, or 3 for a taken branch
+   insn->cycles = 1;
+
+   for (i = 0; decode_ops[i].handler != NULL; i++)
+   {
+      if (decode_ops[i].handler != insn->handler)
+         continue;
+
+      switch (decode_ops[i].layout)
+      {
+         case DECODE_NI8:
+         case DECODE_I8:
+            insn->imm = (s32)(s8)INSTRUCTION_CD(instruction);
+            break;
+         case DECODE_BRANCH:
+            insn->imm = ((s32)(s8)INSTRUCTION_CD(instruction) << 1) + 4;
+            break;
+         case DECODE_NMD4L:
+            insn->imm = INSTRUCTION_D(instruction) << 2;
+            break;
+         default:
+            break;
+      }
+
+      insn->decoded = decode_ops[i].decoded;
+      break;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void SH2DecodedFlush(void)
+{
+   int i, j;
+
+   for (i = 0; i < DECODE_REGIONS; i++)
+   {
+      for (j = 0; j < DECODE_REGION_PAGES; j++)
+      {
+         if (decode_pages[i][j])
+            free(decode_pages[i][j]);
+         decode_pages[i][j] = NULL;
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int SH2CachedInterpreterInit(enum SHMODELTYPE model, SH2_struct *msh, SH2_struct *ssh)
+{
+   int i;
+
+   SH2InterpreterInit(model, msh, ssh);
+
+   if (model != SHMT_SH2)
+      return 0;
+
+   SH2DecodedFlush();
+
+   for (i = 0; i < 0x100; i++)
+   {
+      if (i == 0x000)
+         decode_region[i] = DECODE_BIOS;
+      else if (i == 0x002)
+         decode_region[i] = DECODE_LWRAM;
+      else if (i >= 0x060 && i <= 0x06F)
+         decode_region[i] = DECODE_HWRAM;
+      else
+         decode_region[i] = -1;
+   }
+
+   // Fetches go through the cache emulation when it's on, so the decode
+   // cache isn't used then
+   if (yabsys.sh2_cache_enabled)
+      return 0;
+
+   DecodeWriteByte = msh->MappedMemoryWriteByte;
+   DecodeWriteWord = msh->MappedMemoryWriteWord;
+   DecodeWriteLong = msh->MappedMemoryWriteLong;
+
+   msh->MappedMemoryWriteByte = ssh->MappedMemoryWriteByte = SH2DecodeWriteByte;
+   msh->MappedMemoryWriteWord = ssh->MappedMemoryWriteWord = SH2DecodeWriteWord;
+   msh->MappedMemoryWriteLong = ssh->MappedMemoryWriteLong = SH2DecodeWriteLong;
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void SH2CachedInterpreterDeInit()
+{
+   SH2DecodedFlush();
+   SH2InterpreterDeInit();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+FASTCALL void SH2CachedInterpreterExec(SH2_struct *context, u32 cycles)
+{
+   sh2decodedpage_struct *page = NULL;
+   u32 page_addr = 0xFFFFFFFF;
+
+   if (yabsys.sh2_cache_enabled || context->model != SHMT_SH2)
+   {
+      SH2InterpreterExec(context, cycles);
+      return;
+   }
+
+   SH2HandleInterrupts(context);
+
+   if (context->isIdle)
+      SH2idleParse(context, cycles);
+   else
+      SH2idleCheck(context, cycles);
+
+   while(context->cycles < cycles)
+   {
+      u32 pc = context->regs.PC;
+      sh2decoded_struct *insn;
+
+      // Keep the page while execution stays in it
+      if ((pc & ~(DECODE_PAGE_SIZE - 1)) != page_addr)
+      {
+         sh2decodedpage_struct **slot = SH2DecodedPageSlot(pc);
+
+         page_addr = pc & ~(DECODE_PAGE_SIZE - 1);
+         page = NULL;
+
+         if (slot != NULL)
+         {
+            if (*slot == NULL)
+               *slot = (sh2decodedpage_struct *)calloc(1, sizeof(sh2decodedpage_struct));
+            page = *slot;
+         }
+      }
+
+      if (page == NULL)
+      {
+         context->instruction = ((fetchfunc *)context->fetchlist)[(pc >> 20) & 0x0FF](context, pc);
+         ((opcodefunc *)context->opcodes)[context->instruction](context);
+         continue;
+      }
+
+      insn = &page->insn[(pc & (DECODE_PAGE_SIZE - 1)) >> 1];
+
+      if (insn->handler == NULL)
+      {
+         insn->instruction = ((fetchfunc *)context->fetchlist)[(pc >> 20) & 0x0FF](context, pc);
+         insn->handler = ((opcodefunc *)context->opcodes)[insn->instruction];
+         SH2DecodeOperands(insn);
+      }
+
+      if (insn->decoded)
+         insn->decoded(context, insn);
+      else
+      {
+         context->instruction = insn->instruction;
+         insn->handler(context);
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void SH2CachedInterpreterWriteNotify(u32 start, u32 length)
+{
+   u32 addr = start & ~1;
+   u32 end = start + length;
+
+   while (addr < end)
+   {
+      sh2decodedpage_struct **slot = SH2DecodedPageSlot(addr);
+      u32 next = (addr | (DECODE_PAGE_SIZE - 1)) + 1;
+
+      if (next > end || next == 0)
+         next = end;
+
+      if (slot != NULL && *slot != NULL)
+      {
+         u32 first = (addr & (DECODE_PAGE_SIZE - 1)) >> 1;
+         u32 last = ((next - 1) & (DECODE_PAGE_SIZE - 1)) >> 1;
+
+         memset(&(*slot)->insn[first], 0, (last - first + 1) * sizeof(sh2decoded_struct));
+      }
+
+      if (next == end)
+         break;
+
+      addr = next;
+   }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 void SH2InterpreterGetRegisters(SH2_struct *context, sh2regs_struct *regs)
@@ -23,6 +23,7 @@
 
 #define SH2CORE_INTERPRETER             0
 #define SH2CORE_DEBUGINTERPRETER        1
+#define SH2CORE_CACHEDINTERPRETER       3
 
 #define INSTRUCTION_A(x) ((x & 0xF000) >> 12)
 #define INSTRUCTION_B(x) ((x & 0x0F00) >> 8)
@@ -37,6 +38,10 @@ void SH2InterpreterDeInit(void);
 void SH2InterpreterReset(SH2_struct *context);
 void FASTCALL SH2InterpreterExec(SH2_struct *context, u32 cycles);
 void FASTCALL SH2DebugInterpreterExec(SH2_struct *context, u32 cycles);
+int SH2CachedInterpreterInit(enum SHMODELTYPE model, SH2_struct *msh, SH2_struct *ssh);
+void SH2CachedInterpreterDeInit(void);
+void FASTCALL SH2CachedInterpreterExec(SH2_struct *context, u32 cycles);
+void SH2CachedInterpreterWriteNotify(u32 start, u32 length);
 void SH2InterpreterGetRegisters(SH2_struct *context, sh2regs_struct *regs);
 u32 SH2InterpreterGetGPR(SH2_struct *context, int num);
 u32 SH2InterpreterGetSR(SH2_struct *context);
@@ -63,6 +68,7 @@ void SH2InterpreterSetInterrupts(SH2_struct *context, int num_interrupts,
 
 extern SH2Interface_struct SH2Interpreter;
 extern SH2Interface_struct SH2DebugInterpreter;
+extern SH2Interface_struct SH2CachedInterpreter;
 
 typedef u32 (FASTCALL *fetchfunc)(SH2_struct *, u32);
 typedef void (FASTCALL *opcodefunc)(SH2_struct *);
@@ -590,6 +590,15 @@ void SmpcExec(s32 t) {
 
 //////////////////////////////////////////////////////////////////////////////
 
+s32 SmpcGetTimeToNextEvent(void) {
+   // Microseconds until the current command completes, -1 if none is pending
+   if (SmpcInternalVars->timing > 0)
+      return SmpcInternalVars->timing;
+   return -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 u8 FASTCALL SmpcReadByte(SH2_struct *sh, u32 addr) {
    addr &= 0x7F;
    return SmpcRegsT[addr >> 1];
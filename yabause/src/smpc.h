@@ -87,6 +87,7 @@ void SmpcRecheckRegion(void);
 void SmpcReset(void);
 void SmpcResetButton(void);
 void SmpcExec(s32 t);
+s32 SmpcGetTimeToNextEvent(void);
 void SmpcINTBACKEnd(void);
 void SmpcCKCHG320(void);
 void SmpcCKCHG352(void);
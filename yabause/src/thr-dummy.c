@@ -35,4 +35,22 @@ void YabThreadRemoteSleep(unsigned int id) {}
 
 void YabThreadWake(unsigned int id) {}
 
+YabMutex * YabThreadCreateMutex(void) { return NULL; }
+
+void YabThreadFreeMutex(YabMutex * mtx) {}
+
+void YabThreadLock(YabMutex * mtx) {}
+
+void YabThreadUnLock(YabMutex * mtx) {}
+
+YabCond * YabThreadCreateCond(void) { return NULL; }
+
+void YabThreadFreeCond(YabCond * cond) {}
+
+void YabThreadCondWait(YabCond * cond, YabMutex * mtx) {}
+
+void YabThreadCondSignal(YabCond * cond) {}
+
+void YabThreadCondBroadcast(YabCond * cond) {}
+
 //////////////////////////////////////////////////////////////////////////////
@@ -24,6 +24,7 @@
 #include <errno.h>
 #include <pthread.h>
 #include <signal.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 //////////////////////////////////////////////////////////////////////////////
@@ -32,6 +33,33 @@
 static pthread_t thread_handle[YAB_NUM_THREADS];
 static pthread_mutex_t thread_mutex[YAB_NUM_THREADS];
 static pthread_cond_t thread_cond[YAB_NUM_THREADS];
+static void (*thread_func[YAB_NUM_THREADS])(void *);
+static void *thread_arg[YAB_NUM_THREADS];
+// Set by YabThreadWake() so that a wakeup sent before the thread goes to
+// sleep isn't lost
+static int thread_wake_pending[YAB_NUM_THREADS];
+
+// Lets YabThreadSleep() find the calling thread's handle
+static pthread_key_t thread_key;
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void YabThreadMakeKey(void)
+{
+   pthread_key_create(&thread_key, NULL);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void *YabThreadWrapper(void *data)
+{
+   unsigned int id = (unsigned int)(pointer)data;
+
+   pthread_setspecific(thread_key, &thread_handle[id]);
+   thread_func[id](thread_arg[id]);
+   return NULL;
+}
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -43,6 +71,7 @@ int YabThreadStart(unsigned int id, void (*func)(void *), void *arg)
       return -1;
    }
 
+   pthread_once(&thread_key_once, YabThreadMakeKey);
    pthread_mutex_init(&thread_mutex[id], NULL);
 
    if (pthread_cond_init(&thread_cond[id], NULL) != 0)
@@ -51,7 +80,11 @@ int YabThreadStart(unsigned int id, void (*func)(void *), void *arg)
       return -1;
    }
 
-   if ((errno = pthread_create(&thread_handle[id], NULL, (void *)func, arg)) != 0)
+   thread_func[id] = func;
+   thread_arg[id] = arg;
+   thread_wake_pending[id] = 0;
+
+   if ((errno = pthread_create(&thread_handle[id], NULL, YabThreadWrapper, (void *)(pointer)id)) != 0)
    {
       perror("pthread_create");
       return -1;
@@ -83,23 +116,18 @@ void YabThreadYield(void)
 
 void YabThreadSleep(void)
 {
-   pthread_t thread;
-   unsigned int i, id;
-
-   id = YAB_NUM_THREADS;
-
-   thread = pthread_self();
-   for(i = 0;i < YAB_NUM_THREADS;i++)
-   {
-      if(thread_handle[i] == thread) {
-         id = i;
-      }
-   }
+   pthread_t *handle;
+   unsigned int id;
 
-   if (id == YAB_NUM_THREADS) return;
+   pthread_once(&thread_key_once, YabThreadMakeKey);
+   if ((handle = (pthread_t *)pthread_getspecific(thread_key)) == NULL)
+      return;  // Not one of our threads
+   id = handle - thread_handle;
 
    pthread_mutex_lock(&thread_mutex[id]);
-   pthread_cond_wait(&thread_cond[id], &thread_mutex[id]);
+   while (!thread_wake_pending[id])
+      pthread_cond_wait(&thread_cond[id], &thread_mutex[id]);
+   thread_wake_pending[id] = 0;
    pthread_mutex_unlock(&thread_mutex[id]);
 }
 
@@ -117,8 +145,116 @@ void YabThreadWake(unsigned int id)
       return;  // Thread isn't running
 
    pthread_mutex_lock(&thread_mutex[id]);
+   thread_wake_pending[id] = 1;
    pthread_cond_signal(&thread_cond[id]);
    pthread_mutex_unlock(&thread_mutex[id]);
 }
 
 //////////////////////////////////////////////////////////////////////////////
+
+struct YabMutex_struct
+{
+   pthread_mutex_t mutex;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+YabMutex * YabThreadCreateMutex(void)
+{
+   YabMutex * mtx = (YabMutex *)malloc(sizeof(YabMutex));
+
+   if (mtx == NULL)
+      return NULL;
+
+   if (pthread_mutex_init(&mtx->mutex, NULL) != 0)
+   {
+      free(mtx);
+      return NULL;
+   }
+
+   return mtx;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadFreeMutex(YabMutex * mtx)
+{
+   if (mtx == NULL)
+      return;
+
+   pthread_mutex_destroy(&mtx->mutex);
+   free(mtx);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadLock(YabMutex * mtx)
+{
+   pthread_mutex_lock(&mtx->mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadUnLock(YabMutex * mtx)
+{
+   pthread_mutex_unlock(&mtx->mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+struct YabCond_struct
+{
+   pthread_cond_t cond;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+YabCond * YabThreadCreateCond(void)
+{
+   YabCond * cond = (YabCond *)malloc(sizeof(YabCond));
+
+   if (cond == NULL)
+      return NULL;
+
+   if (pthread_cond_init(&cond->cond, NULL) != 0)
+   {
+      free(cond);
+      return NULL;
+   }
+
+   return cond;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadFreeCond(YabCond * cond)
+{
+   if (cond == NULL)
+      return;
+
+   pthread_cond_destroy(&cond->cond);
+   free(cond);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadCondWait(YabCond * cond, YabMutex * mtx)
+{
+   pthread_cond_wait(&cond->cond, &mtx->mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadCondSignal(YabCond * cond)
+{
+   pthread_cond_signal(&cond->cond);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadCondBroadcast(YabCond * cond)
+{
+   pthread_cond_broadcast(&cond->cond);
+}
+
+//////////////////////////////////////////////////////////////////////////////
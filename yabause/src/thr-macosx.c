@@ -22,6 +22,7 @@
 
 #include <pthread.h>
 #include <sched.h>
+#include <stdlib.h>
 
 /* Thread handle structure. */
 struct thd_s {
@@ -133,3 +134,75 @@ void YabThreadWake(unsigned int id) {
 
     pthread_cond_signal(&thread_handle[id].cond);
 }
+
+struct YabMutex_struct {
+    pthread_mutex_t mutex;
+};
+
+YabMutex * YabThreadCreateMutex(void) {
+    YabMutex * mtx = (YabMutex *)malloc(sizeof(YabMutex));
+
+    if(mtx == NULL)
+        return NULL;
+
+    if(pthread_mutex_init(&mtx->mutex, NULL) != 0) {
+        free(mtx);
+        return NULL;
+    }
+
+    return mtx;
+}
+
+void YabThreadFreeMutex(YabMutex * mtx) {
+    if(mtx == NULL)
+        return;
+
+    pthread_mutex_destroy(&mtx->mutex);
+    free(mtx);
+}
+
+void YabThreadLock(YabMutex * mtx) {
+    pthread_mutex_lock(&mtx->mutex);
+}
+
+void YabThreadUnLock(YabMutex * mtx) {
+    pthread_mutex_unlock(&mtx->mutex);
+}
+
+struct YabCond_struct {
+    pthread_cond_t cond;
+};
+
+YabCond * YabThreadCreateCond(void) {
+    YabCond * cond = (YabCond *)malloc(sizeof(YabCond));
+
+    if(cond == NULL)
+        return NULL;
+
+    if(pthread_cond_init(&cond->cond, NULL) != 0) {
+        free(cond);
+        return NULL;
+    }
+
+    return cond;
+}
+
+void YabThreadFreeCond(YabCond * cond) {
+    if(cond == NULL)
+        return;
+
+    pthread_cond_destroy(&cond->cond);
+    free(cond);
+}
+
+void YabThreadCondWait(YabCond * cond, YabMutex * mtx) {
+    pthread_cond_wait(&cond->cond, &mtx->mutex);
+}
+
+void YabThreadCondSignal(YabCond * cond) {
+    pthread_cond_signal(&cond->cond);
+}
+
+void YabThreadCondBroadcast(YabCond * cond) {
+    pthread_cond_broadcast(&cond->cond);
+}
@@ -24,6 +24,8 @@
 #include <sched.h>
 #endif
 
+#include <stdlib.h>
+
 #include "core.h"
 #include "threads.h"
 #include "rthreads/rthreads.h"
@@ -33,6 +35,7 @@ struct thd_s {
 	sthread_t *thd;
 	slock_t *mutex;
 	scond_t *cond;
+	int wake_pending;
 };
 
 static struct thd_s thread_handle[YAB_NUM_THREADS];
@@ -53,6 +56,8 @@ int YabThreadStart(unsigned int id, void (*func)(void *), void *arg)
 		return -1;
 	}
 
+	thread_handle[id].wake_pending = 0;
+
 	if ((thread_handle[id].thd = sthread_create((void *)func, arg)) == NULL)
 	{
 		return -1;
@@ -98,7 +103,9 @@ void YabThreadSleep(void)
 	if (id == YAB_NUM_THREADS) return;
 
 	slock_lock(thread_handle[id].mutex);
-	scond_wait(thread_handle[id].cond, thread_handle[id].mutex);
+	while (!thread_handle[id].wake_pending)
+		scond_wait(thread_handle[id].cond, thread_handle[id].mutex);
+	thread_handle[id].wake_pending = 0;
 	slock_unlock(thread_handle[id].mutex);
 }
 
@@ -112,8 +119,98 @@ void YabThreadWake(unsigned int id)
 		return;  // Thread wasn't running in the first place
 
 	slock_lock(thread_handle[id].mutex);
+	thread_handle[id].wake_pending = 1;
 	scond_signal(thread_handle[id].cond);
 	slock_unlock(thread_handle[id].mutex);
 }
 
 //////////////////////////////////////////////////////////////////////////////
+
+struct YabMutex_struct
+{
+	slock_t *mutex;
+};
+
+YabMutex * YabThreadCreateMutex(void)
+{
+	YabMutex * mtx = (YabMutex *)malloc(sizeof(YabMutex));
+
+	if (mtx == NULL)
+		return NULL;
+
+	if ((mtx->mutex = slock_new()) == NULL)
+	{
+		free(mtx);
+		return NULL;
+	}
+
+	return mtx;
+}
+
+void YabThreadFreeMutex(YabMutex * mtx)
+{
+	if (mtx == NULL)
+		return;
+
+	slock_free(mtx->mutex);
+	free(mtx);
+}
+
+void YabThreadLock(YabMutex * mtx)
+{
+	slock_lock(mtx->mutex);
+}
+
+void YabThreadUnLock(YabMutex * mtx)
+{
+	slock_unlock(mtx->mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+struct YabCond_struct
+{
+	scond_t *cond;
+};
+
+YabCond * YabThreadCreateCond(void)
+{
+	YabCond * cond = (YabCond *)malloc(sizeof(YabCond));
+
+	if (cond == NULL)
+		return NULL;
+
+	if ((cond->cond = scond_new()) == NULL)
+	{
+		free(cond);
+		return NULL;
+	}
+
+	return cond;
+}
+
+void YabThreadFreeCond(YabCond * cond)
+{
+	if (cond == NULL)
+		return;
+
+	scond_free(cond->cond);
+	free(cond);
+}
+
+void YabThreadCondWait(YabCond * cond, YabMutex * mtx)
+{
+	scond_wait(cond->cond, mtx->mutex);
+}
+
+void YabThreadCondSignal(YabCond * cond)
+{
+	scond_signal(cond->cond);
+}
+
+void YabThreadCondBroadcast(YabCond * cond)
+{
+	scond_broadcast(cond->cond);
+}
+
+//////////////////////////////////////////////////////////////////////////////
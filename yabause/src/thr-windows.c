@@ -23,6 +23,7 @@
 */
 
 #include <windows.h>
+#include <stdlib.h>
 #include "core.h"
 #include "threads.h"
 
@@ -133,3 +134,102 @@ void YabThreadWake(unsigned int id)
 }
 
 //////////////////////////////////////////////////////////////////////////////
+
+struct YabMutex_struct
+{
+   CRITICAL_SECTION mutex;
+};
+
+YabMutex * YabThreadCreateMutex(void)
+{
+   YabMutex * mtx = (YabMutex *)malloc(sizeof(YabMutex));
+
+   if (mtx == NULL)
+      return NULL;
+
+   InitializeCriticalSection(&mtx->mutex);
+   return mtx;
+}
+
+void YabThreadFreeMutex(YabMutex * mtx)
+{
+   if (mtx == NULL)
+      return;
+
+   DeleteCriticalSection(&mtx->mutex);
+   free(mtx);
+}
+
+void YabThreadLock(YabMutex * mtx)
+{
+   EnterCriticalSection(&mtx->mutex);
+}
+
+void YabThreadUnLock(YabMutex * mtx)
+{
+   LeaveCriticalSection(&mtx->mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Condition variables are built on a semaphore so that they also work on
+// Windows versions without CONDITION_VARIABLE.  Signallers hold the mutex
+// the waiters use, which keeps the waiter count consistent.
+struct YabCond_struct
+{
+   HANDLE sema;
+   volatile LONG waiters;
+};
+
+YabCond * YabThreadCreateCond(void)
+{
+   YabCond * cond = (YabCond *)malloc(sizeof(YabCond));
+
+   if (cond == NULL)
+      return NULL;
+
+   if ((cond->sema = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL)) == NULL)
+   {
+      free(cond);
+      return NULL;
+   }
+
+   cond->waiters = 0;
+   return cond;
+}
+
+void YabThreadFreeCond(YabCond * cond)
+{
+   if (cond == NULL)
+      return;
+
+   CloseHandle(cond->sema);
+   free(cond);
+}
+
+void YabThreadCondWait(YabCond * cond, YabMutex * mtx)
+{
+   InterlockedIncrement(&cond->waiters);
+   LeaveCriticalSection(&mtx->mutex);
+   WaitForSingleObject(cond->sema, INFINITE);
+   EnterCriticalSection(&mtx->mutex);
+}
+
+void YabThreadCondSignal(YabCond * cond)
+{
+   if (cond->waiters > 0)
+   {
+      InterlockedDecrement(&cond->waiters);
+      ReleaseSemaphore(cond->sema, 1, NULL);
+   }
+}
+
+void YabThreadCondBroadcast(YabCond * cond)
+{
+   LONG waiters = InterlockedExchange(&cond->waiters, 0);
+
+   if (waiters > 0)
+      ReleaseSemaphore(cond->sema, waiters, NULL);
+}
+
+//////////////////////////////////////////////////////////////////////////////
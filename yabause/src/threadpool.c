@@ -0,0 +1,291 @@
+/*  src/threadpool.c: Thread pool and completion counters
+
+    This file is part of Yabause.
+
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file threadpool.c
+    \brief Job queue shared by the worker threads of all ports.
+*/
+
+#include <stdlib.h>
+#include "core.h"
+#include "threads.h"
+
+// Size of the job ring buffer, a power of two
+#define POOL_QUEUE_SIZE 64
+
+struct YabCounter_struct
+{
+   YabMutex * mutex;
+   YabCond * cond;
+   int count;
+};
+
+typedef struct
+{
+   void (*func)(void *);
+   void *arg;
+   YabCounter * counter;
+} YabPoolJob;
+
+static struct
+{
+   YabMutex * mutex;
+   YabCond * work_cond;
+   YabPoolJob jobs[POOL_QUEUE_SIZE];
+   unsigned int head;
+   unsigned int tail;
+   int num_workers;
+   int quit;
+} pool;
+
+//////////////////////////////////////////////////////////////////////////////
+
+YabCounter * YabThreadCreateCounter(void)
+{
+   YabCounter * counter = (YabCounter *)calloc(1, sizeof(YabCounter));
+
+   if (counter == NULL)
+      return NULL;
+
+   // The dummy port returns NULL for both, but it never runs a job on
+   // another thread so the counter is never waited on
+   counter->mutex = YabThreadCreateMutex();
+   counter->cond = YabThreadCreateCond();
+   return counter;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadFreeCounter(YabCounter * counter)
+{
+   if (counter == NULL)
+      return;
+
+   YabThreadFreeCond(counter->cond);
+   YabThreadFreeMutex(counter->mutex);
+   free(counter);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void YabThreadCounterAdd(YabCounter * counter)
+{
+   YabThreadLock(counter->mutex);
+   counter->count++;
+   YabThreadUnLock(counter->mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void YabThreadCounterFinish(YabCounter * counter)
+{
+   YabThreadLock(counter->mutex);
+   if (--counter->count == 0)
+      YabThreadCondBroadcast(counter->cond);
+   YabThreadUnLock(counter->mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Takes the oldest queued job counted in counter off the queue, keeping the
+// other jobs in order. pool.mutex must be held. Returns 0 if there is none.
+static int YabThreadPoolTakeJob(YabCounter * counter, YabPoolJob * job)
+{
+   unsigned int i, j;
+
+   for (i = pool.head; i != pool.tail; i = (i + 1) & (POOL_QUEUE_SIZE - 1))
+   {
+      if (pool.jobs[i].counter != counter)
+         continue;
+
+      *job = pool.jobs[i];
+      for (j = i; j != pool.head; j = (j - 1) & (POOL_QUEUE_SIZE - 1))
+         pool.jobs[j] = pool.jobs[(j - 1) & (POOL_QUEUE_SIZE - 1)];
+      pool.head = (pool.head + 1) & (POOL_QUEUE_SIZE - 1);
+      return 1;
+   }
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadCounterWait(YabCounter * counter)
+{
+   YabPoolJob job;
+
+   // Run the jobs no worker has picked up yet instead of sleeping on them.
+   // A job waiting on jobs of its own would otherwise hang when it holds
+   // the only worker.
+   if (pool.mutex != NULL)
+   {
+      for (;;)
+      {
+         int found;
+
+         YabThreadLock(pool.mutex);
+         found = YabThreadPoolTakeJob(counter, &job);
+         YabThreadUnLock(pool.mutex);
+
+         if (!found)
+            break;
+
+         job.func(job.arg);
+         YabThreadCounterFinish(counter);
+      }
+   }
+
+   // Always read the count under the mutex, so everything the jobs wrote is
+   // visible once it reaches zero
+   YabThreadLock(counter->mutex);
+   while (counter->count > 0)
+      YabThreadCondWait(counter->cond, counter->mutex);
+   YabThreadUnLock(counter->mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int YabThreadCounterDone(YabCounter * counter)
+{
+   int done;
+
+   YabThreadLock(counter->mutex);
+   done = (counter->count == 0);
+   YabThreadUnLock(counter->mutex);
+   return done;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void YabThreadPoolWorker(UNUSED void *arg)
+{
+   YabPoolJob job;
+
+   YabThreadLock(pool.mutex);
+
+   for (;;)
+   {
+      while (pool.head == pool.tail && !pool.quit)
+         YabThreadCondWait(pool.work_cond, pool.mutex);
+
+      // Only leave once the queue is empty
+      if (pool.head == pool.tail)
+         break;
+
+      job = pool.jobs[pool.head];
+      pool.head = (pool.head + 1) & (POOL_QUEUE_SIZE - 1);
+      YabThreadUnLock(pool.mutex);
+
+      job.func(job.arg);
+      if (job.counter)
+         YabThreadCounterFinish(job.counter);
+
+      YabThreadLock(pool.mutex);
+   }
+
+   YabThreadUnLock(pool.mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int YabThreadPoolStart(int num)
+{
+   if (num > YAB_MAX_POOL_THREADS)
+      num = YAB_MAX_POOL_THREADS;
+
+   if (pool.mutex == NULL)
+   {
+      if ((pool.mutex = YabThreadCreateMutex()) == NULL)
+         return 0;
+
+      if ((pool.work_cond = YabThreadCreateCond()) == NULL)
+      {
+         YabThreadFreeMutex(pool.mutex);
+         pool.mutex = NULL;
+         return 0;
+      }
+
+      pool.head = pool.tail = 0;
+      pool.quit = 0;
+   }
+
+   while (pool.num_workers < num)
+   {
+      if (YabThreadStart(YAB_THREAD_POOL_0 + pool.num_workers, YabThreadPoolWorker, NULL) != 0)
+         break;
+      pool.num_workers++;
+   }
+
+   return pool.num_workers;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadPoolStop(void)
+{
+   int i;
+
+   if (pool.mutex == NULL)
+      return;
+
+   YabThreadLock(pool.mutex);
+   pool.quit = 1;
+   YabThreadCondBroadcast(pool.work_cond);
+   YabThreadUnLock(pool.mutex);
+
+   for (i = 0; i < pool.num_workers; i++)
+      YabThreadWait(YAB_THREAD_POOL_0 + i);
+
+   pool.num_workers = 0;
+   YabThreadFreeCond(pool.work_cond);
+   YabThreadFreeMutex(pool.mutex);
+   pool.work_cond = NULL;
+   pool.mutex = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadPoolSubmit(YabCounter * counter, void (*func)(void *), void *arg)
+{
+   unsigned int next;
+
+   if (pool.num_workers > 0)
+   {
+      YabThreadLock(pool.mutex);
+      next = (pool.tail + 1) & (POOL_QUEUE_SIZE - 1);
+      if (next != pool.head)
+      {
+         // Count the job before a worker can possibly finish it
+         if (counter)
+            YabThreadCounterAdd(counter);
+
+         pool.jobs[pool.tail].func = func;
+         pool.jobs[pool.tail].arg = arg;
+         pool.jobs[pool.tail].counter = counter;
+         pool.tail = next;
+         YabThreadCondSignal(pool.work_cond);
+         YabThreadUnLock(pool.mutex);
+         return;
+      }
+      YabThreadUnLock(pool.mutex);
+   }
+
+   func(arg);
+}
+
+//////////////////////////////////////////////////////////////////////////////
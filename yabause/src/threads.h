@@ -34,21 +34,15 @@ enum {
    YAB_THREAD_NETLINKCONNECT,
    YAB_THREAD_NETLINKCLIENT,
    YAB_THREAD_OPENAL,
-   YAB_THREAD_VIDSOFT_LAYER_NBG3,
-   YAB_THREAD_VIDSOFT_LAYER_NBG2,
-   YAB_THREAD_VIDSOFT_LAYER_NBG1,
-   YAB_THREAD_VIDSOFT_LAYER_NBG0,
-   YAB_THREAD_VIDSOFT_LAYER_RBG0,
-   YAB_THREAD_VIDSOFT_VDP1,
-   YAB_THREAD_VIDSOFT_PRIORITY_0,
-   YAB_THREAD_VIDSOFT_PRIORITY_1,
-   YAB_THREAD_VIDSOFT_PRIORITY_2,
-   YAB_THREAD_VIDSOFT_PRIORITY_3,
-   YAB_THREAD_VIDSOFT_PRIORITY_4,
-   YAB_THREAD_VIDSOFT_LAYER_SPRITE,
+   YAB_THREAD_SSH2,
+   YAB_THREAD_POOL_0,      // Worker threads of YabThreadPoolStart()
+   YAB_THREAD_POOL_LAST = YAB_THREAD_POOL_0 + 7,
    YAB_NUM_THREADS      // Total number of subthreads
 };
 
+// Maximum number of worker threads in the thread pool
+#define YAB_MAX_POOL_THREADS  (YAB_THREAD_POOL_LAST - YAB_THREAD_POOL_0 + 1)
+
 // Number of (boolean) semaphores available per thread
 #define YAB_NUM_SEMAPHORES  2
 
@@ -78,6 +72,88 @@ void YabThreadRemoteSleep(unsigned int id);
 // YabThreadWake:  Wake up the given thread if it is asleep.
 void YabThreadWake(unsigned int id);
 
+///////////////////////////////////////////////////////////////////////////
+// Mutex functions
+///////////////////////////////////////////////////////////////////////////
+
+typedef struct YabMutex_struct YabMutex;
+
+// YabThreadCreateMutex:  Create a new mutex.  Returns NULL on error.
+YabMutex * YabThreadCreateMutex(void);
+
+// YabThreadFreeMutex:  Free a mutex created by YabThreadCreateMutex().
+void YabThreadFreeMutex(YabMutex * mtx);
+
+// YabThreadLock:  Lock the mutex, waiting until no other thread holds it.
+void YabThreadLock(YabMutex * mtx);
+
+// YabThreadUnLock:  Unlock the mutex.
+void YabThreadUnLock(YabMutex * mtx);
+
+///////////////////////////////////////////////////////////////////////////
+// Condition variable functions
+///////////////////////////////////////////////////////////////////////////
+
+typedef struct YabCond_struct YabCond;
+
+// YabThreadCreateCond:  Create a new condition variable.  Returns NULL on
+// error.
+YabCond * YabThreadCreateCond(void);
+
+// YabThreadFreeCond:  Free a condition variable created by
+// YabThreadCreateCond().
+void YabThreadFreeCond(YabCond * cond);
+
+// YabThreadCondWait:  Unlock the mutex, wait for the condition variable to
+// be signalled, then lock the mutex again.  The wait can also end without
+// a signal, so callers must check their condition in a loop.
+void YabThreadCondWait(YabCond * cond, YabMutex * mtx);
+
+// YabThreadCondSignal:  Wake up one thread waiting on the condition
+// variable.  The caller must hold the mutex the waiters use.
+void YabThreadCondSignal(YabCond * cond);
+
+// YabThreadCondBroadcast:  Wake up every thread waiting on the condition
+// variable.  The caller must hold the mutex the waiters use.
+void YabThreadCondBroadcast(YabCond * cond);
+
+///////////////////////////////////////////////////////////////////////////
+// Thread pool functions (threadpool.c, built on the functions above)
+///////////////////////////////////////////////////////////////////////////
+
+// Completion counter: counts the jobs of a batch that haven't finished yet.
+typedef struct YabCounter_struct YabCounter;
+
+// YabThreadCreateCounter:  Create a new completion counter set to zero.
+// Returns NULL on error.
+YabCounter * YabThreadCreateCounter(void);
+
+// YabThreadFreeCounter:  Free a counter created by YabThreadCreateCounter().
+// No job may still be using it.
+void YabThreadFreeCounter(YabCounter * counter);
+
+// YabThreadCounterWait:  Sleep until every job submitted with the counter
+// has finished.  Jobs of the counter still in the queue are run on the
+// calling thread, so it can be called from inside a job.
+void YabThreadCounterWait(YabCounter * counter);
+
+// YabThreadCounterDone:  Returns nonzero if every job submitted with the
+// counter has finished.  Never blocks.
+int YabThreadCounterDone(YabCounter * counter);
+
+// YabThreadPoolStart:  Start worker threads until num of them (at most
+// YAB_MAX_POOL_THREADS) are running.  Returns the number of workers
+// running, which is 0 when the port has no thread support.
+int YabThreadPoolStart(int num);
+
+// YabThreadPoolStop:  Finish all queued jobs, then stop the workers.
+void YabThreadPoolStop(void);
+
+// YabThreadPoolSubmit:  Queue func(arg) to run on a worker and count it in
+// counter, which may be NULL.  If no worker is running or the queue is
+// full, the job is run right away on the calling thread.
+void YabThreadPoolSubmit(YabCounter * counter, void (*func)(void *), void *arg);
+
 ///////////////////////////////////////////////////////////////////////////
 
 #endif  // THREADS_H
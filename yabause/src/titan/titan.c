@@ -24,6 +24,16 @@
 
 #include <stdlib.h>
 
+#if !defined WORDS_BIGENDIAN && !defined USE_RGB_555 && !defined USE_RGB_565
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TITAN_SIMD
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define TITAN_SIMD
+#endif
+#endif
+
 /* private */
 typedef u32 (*TitanBlendFunc)(u32 top, u32 bottom);
 typedef int FASTCALL (*TitanTransFunc)(u32 pixel);
@@ -51,6 +61,7 @@ static struct TitanContext {
    TitanTransFunc trans;
    struct PixelData * backscreen;
    int layer_priority[6];
+   int blend_mode;
 } tt_context = {
    0,
    { NULL, NULL, NULL, NULL, NULL, NULL },
@@ -62,12 +73,11 @@ static struct TitanContext {
 
 struct
 {
-   volatile int need_draw[5];
-   volatile int draw_finished[5];
+   YabCounter * done;
    struct
    {
-      volatile int start;
-      volatile int end;
+      int start;
+      int end;
    }lines[5];
 
    pixel_t * dispbuffer;
@@ -104,6 +114,95 @@ static INLINE u8 TitanGetBlue(u32 pixel) { return pixel & 0xFF; }
 static INLINE u32 TitanCreatePixel(u8 alpha, u8 red, u8 green, u8 blue) { return (alpha << 24) | (red << 16) | (green << 8) | blue; }
 #endif
 
+#ifdef TITAN_SIMD
+// Four pixels at a time. The pixel and the priority/linescreen/shadow bytes
+// of a PixelData are split into two vectors, so all the lane operations below
+// work on 32-bit words.
+#if defined(__SSE2__)
+typedef __m128i TitanVec;
+
+static INLINE TitanVec TitanVecSet(u32 val) { return _mm_set1_epi32(val); }
+static INLINE void TitanVecStore(u32 * dst, TitanVec a) { _mm_storeu_si128((__m128i *)dst, a); }
+static INLINE TitanVec TitanVecAnd(TitanVec a, TitanVec b) { return _mm_and_si128(a, b); }
+static INLINE TitanVec TitanVecOr(TitanVec a, TitanVec b) { return _mm_or_si128(a, b); }
+static INLINE TitanVec TitanVecAndNot(TitanVec a, TitanVec b) { return _mm_andnot_si128(b, a); }
+static INLINE TitanVec TitanVecSelect(TitanVec mask, TitanVec a, TitanVec b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+static INLINE TitanVec TitanVecEqual(TitanVec a, TitanVec b) { return _mm_cmpeq_epi32(a, b); }
+static INLINE TitanVec TitanVecGreater(TitanVec a, TitanVec b) { return _mm_cmpgt_epi32(a, b); }
+static INLINE TitanVec TitanVecAdd(TitanVec a, TitanVec b) { return _mm_add_epi32(a, b); }
+static INLINE TitanVec TitanVecAddBytes(TitanVec a, TitanVec b) { return _mm_add_epi8(a, b); }
+static INLINE TitanVec TitanVecAddBytesSat(TitanVec a, TitanVec b) { return _mm_adds_epu8(a, b); }
+static INLINE int TitanVecAny(TitanVec mask) { return _mm_movemask_epi8(mask) != 0; }
+static INLINE int TitanVecAll(TitanVec mask) { return _mm_movemask_epi8(mask) == 0xFFFF; }
+#define TitanVecShiftLeft(a, n) _mm_slli_epi32(a, n)
+#define TitanVecShiftRight(a, n) _mm_srli_epi32(a, n)
+
+static INLINE void TitanVecLoad(const struct PixelData * src, TitanVec * pixel, TitanVec * info)
+{
+   __m128 lo = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)src));
+   __m128 hi = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(src + 2)));
+   *pixel = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+   *info = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+// (a * b) / 0xFF for every byte, exact for all 8-bit inputs
+static INLINE TitanVec TitanVecMulBytes(TitanVec a, TitanVec b)
+{
+   __m128i zero = _mm_setzero_si128();
+   __m128i one = _mm_set1_epi16(1);
+   __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+   __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+   lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+   hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+   return _mm_packus_epi16(lo, hi);
+}
+#else
+typedef uint32x4_t TitanVec;
+
+static INLINE TitanVec TitanVecSet(u32 val) { return vdupq_n_u32(val); }
+static INLINE void TitanVecStore(u32 * dst, TitanVec a) { vst1q_u32(dst, a); }
+static INLINE TitanVec TitanVecAnd(TitanVec a, TitanVec b) { return vandq_u32(a, b); }
+static INLINE TitanVec TitanVecOr(TitanVec a, TitanVec b) { return vorrq_u32(a, b); }
+static INLINE TitanVec TitanVecAndNot(TitanVec a, TitanVec b) { return vbicq_u32(a, b); }
+static INLINE TitanVec TitanVecSelect(TitanVec mask, TitanVec a, TitanVec b) { return vbslq_u32(mask, a, b); }
+static INLINE TitanVec TitanVecEqual(TitanVec a, TitanVec b) { return vceqq_u32(a, b); }
+static INLINE TitanVec TitanVecGreater(TitanVec a, TitanVec b) { return vcgtq_s32(vreinterpretq_s32_u32(a), vreinterpretq_s32_u32(b)); }
+static INLINE TitanVec TitanVecAdd(TitanVec a, TitanVec b) { return vaddq_u32(a, b); }
+static INLINE TitanVec TitanVecAddBytes(TitanVec a, TitanVec b) { return vreinterpretq_u32_u8(vaddq_u8(vreinterpretq_u8_u32(a), vreinterpretq_u8_u32(b))); }
+static INLINE TitanVec TitanVecAddBytesSat(TitanVec a, TitanVec b) { return vreinterpretq_u32_u8(vqaddq_u8(vreinterpretq_u8_u32(a), vreinterpretq_u8_u32(b))); }
+static INLINE int TitanVecAny(TitanVec mask) { return vmaxvq_u32(mask) != 0; }
+static INLINE int TitanVecAll(TitanVec mask) { return vminvq_u32(mask) != 0; }
+#define TitanVecShiftLeft(a, n) vshlq_n_u32(a, n)
+#define TitanVecShiftRight(a, n) vshrq_n_u32(a, n)
+
+static INLINE void TitanVecLoad(const struct PixelData * src, TitanVec * pixel, TitanVec * info)
+{
+   uint32x4x2_t data = vld2q_u32((const u32 *)src);
+   *pixel = data.val[0];
+   *info = data.val[1];
+}
+
+// (a * b) / 0xFF for every byte, exact for all 8-bit inputs
+static INLINE TitanVec TitanVecMulBytes(TitanVec a, TitanVec b)
+{
+   uint8x16_t a8 = vreinterpretq_u8_u32(a);
+   uint8x16_t b8 = vreinterpretq_u8_u32(b);
+   uint16x8_t one = vdupq_n_u16(1);
+   uint16x8_t lo = vmull_u8(vget_low_u8(a8), vget_low_u8(b8));
+   uint16x8_t hi = vmull_high_u8(a8, b8);
+   lo = vshrq_n_u16(vaddq_u16(vaddq_u16(lo, one), vshrq_n_u16(lo, 8)), 8);
+   hi = vshrq_n_u16(vaddq_u16(vaddq_u16(hi, one), vshrq_n_u16(hi, 8)), 8);
+   return vreinterpretq_u32_u8(vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+}
+#endif
+
+static INLINE TitanVec TitanVecFixAlpha(TitanVec pixel)
+{
+   return TitanVecOr(TitanVecAdd(TitanVecShiftLeft(TitanVecAnd(pixel, TitanVecSet(0x3F000000)), 2), TitanVecSet(0x03000000)),
+                     TitanVecAnd(pixel, TitanVecSet(0x00FFFFFF)));
+}
+#endif
+
 
 void set_layer_y(const int start_line, int * layer_y)
 {
@@ -113,6 +212,55 @@ void set_layer_y(const int start_line, int * layer_y)
       *layer_y = start_line;
 }
 
+#ifdef TITAN_SIMD
+//same as the loop in TitanRenderLinesSimplified, four pixels at a time
+static int TitanRenderLineSimplifiedSimd(u32 * dst, int layer_pos, int y, const int * sorted_layers, int num_layers)
+{
+   int x, j;
+   TitanVec zero = TitanVecSet(0);
+   TitanVec back = TitanVecSet(tt_context.backscreen[y].pixel);
+
+   for (x = 0; x + 4 <= tt_context.vdp2width; x += 4)
+   {
+      TitanVec sprite, sprite_priority, pixel, info, result, done;
+
+      TitanVecLoad(tt_context.vdp2framebuffer[TITAN_SPRITE] + layer_pos + x, &sprite, &sprite_priority);
+      sprite_priority = TitanVecAnd(sprite_priority, TitanVecSet(0xFF));
+      result = zero;
+      done = zero;
+
+      for (j = 0; j < num_layers; j++)
+      {
+         int bg_layer = sorted_layers[j];
+         TitanVec take;
+
+         if (bg_layer == TITAN_BACK)
+         {
+            //whatever is left gets the sprite pixel or the back screen
+            pixel = TitanVecSelect(TitanVecEqual(sprite, zero), back, sprite);
+            result = TitanVecSelect(done, result, pixel);
+            break;
+         }
+
+         TitanVecLoad(tt_context.vdp2framebuffer[bg_layer] + layer_pos + x, &pixel, &info);
+
+         //sprite pixels on top of the layer hide it even when transparent
+         pixel = TitanVecSelect(TitanVecGreater(TitanVecSet(tt_context.layer_priority[bg_layer]), sprite_priority), pixel, sprite);
+         take = TitanVecAndNot(TitanVecAndNot(TitanVecSet(0xFFFFFFFF), TitanVecEqual(pixel, zero)), done);
+         result = TitanVecSelect(take, pixel, result);
+         done = TitanVecOr(done, take);
+
+         if (TitanVecAll(done))
+            break;
+      }
+
+      TitanVecStore(dst + x, TitanVecFixAlpha(result));
+   }
+
+   return x;
+}
+#endif
+
 void TitanRenderLinesSimplified(pixel_t * dispbuffer, int start_line, int end_line)
 {
    int x, y, i, layer, j, layer_y;
@@ -144,7 +292,11 @@ void TitanRenderLinesSimplified(pixel_t * dispbuffer, int start_line, int end_li
 
    for (y = start_line + interlace_line; y < end_line; y += line_increment)
    {
-      for (x = 0; x < tt_context.vdp2width; x++)
+      x = 0;
+#ifdef TITAN_SIMD
+      x = TitanRenderLineSimplifiedSimd(dispbuffer + (y * tt_context.vdp2width), layer_y * tt_context.vdp2width, y, sorted_layers, num_layers);
+#endif
+      for (; x < tt_context.vdp2width; x++)
       {
          int layer_pos = (layer_y * tt_context.vdp2width) + x;
          i = (y * tt_context.vdp2width) + x;
@@ -206,26 +358,12 @@ void TitanRenderSimplifiedCheck(pixel_t * buf, int start, int end, int can_use_s
       TitanRenderLines(buf, start, end);
 }
 
-#define DECLARE_PRIORITY_THREAD(FUNC_NAME, THREAD_NUMBER) \
-void FUNC_NAME(void* data) \
-{ \
-   for (;;) \
-   { \
-      if (priority_thread_context.need_draw[THREAD_NUMBER]) \
-      { \
-         priority_thread_context.need_draw[THREAD_NUMBER] = 0; \
-         TitanRenderSimplifiedCheck(priority_thread_context.dispbuffer, priority_thread_context.lines[THREAD_NUMBER].start, priority_thread_context.lines[THREAD_NUMBER].end, priority_thread_context.use_simplified); \
-         priority_thread_context.draw_finished[THREAD_NUMBER] = 1; \
-      } \
-      YabThreadSleep(); \
-   } \
-}
+static void TitanPriorityJob(void* data)
+{
+   int which = (int)(pointer)data;
 
-DECLARE_PRIORITY_THREAD(VidsoftPriorityThread0, 0);
-DECLARE_PRIORITY_THREAD(VidsoftPriorityThread1, 1);
-DECLARE_PRIORITY_THREAD(VidsoftPriorityThread2, 2);
-DECLARE_PRIORITY_THREAD(VidsoftPriorityThread3, 3);
-DECLARE_PRIORITY_THREAD(VidsoftPriorityThread4, 4);
+   TitanRenderSimplifiedCheck(priority_thread_context.dispbuffer, priority_thread_context.lines[which].start, priority_thread_context.lines[which].end, priority_thread_context.use_simplified);
+}
 
 static u32 TitanBlendPixelsTop(u32 top, u32 bottom)
 {
@@ -373,6 +511,87 @@ finished:
    return pixel_stack[0].pixel;
 }
 
+#ifdef TITAN_SIMD
+//TitanDigPixel for four pixels at a time. Groups where the top pixel uses a
+//line screen or a shadow go through TitanDigPixel instead.
+static int TitanRenderLineSimd(u32 * dst, int layer_pos, int y)
+{
+   int x, layer;
+   TitanVec zero = TitanVecSet(0);
+   TitanVec full_alpha = TitanVecSet(0x3F000000);
+
+   for (x = 0; x + 4 <= tt_context.vdp2width; x += 4)
+   {
+      int pos = layer_pos + x;
+      TitanVec top, top_info, top_key, second, second_key;
+      TitanVec pixel, info, key, above_top, above_second, trans, blended, alpha;
+
+      //the back screen sorts below every layer and a blank pixel below it,
+      //layers with no priority sort below both
+      TitanVecLoad(tt_context.backscreen + pos, &top, &top_info);
+      top_key = TitanVecSet(7);
+      second = zero;
+      second_key = TitanVecSet(6);
+
+      for (layer = 0; layer <= TITAN_SPRITE; layer++)
+      {
+         TitanVecLoad(tt_context.vdp2framebuffer[layer] + pos, &pixel, &info);
+
+         key = TitanVecAnd(info, TitanVecSet(0xFF));
+         key = TitanVecAnd(TitanVecAdd(TitanVecShiftLeft(key, 3), TitanVecSet(layer)),
+                           TitanVecAnd(TitanVecGreater(key, zero), TitanVecGreater(TitanVecSet(8), key)));
+
+         above_top = TitanVecGreater(key, top_key);
+         above_second = TitanVecGreater(key, second_key);
+         second = TitanVecSelect(above_top, top, TitanVecSelect(above_second, pixel, second));
+         second_key = TitanVecSelect(above_top, top_key, TitanVecSelect(above_second, key, second_key));
+         top = TitanVecSelect(above_top, pixel, top);
+         top_info = TitanVecSelect(above_top, info, top_info);
+         top_key = TitanVecSelect(above_top, key, top_key);
+      }
+
+      if (TitanVecAny(TitanVecGreater(TitanVecAnd(top_info, TitanVecSet(0x00FFFF00)), zero)))
+      {
+         int i;
+
+         for (i = 0; i < 4; i++)
+         {
+            u32 dot = TitanDigPixel(pos + i, y);
+            dst[x + i] = dot ? TitanFixAlpha(dot) : 0;
+         }
+         continue;
+      }
+
+      if (tt_context.blend_mode == TITAN_BLEND_TOP)
+         trans = TitanVecGreater(full_alpha, TitanVecAnd(top, full_alpha));
+      else
+         trans = TitanVecGreater(zero, top);
+
+      if (TitanVecAny(trans))
+      {
+         if (tt_context.blend_mode == TITAN_BLEND_ADD)
+            blended = TitanVecOr(TitanVecAnd(TitanVecAddBytesSat(top, second), TitanVecSet(0x00FFFFFF)), full_alpha);
+         else
+         {
+            //alpha * 4 + 3 in each color byte, 0xFF minus that is the complement
+            alpha = TitanVecShiftRight(TitanVecAnd(tt_context.blend_mode == TITAN_BLEND_TOP ? top : second, full_alpha), 24);
+            alpha = TitanVecAdd(TitanVecShiftLeft(alpha, 2), TitanVecSet(3));
+            alpha = TitanVecOr(alpha, TitanVecOr(TitanVecShiftLeft(alpha, 8), TitanVecShiftLeft(alpha, 16)));
+            blended = TitanVecAddBytes(TitanVecMulBytes(top, alpha), TitanVecMulBytes(second, TitanVecAndNot(TitanVecSet(0xFFFFFFFF), alpha)));
+            blended = TitanVecOr(TitanVecAnd(blended, TitanVecSet(0x00FFFFFF)),
+                                 tt_context.blend_mode == TITAN_BLEND_TOP ? full_alpha : TitanVecAnd(top, full_alpha));
+         }
+
+         top = TitanVecSelect(trans, blended, top);
+      }
+
+      TitanVecStore(dst + x, TitanVecAndNot(TitanVecFixAlpha(top), TitanVecEqual(top, zero)));
+   }
+
+   return x;
+}
+#endif
+
 /* public */
 int TitanInit()
 {
@@ -396,17 +615,8 @@ int TitanInit()
       if ((tt_context.backscreen = (struct PixelData  *)calloc(sizeof(struct PixelData), 704 * 512)) == NULL)
          return -1;
 
-      for (i = 0; i < 5; i++)
-      {
-         priority_thread_context.draw_finished[i] = 1;
-         priority_thread_context.need_draw[i] = 0;
-      }
-
-      YabThreadStart(YAB_THREAD_VIDSOFT_PRIORITY_0, VidsoftPriorityThread0, NULL);
-      YabThreadStart(YAB_THREAD_VIDSOFT_PRIORITY_1, VidsoftPriorityThread1, NULL);
-      YabThreadStart(YAB_THREAD_VIDSOFT_PRIORITY_2, VidsoftPriorityThread2, NULL);
-      YabThreadStart(YAB_THREAD_VIDSOFT_PRIORITY_3, VidsoftPriorityThread3, NULL);
-      YabThreadStart(YAB_THREAD_VIDSOFT_PRIORITY_4, VidsoftPriorityThread4, NULL);
+      if ((priority_thread_context.done = YabThreadCreateCounter()) == NULL)
+         return -1;
 
       tt_context.inited = 1;
    }
@@ -437,12 +647,26 @@ int TitanDeInit()
 {
    int i;
 
+   if (! tt_context.inited)
+      return 0;
+
    for(i = 0;i < 6;i++)
       free(tt_context.vdp2framebuffer[i]);
 
    for(i = 1;i < 4;i++)
       free(tt_context.linescreen[i]);
 
+   free(tt_context.backscreen);
+
+   if (priority_thread_context.done)
+   {
+      YabThreadCounterWait(priority_thread_context.done);
+      YabThreadFreeCounter(priority_thread_context.done);
+      priority_thread_context.done = NULL;
+   }
+
+   tt_context.inited = 0;
+
    return 0;
 }
 
@@ -460,6 +684,8 @@ void TitanGetResolution(int * width, int * height)
 
 void TitanSetBlendingMode(int blend_mode)
 {
+   tt_context.blend_mode = blend_mode;
+
    if (blend_mode == TITAN_BLEND_BOTTOM)
    {
       tt_context.blend = TitanBlendPixelsBottom;
@@ -540,7 +766,11 @@ void TitanRenderLines(pixel_t * dispbuffer, int start_line, int end_line)
    
    for (y = start_line + interlace_line; y < end_line; y += line_increment)
    {
-      for (x = 0; x < tt_context.vdp2width; x++)
+      x = 0;
+#ifdef TITAN_SIMD
+      x = TitanRenderLineSimd(dispbuffer + (y * tt_context.vdp2width), layer_y * tt_context.vdp2width, y);
+#endif
+      for (; x < tt_context.vdp2width; x++)
       {
          int i = (y * tt_context.vdp2width) + x;
          int layer_pos = (layer_y * tt_context.vdp2width) + x;
@@ -569,18 +799,14 @@ void VIDSoftSetNumPriorityThreads(int num)
 
    if (num == 4)
       vidsoft_num_priority_threads = 3;
-}
 
-void TitanStartPriorityThread(int which)
-{
-   priority_thread_context.need_draw[which] = 1;
-   priority_thread_context.draw_finished[which] = 0;
-   YabThreadWake(YAB_THREAD_VIDSOFT_PRIORITY_0 + which);
+   if (vidsoft_num_priority_threads > 0)
+      YabThreadPoolStart(vidsoft_num_priority_threads);
 }
 
-void TitanWaitForPriorityThread(int which)
+void TitanStartPriorityThread(int which)
 {
-   while (!priority_thread_context.draw_finished[which]){}
+   YabThreadPoolSubmit(priority_thread_context.done, TitanPriorityJob, (void *)(pointer)which);
 }
 
 void TitanRenderThreads(pixel_t * dispbuffer, int can_use_simplified)
@@ -617,10 +843,7 @@ void TitanRenderThreads(pixel_t * dispbuffer, int can_use_simplified)
 
    TitanRenderSimplifiedCheck(dispbuffer, starts[0], ends[0], can_use_simplified);
 
-   for (i = 0; i < vidsoft_num_priority_threads; i++)
-   {
-      TitanWaitForPriorityThread(i);
-   }
+   YabThreadCounterWait(priority_thread_context.done);
 }
 
 void TitanRender(pixel_t * dispbuffer)
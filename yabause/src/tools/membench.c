@@ -0,0 +1,214 @@
+/*******************************************************************************
+  MEMBENCH - Yabause SH2 memory access benchmark
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+
+*******************************************************************************/
+
+// Measures how many SH2 loads per second go through the handler tables and
+// through the host page lists, for work ram and for an mmio area.
+
+// Run it with the number of millions of loads per test as the argument
+// example: membench 50
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../core.h"
+#include "../cdbase.h"
+#include "../cs0.h"
+#include "../m68kcore.h"
+#include "../memory.h"
+#include "../peripheral.h"
+#include "../sh2core.h"
+#include "../scsp.h"
+#include "../vdp1.h"
+#include "../yabause.h"
+
+#define PROG_NAME "MEMBENCH"
+#define VER_NAME "1.0"
+
+// Unused functions and variables
+SH2Interface_struct *SH2CoreList[] = {
+	NULL
+};
+
+VideoInterface_struct *VIDCoreList[] = {
+	NULL
+};
+
+SoundInterface_struct *SNDCoreList[] = {
+	NULL
+};
+
+M68K_struct * M68KCoreList[] = {
+	NULL
+};
+
+CDInterface *CDCoreList[] = {
+	NULL
+};
+
+PerInterface_struct *PERCoreList[] = {
+	NULL
+};
+
+void YuiErrorMsg(const char *string) { }
+
+void YuiSwapBuffers() { }
+
+// Keeps the loads from being optimized away
+volatile u32 sink;
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ProgramUsage()
+{
+   printf("%s v%s\n", PROG_NAME, VER_NAME);
+   printf("usage: %s [millions of loads per test]\n", PROG_NAME);
+   exit (1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 HandlerReadLong(SH2_struct *sh, u32 addr)
+{
+   return sh->ReadLongList[(addr >> 16) & 0xFFF](sh, addr);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 NocacheReadLong(SH2_struct *sh, u32 addr)
+{
+   return MappedMemoryReadLongNocache(sh, addr);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 PageReadLong(SH2_struct *sh, u32 addr)
+{
+   return SH2MemoryReadLong(sh, addr);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+#define NUM_ADDRESSES 0x10000
+
+u32 addresses[NUM_ADDRESSES];
+
+//////////////////////////////////////////////////////////////////////////////
+
+void FillAddresses(const u32 *bases, int numbases, u32 mask)
+{
+   u32 seed = 1;
+   int i;
+
+   // Scatter the loads over the areas so the handlers don't always repeat
+   for (i = 0; i < NUM_ADDRESSES; i++)
+   {
+      seed = seed * 1103515245 + 12345;
+      addresses[i] = bases[(seed >> 16) % numbases] + ((seed >> 4) & mask & ~3);
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void RunTest(const char *name, SH2_struct *sh, u32 (*func)(SH2_struct *, u32),
+             u32 count)
+{
+   clock_t start, end;
+   double seconds;
+   u32 sum = 0;
+   u32 i;
+
+   start = clock();
+   for (i = 0; i < count; i++)
+      sum += func(sh, addresses[i & (NUM_ADDRESSES - 1)]);
+   end = clock();
+   sink = sum;
+
+   seconds = (double)(end - start) / CLOCKS_PER_SEC;
+   if (seconds <= 0)
+      seconds = 1.0 / CLOCKS_PER_SEC;
+
+   printf("%-32s %8.2f Mloads/s\n", name, count / seconds / 1000000.0);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+   SH2_struct *sh;
+   u32 count = 50;
+
+   if (argc > 2)
+      ProgramUsage();
+   if (argc == 2 && (count = strtoul(argv[1], NULL, 10)) == 0)
+      ProgramUsage();
+   count *= 1000000;
+
+   if ((sh = (SH2_struct *)calloc(1, sizeof(SH2_struct))) == NULL ||
+       (BiosRom = T2MemoryInit(0x80000)) == NULL ||
+       (HighWram = T2MemoryInit(0x100000)) == NULL ||
+       (LowWram = T2MemoryInit(0x100000)) == NULL)
+   {
+      printf("Error allocating memory\n");
+      return 1;
+   }
+
+   if (CartInit(NULL, CART_NONE) != 0)
+   {
+      printf("Error initializing cartridge\n");
+      return 1;
+   }
+
+   sh->model = SHMT_SH2;
+   sh->MappedMemoryReadByte = MappedMemoryReadByteNocache;
+   sh->MappedMemoryReadWord = MappedMemoryReadWordNocache;
+   sh->MappedMemoryReadLong = MappedMemoryReadLongNocache;
+   sh->MappedMemoryWriteByte = MappedMemoryWriteByteNocache;
+   sh->MappedMemoryWriteWord = MappedMemoryWriteWordNocache;
+   sh->MappedMemoryWriteLong = MappedMemoryWriteLongNocache;
+   MappedMemoryInit(sh, sh, NULL);
+
+   printf("%u loads per test\n", count);
+
+   // Work ram and bios, cached and cache-through
+   {
+      static const u32 bases[] = { 0x06000000, 0x26000000, 0x00200000, 0x20000000 };
+      FillAddresses(bases, 4, 0x7FFFF);
+   }
+   RunTest("WRAM/BIOS handler table", sh, HandlerReadLong, count);
+   RunTest("WRAM/BIOS MappedMemoryReadLong", sh, NocacheReadLong, count);
+   RunTest("WRAM/BIOS page list", sh, PageReadLong, count);
+
+   // Backup ram, which always needs its handler
+   {
+      static const u32 bases[] = { 0x00180000, 0x20180000 };
+      FillAddresses(bases, 2, 0xFFFF);
+   }
+   RunTest("BUPRAM handler table", sh, HandlerReadLong, count);
+   RunTest("BUPRAM MappedMemoryReadLong", sh, NocacheReadLong, count);
+   RunTest("BUPRAM page list", sh, PageReadLong, count);
+
+   CartDeInit();
+   T2MemoryDeInit(LowWram);
+   T2MemoryDeInit(HighWram);
+   T2MemoryDeInit(BiosRom);
+   free(sh);
+
+   return 0;
+}
@@ -0,0 +1,292 @@
+/*******************************************************************************
+  SH2BENCH - Yabause dual SH2 benchmark
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+
+*******************************************************************************/
+
+// Runs a vertex transform loop on both SH2s, one after the other and then
+// with the slave on its own thread, and compares the time taken and the
+// results.
+
+// Run it with the number of millions of cycles per SH2 and the skew window
+// in cycles(0 = a whole slice) as the arguments
+// example: sh2bench 100 0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../core.h"
+#include "../cdbase.h"
+#include "../cs0.h"
+#include "../m68kcore.h"
+#include "../memory.h"
+#include "../peripheral.h"
+#include "../sh2core.h"
+#include "../sh2int.h"
+#include "../scsp.h"
+#include "../vdp1.h"
+#include "../yabause.h"
+
+#define PROG_NAME "SH2BENCH"
+#define VER_NAME "1.0"
+
+SH2Interface_struct *SH2CoreList[] = {
+	&SH2Interpreter,
+	NULL
+};
+
+// Unused functions and variables
+VideoInterface_struct *VIDCoreList[] = {
+	NULL
+};
+
+SoundInterface_struct *SNDCoreList[] = {
+	NULL
+};
+
+M68K_struct * M68KCoreList[] = {
+	NULL
+};
+
+CDInterface *CDCoreList[] = {
+	NULL
+};
+
+PerInterface_struct *PERCoreList[] = {
+	NULL
+};
+
+void YuiErrorMsg(const char *string) { }
+
+void YuiSwapBuffers() { }
+
+// Transforms r10 vertices at r8 by the 16.16 matrix at r6 into r9, forever
+static const u16 transform_prog[] = {
+   0x6483, // start: mov r8,r4
+   0x6593, //        mov r9,r5
+   0x67A3, //        mov r10,r7
+   0x6163, // loop:  mov r6,r1
+   0x6243, //        mov r4,r2
+   0x0028, //        clrmac
+   0x012F, //        mac.l @r2+,@r1+
+   0x012F, //        mac.l @r2+,@r1+
+   0x012F, //        mac.l @r2+,@r1+
+   0x000A, //        sts mach,r0
+   0x031A, //        sts macl,r3
+   0x230D, //        xtrct r0,r3
+   0x2532, //        mov.l r3,@r5
+   0x7504, //        add #4,r5
+   0x6243, //        mov r4,r2
+   0x0028, //        clrmac
+   0x012F, //        mac.l @r2+,@r1+
+   0x012F, //        mac.l @r2+,@r1+
+   0x012F, //        mac.l @r2+,@r1+
+   0x000A, //        sts mach,r0
+   0x031A, //        sts macl,r3
+   0x230D, //        xtrct r0,r3
+   0x2532, //        mov.l r3,@r5
+   0x7504, //        add #4,r5
+   0x6243, //        mov r4,r2
+   0x0028, //        clrmac
+   0x012F, //        mac.l @r2+,@r1+
+   0x012F, //        mac.l @r2+,@r1+
+   0x012F, //        mac.l @r2+,@r1+
+   0x000A, //        sts mach,r0
+   0x031A, //        sts macl,r3
+   0x230D, //        xtrct r0,r3
+   0x2532, //        mov.l r3,@r5
+   0x7504, //        add #4,r5
+   0x740C, //        add #12,r4
+   0x4710, //        dt r7
+   0x8BDD, //        bf loop
+   0xAFD9, //        bra start
+   0x0009  //        nop
+};
+
+#define PROG_ADDR      0x06004000
+#define NUM_VERTICES   256
+
+typedef struct
+{
+   u32 matrix;
+   u32 vertices;
+   u32 output;
+} sh2data_struct;
+
+static const sh2data_struct cpu_data[2] = {
+   { 0x06010000, 0x06010100, 0x06020000 },
+   { 0x06040000, 0x06040100, 0x06050000 }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ProgramUsage()
+{
+   printf("%s v%s\n", PROG_NAME, VER_NAME);
+   printf("usage: %s [millions of cycles per SH2] [skew window in cycles]\n", PROG_NAME);
+   exit (1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void SetupCPU(SH2_struct *sh, const sh2data_struct *data, u32 seed)
+{
+   u32 i;
+
+   for (i = 0; i < 9; i++)
+   {
+      seed = seed * 1103515245 + 12345;
+      SH2MemoryWriteLong(sh, data->matrix + i * 4, (seed >> 8) & 0x1FFFF);
+   }
+
+   for (i = 0; i < NUM_VERTICES * 3; i++)
+   {
+      seed = seed * 1103515245 + 12345;
+      SH2MemoryWriteLong(sh, data->vertices + i * 4, (seed >> 4) & 0xFFFFFF);
+   }
+
+   SH2Reset(sh);
+   sh->core->SetSR(sh, 0xF0);
+   sh->core->SetPC(sh, PROG_ADDR);
+   sh->core->SetGPR(sh, 6, data->matrix);
+   sh->core->SetGPR(sh, 8, data->vertices);
+   sh->core->SetGPR(sh, 9, data->output);
+   sh->core->SetGPR(sh, 10, NUM_VERTICES);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Setup(void)
+{
+   u32 i;
+
+   memset(HighWram, 0, 0x100000);
+
+   for (i = 0; i < sizeof(transform_prog) / sizeof(transform_prog[0]); i++)
+      SH2MemoryWriteWord(MSH2, PROG_ADDR + i * 2, transform_prog[i]);
+
+   SetupCPU(MSH2, &cpu_data[0], 1);
+   SetupCPU(SSH2, &cpu_data[1], 2);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 Checksum(void)
+{
+   u32 sum = 0;
+   u32 i;
+   int j;
+
+   for (i = 0; i < NUM_VERTICES * 3; i++)
+   {
+      sum = sum * 31 + SH2MemoryReadLong(MSH2, cpu_data[0].output + i * 4);
+      sum = sum * 31 + SH2MemoryReadLong(MSH2, cpu_data[1].output + i * 4);
+   }
+
+   for (j = 0; j < 16; j++)
+   {
+      sum = sum * 31 + MSH2->core->GetGPR(MSH2, j);
+      sum = sum * 31 + SSH2->core->GetGPR(SSH2, j);
+   }
+
+   return sum + MSH2->core->GetPC(MSH2) + SSH2->core->GetPC(SSH2);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u64 RunTest(int threaded, u32 cycles, u32 *sum)
+{
+   // Run in slices about the size of a scanline, like the emulation loop
+   const u32 slice = 1708;
+   u64 start;
+   u32 i;
+
+   Setup();
+
+   start = YabauseGetTicks();
+   for (i = 0; i < cycles / slice; i++)
+   {
+      if (threaded)
+         SH2ExecParallel(slice);
+      else
+      {
+         SH2Exec(MSH2, slice);
+         SH2Exec(SSH2, slice);
+      }
+   }
+
+   *sum = Checksum();
+   return YabauseGetTicks() - start;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+   u32 cycles = 100;
+   u32 skew = 0;
+   u32 serial_sum, threaded_sum;
+   u64 serial_ticks, threaded_ticks;
+
+   if (argc > 3)
+      ProgramUsage();
+   if (argc >= 2 && (cycles = strtoul(argv[1], NULL, 10)) == 0)
+      ProgramUsage();
+   if (argc == 3)
+      skew = strtoul(argv[2], NULL, 10);
+   cycles *= 1000000;
+
+   if (SH2Init(SH2CORE_INTERPRETER) != 0 ||
+       (BiosRom = T2MemoryInit(0x80000)) == NULL ||
+       (HighWram = T2MemoryInit(0x100000)) == NULL ||
+       (LowWram = T2MemoryInit(0x100000)) == NULL)
+   {
+      printf("Error allocating memory\n");
+      return 1;
+   }
+
+   if (CartInit(NULL, CART_NONE) != 0)
+   {
+      printf("Error initializing cartridge\n");
+      return 1;
+   }
+
+   MappedMemoryInit(MSH2, SSH2, NULL);
+
+   if (SH2ThreadStart(skew) != 0)
+   {
+      printf("Error starting the slave SH2 thread (is YAB_USE_SSH2_THREAD on?)\n");
+      return 1;
+   }
+
+   printf("%u cycles per SH2, skew window %u\n", cycles, skew);
+
+   serial_ticks = RunTest(0, cycles, &serial_sum);
+   threaded_ticks = RunTest(1, cycles, &threaded_sum);
+
+   printf("serial:   %10llu ticks\n", (unsigned long long)serial_ticks);
+   printf("threaded: %10llu ticks\n", (unsigned long long)threaded_ticks);
+   printf("speedup:  %10.2fx\n", threaded_ticks ? (double)serial_ticks / threaded_ticks : 0.0);
+   printf("results %s\n", serial_sum == threaded_sum ? "match" : "DIFFER");
+
+   SH2DeInit();
+   CartDeInit();
+   T2MemoryDeInit(LowWram);
+   T2MemoryDeInit(HighWram);
+   T2MemoryDeInit(BiosRom);
+
+   return serial_sum != threaded_sum;
+}
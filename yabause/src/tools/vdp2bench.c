@@ -0,0 +1,299 @@
+/*******************************************************************************
+  VDP2BENCH - Yabause VDP2 scroll screen benchmark
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+
+*******************************************************************************/
+
+// Draws a set of VDP2 states with the software renderer, once with the
+// generic scroll screen dot loop and once with the specialized kernels, and
+// compares the time taken and the output.
+
+// The built in states each exercise one kernel. Save states given on the
+// command line are benchmarked too, with the registers they were saved with
+// used for every line.
+// example: vdp2bench 100 game.yss
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../core.h"
+#include "../cdbase.h"
+#include "../cs0.h"
+#include "../m68kcore.h"
+#include "../memory.h"
+#include "../peripheral.h"
+#include "../scsp.h"
+#include "../sh2core.h"
+#include "../sh2int.h"
+#include "../vdp1.h"
+#include "../vdp2.h"
+#include "../vidsoft.h"
+#include "../yabause.h"
+
+#define PROG_NAME "VDP2BENCH"
+#define VER_NAME "1.0"
+
+#define NUM_ROUNDS 3
+
+SH2Interface_struct *SH2CoreList[] = {
+	&SH2Interpreter,
+	NULL
+};
+
+VideoInterface_struct *VIDCoreList[] = {
+	&VIDSoft,
+	NULL
+};
+
+// Unused functions and variables
+SoundInterface_struct *SNDCoreList[] = {
+	&SNDDummy,
+	NULL
+};
+
+M68K_struct * M68KCoreList[] = {
+	&M68KDummy,
+	NULL
+};
+
+CDInterface *CDCoreList[] = {
+	&DummyCD,
+	NULL
+};
+
+PerInterface_struct *PERCoreList[] = {
+	&PERDummy,
+	NULL
+};
+
+void YuiErrorMsg(const char *string) { printf("%s\n", string); }
+
+void YuiSwapBuffers() { }
+
+typedef struct
+{
+   const char *name;
+   const char *kernel;
+   u16 bgon;
+   u16 chctla;
+   u16 chctlb;
+   u32 zoom;       // ZMXN0/ZMXN1, 16.16
+   u16 mzctl;
+   u16 sfprmd;
+   u16 clofen;
+} vdp2state_struct;
+
+// Register settings captured from the common cases the kernels are meant for
+static const vdp2state_struct states[] = {
+   { "4 NBG, 16 colors",      "zop",     0x000F, 0x0000, 0x0000, 0x10000, 0x0000, 0x0000, 0x0000 },
+   { "4 NBG, 256 colors",     "zop",     0x000F, 0x1010, 0x0010, 0x10000, 0x0000, 0x0000, 0x0000 },
+   { "4 NBG, color offset",   "zOp",     0x000F, 0x1010, 0x0010, 0x10000, 0x0000, 0x0000, 0x000F },
+   { "4 NBG, dot priority",   "zoP",     0x000F, 0x1010, 0x0010, 0x10000, 0x0000, 0x00AA, 0x0000 },
+   { "NBG0/1 zoomed",         "Zop",     0x0003, 0x1010, 0x0000, 0x0C000, 0x0000, 0x0000, 0x0000 },
+   { "4 NBG, mosaic",         "Zop",     0x000F, 0x1010, 0x0010, 0x10000, 0x330F, 0x0000, 0x0000 },
+   { "NBG0 bitmap",           "generic", 0x0001, 0x0012, 0x0000, 0x10000, 0x0000, 0x0000, 0x0000 },
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ProgramUsage()
+{
+   printf("%s v%s\n", PROG_NAME, VER_NAME);
+   printf("usage: %s [frames] [save state files...]\n", PROG_NAME);
+   exit (1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void FillRam(void)
+{
+   u32 seed = 1;
+   u32 i;
+
+   for (i = 0; i < 0x80000; i += 2)
+   {
+      seed = seed * 1103515245 + 12345;
+      Vdp2RamWriteWord(i, seed >> 16);
+   }
+
+   for (i = 0; i < 0x1000; i += 2)
+   {
+      seed = seed * 1103515245 + 12345;
+      Vdp2ColorRamWriteWord(i, seed >> 16);
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void SetupState(const vdp2state_struct *state)
+{
+   memset(Vdp2Regs, 0, sizeof(Vdp2));
+   Vdp2Regs->TVMD = 0x8000;
+   Vdp2Regs->BGON = state->bgon;
+   Vdp2Regs->PRINA = 0x0306;
+   Vdp2Regs->PRINB = 0x0205;
+   Vdp2Regs->CHCTLA = state->chctla;
+   Vdp2Regs->CHCTLB = state->chctlb;
+   Vdp2Regs->ZMXN0.all = Vdp2Regs->ZMYN0.all = state->zoom;
+   Vdp2Regs->ZMXN1.all = Vdp2Regs->ZMYN1.all = state->zoom;
+   Vdp2Regs->MZCTL = state->mzctl;
+   Vdp2Regs->SFPRMD = state->sfprmd;
+   Vdp2Regs->SFCODE = 0x0F0F;
+   Vdp2Regs->CLOFEN = state->clofen;
+   Vdp2Regs->COAR = 0x0020;
+   Vdp2Regs->COAG = 0x01F0;
+   Vdp2Regs->COAB = 0x0010;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 Checksum(void)
+{
+   int width, height, interlace;
+   u32 sum = 0;
+   int i;
+
+   VIDCore->GetNativeResolution(&width, &height, &interlace);
+   for (i = 0; i < width * height; i++)
+      sum = sum * 31 + dispbuffer[i];
+
+   return sum;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void DrawFrame(const Vdp2 *regs, int frame)
+{
+   int i;
+
+   // Scroll a little every frame, so the cell cache sees new cells
+   Vdp2Regs->SCXIN0 = regs->SCXIN0 + frame;
+   Vdp2Regs->SCYIN0 = regs->SCYIN0 + frame;
+   Vdp2Regs->SCXIN1 = regs->SCXIN1 - frame;
+   Vdp2Regs->SCXN2 = regs->SCXN2 + frame * 2;
+   Vdp2Regs->SCYN3 = regs->SCYN3 + frame * 2;
+   for (i = 0; i < 270; i++)
+      Vdp2Lines[i] = *Vdp2Regs;
+
+   VIDCore->Vdp2DrawStart();
+   VIDCore->Vdp2DrawScreens();
+   VIDCore->Vdp2DrawEnd();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u64 RunTest(int kernels, int frames, u32 *sum)
+{
+   Vdp2 regs = *Vdp2Regs;
+   u64 ticks;
+   int i;
+
+   VIDSoftSetScrollKernels(kernels);
+
+   // Start both runs with the same cells already decoded
+   DrawFrame(&regs, 0);
+
+   ticks = YabauseGetTicks();
+   for (i = 0; i < frames; i++)
+      DrawFrame(&regs, i);
+   ticks = YabauseGetTicks() - ticks;
+
+   *sum = Checksum();
+   *Vdp2Regs = regs;
+   return ticks;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int RunState(const char *name, const char *kernel, int frames)
+{
+   u32 generic_sum, kernel_sum;
+   u64 generic_ticks = (u64)-1, kernel_ticks = (u64)-1;
+   u64 ticks;
+   int i;
+
+   // Alternate the two and keep the best of each, to even out the noise
+   for (i = 0; i < NUM_ROUNDS; i++)
+   {
+      if ((ticks = RunTest(0, frames, &generic_sum)) < generic_ticks)
+         generic_ticks = ticks;
+      if ((ticks = RunTest(1, frames, &kernel_sum)) < kernel_ticks)
+         kernel_ticks = ticks;
+   }
+
+   printf("%-24s %-8s %9.3f %9.3f %7.2fx  %s\n", name, kernel,
+          (double)generic_ticks * 1000 / yabsys.tickfreq / frames,
+          (double)kernel_ticks * 1000 / yabsys.tickfreq / frames,
+          kernel_ticks ? (double)generic_ticks / kernel_ticks : 0.0,
+          generic_sum == kernel_sum ? "match" : "DIFFER");
+
+   return generic_sum != kernel_sum;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+   yabauseinit_struct yinit;
+   int frames = 100;
+   int failed = 0;
+   int i;
+
+   if (argc >= 2 && (frames = atoi(argv[1])) <= 0)
+      ProgramUsage();
+
+   VideoDisableGL();
+
+   memset(&yinit, 0, sizeof(yinit));
+   yinit.vidcoretype = VIDCORE_SOFT;
+   yinit.osdcoretype = OSDCORE_DUMMY;
+   yinit.carttype = CART_NONE;
+   yinit.skip_load = 1;
+
+   if (YabauseInit(&yinit) != 0)
+   {
+      printf("Error initializing yabause\n");
+      return 1;
+   }
+
+   // Every frame has to be drawn for the timings to mean anything
+   VIDSoftSetSkipUnchanged(0);
+
+   printf("%d frames, ms per frame\n", frames);
+   printf("%-24s %-8s %9s %9s %8s\n", "state", "kernel", "generic", "kernel", "speedup");
+
+   FillRam();
+   for (i = 0; i < (int)(sizeof(states) / sizeof(states[0])); i++)
+   {
+      SetupState(&states[i]);
+      failed |= RunState(states[i].name, states[i].kernel, frames);
+   }
+
+   for (i = 2; i < argc; i++)
+   {
+      if (YabLoadState(argv[i]) != 0)
+      {
+         printf("%s: error loading save state\n", argv[i]);
+         failed = 1;
+         continue;
+      }
+      failed |= RunState(argv[i], "-", frames);
+   }
+
+   YabauseDeInit();
+
+   return failed;
+}
@@ -34,6 +34,7 @@
 #include "sh2core.h"
 
 u8 * Vdp1Ram;
+u32 Vdp1RamDirty[VDP1_RAM_PAGES / 32];
 u8 * Vdp1FrameBuffer;
 
 VideoInterface_struct *VIDCore=NULL;
@@ -66,6 +67,7 @@ u32 FASTCALL Vdp1RamReadLong(u32 addr) {
 void FASTCALL Vdp1RamWriteByte(u32 addr, u8 val) {
    addr &= 0x7FFFF;
    T1WriteByte(Vdp1Ram, addr, val);
+   VDP1_RAM_MARK_DIRTY(addr);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -73,6 +75,7 @@ void FASTCALL Vdp1RamWriteByte(u32 addr, u8 val) {
 void FASTCALL Vdp1RamWriteWord(u32 addr, u16 val) {
    addr &= 0x7FFFF;
    T1WriteWord(Vdp1Ram, addr, val);
+   VDP1_RAM_MARK_DIRTY(addr);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -80,6 +83,33 @@ void FASTCALL Vdp1RamWriteWord(u32 addr, u16 val) {
 void FASTCALL Vdp1RamWriteLong(u32 addr, u32 val) {
    addr &= 0x7FFFF;
    T1WriteLong(Vdp1Ram, addr, val);
+   VDP1_RAM_MARK_DIRTY(addr);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Vdp1RamMarkDirty(u32 addr, u32 size) {
+   u32 page, last;
+
+   if (size == 0)
+      return;
+
+   addr &= 0x7FFFF;
+   if (size >= 0x80000 - addr) {
+      // Wraps around or covers the rest of ram, don't bother being exact
+      Vdp1RamMarkAllDirty();
+      return;
+   }
+
+   last = (addr + size - 1) >> VDP1_RAM_PAGE_SHIFT;
+   for (page = addr >> VDP1_RAM_PAGE_SHIFT; page <= last; page++)
+      Vdp1RamDirty[page >> 5] |= 1U << (page & 31);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Vdp1RamMarkAllDirty(void) {
+   memset(Vdp1RamDirty, 0xFF, sizeof(Vdp1RamDirty));
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -245,6 +275,7 @@ int Vdp1Init(void) {
 
    if ((Vdp1Ram = T1MemoryInit(0x80000)) == NULL)
       return -1;
+   Vdp1RamMarkAllDirty();
 
    // Allocate enough memory for two frames
    if ((Vdp1FrameBuffer = T1MemoryInit(0x80000)) == NULL)
@@ -716,6 +747,7 @@ int Vdp1LoadState(const void * stream, UNUSED int version, int size)
 
    // Read VDP1 ram
    MemStateRead((void *)Vdp1Ram, 0x80000, 1, stream);
+   Vdp1RamMarkAllDirty();
 
 #ifdef IMPROVED_SAVESTATES
    MemStateRead((void *)back_framebuffer, 0x40000, 1, stream);
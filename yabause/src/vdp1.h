@@ -100,6 +100,21 @@ u32 FASTCALL	Vdp1RamReadLong(u32);
 void FASTCALL	Vdp1RamWriteByte(u32, u8);
 void FASTCALL	Vdp1RamWriteWord(u32, u16);
 void FASTCALL	Vdp1RamWriteLong(u32, u32);
+
+// VDP1 ram is tracked in 4KB pages; a set bit means the page was written
+// since the software renderer last checked its texture cache against it
+#define VDP1_RAM_PAGE_SHIFT 12
+#define VDP1_RAM_PAGES      (0x80000 >> VDP1_RAM_PAGE_SHIFT)
+
+extern u32 Vdp1RamDirty[VDP1_RAM_PAGES / 32];
+
+#define VDP1_RAM_MARK_DIRTY(addr) \
+   (Vdp1RamDirty[(addr) >> (VDP1_RAM_PAGE_SHIFT + 5)] |= \
+    1U << (((addr) >> VDP1_RAM_PAGE_SHIFT) & 31))
+
+void Vdp1RamMarkDirty(u32 addr, u32 size);
+void Vdp1RamMarkAllDirty(void);
+
 u8 FASTCALL Vdp1FrameBufferReadByte(u32);
 u16 FASTCALL Vdp1FrameBufferReadWord(u32);
 u32 FASTCALL Vdp1FrameBufferReadLong(u32);
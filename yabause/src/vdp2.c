@@ -35,7 +35,9 @@
 #include "osdcore.h"
 
 u8 * Vdp2Ram;
+u32 Vdp2RamDirty[VDP2_RAM_PAGES / 32];
 u8 * Vdp2ColorRam;
+u32 Vdp2ColorRamLut[0x800];
 Vdp2 * Vdp2Regs;
 Vdp2Internal_struct Vdp2Internal;
 Vdp2External_struct Vdp2External;
@@ -75,6 +77,7 @@ u32 FASTCALL Vdp2RamReadLong(u32 addr) {
 void FASTCALL Vdp2RamWriteByte(u32 addr, u8 val) {
    addr &= 0x7FFFF;
    T1WriteByte(Vdp2Ram, addr, val);
+   VDP2_RAM_MARK_DIRTY(addr);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -82,6 +85,7 @@ void FASTCALL Vdp2RamWriteByte(u32 addr, u8 val) {
 void FASTCALL Vdp2RamWriteWord(u32 addr, u16 val) {
    addr &= 0x7FFFF;
    T1WriteWord(Vdp2Ram, addr, val);
+   VDP2_RAM_MARK_DIRTY(addr);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -89,6 +93,66 @@ void FASTCALL Vdp2RamWriteWord(u32 addr, u16 val) {
 void FASTCALL Vdp2RamWriteLong(u32 addr, u32 val) {
    addr &= 0x7FFFF;
    T1WriteLong(Vdp2Ram, addr, val);
+   VDP2_RAM_MARK_DIRTY(addr);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Vdp2RamMarkDirty(u32 addr, u32 size) {
+   u32 page, last;
+
+   if (size == 0)
+      return;
+
+   addr &= 0x7FFFF;
+   if (size >= 0x80000 - addr) {
+      // Wraps around or covers the rest of ram, don't bother being exact
+      Vdp2RamMarkAllDirty();
+      return;
+   }
+
+   last = (addr + size - 1) >> VDP2_RAM_PAGE_SHIFT;
+   for (page = addr >> VDP2_RAM_PAGE_SHIFT; page <= last; page++)
+      Vdp2RamDirty[page >> 5] |= 1U << (page & 31);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Vdp2RamMarkAllDirty(void) {
+   memset(Vdp2RamDirty, 0xFF, sizeof(Vdp2RamDirty));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE void Vdp2ColorRamUpdateLut(u32 addr) {
+   u32 tmp;
+
+   switch (Vdp2Internal.ColorMode)
+   {
+      case 0:
+      case 1:
+         tmp = T2ReadWord(Vdp2ColorRam, addr & 0xFFE);
+         /* we preserve MSB for special color calculation mode 3 (see Vdp2 user's manual 3.4 and 12.3) */
+         Vdp2ColorRamLut[addr >> 1] = ((tmp & 0x1F) << 3) | ((tmp & 0x03E0) << 6) | ((tmp & 0x7C00) << 9) | ((tmp & 0x8000) << 16);
+         break;
+      case 2:
+         // 1024 colors, mirrored so that 11-bit color numbers still work
+         tmp = T2ReadLong(Vdp2ColorRam, addr & 0xFFC);
+         Vdp2ColorRamLut[(addr >> 2) & 0x3FF] = tmp;
+         Vdp2ColorRamLut[((addr >> 2) & 0x3FF) + 0x400] = tmp;
+         break;
+      default: break;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void Vdp2ColorRamRebuildLut(void) {
+   u32 addr;
+
+   memset(Vdp2ColorRamLut, 0, sizeof(Vdp2ColorRamLut));
+   for (addr = 0; addr < 0x1000; addr += 2)
+      Vdp2ColorRamUpdateLut(addr);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -117,6 +181,7 @@ u32 FASTCALL Vdp2ColorRamReadLong(u32 addr) {
 void FASTCALL Vdp2ColorRamWriteByte(u32 addr, u8 val) {
    addr &= 0xFFF;
    T2WriteByte(Vdp2ColorRam, addr, val);
+   Vdp2ColorRamUpdateLut(addr);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -124,6 +189,7 @@ void FASTCALL Vdp2ColorRamWriteByte(u32 addr, u8 val) {
 void FASTCALL Vdp2ColorRamWriteWord(u32 addr, u16 val) {
    addr &= 0xFFF;
    T2WriteWord(Vdp2ColorRam, addr, val);
+   Vdp2ColorRamUpdateLut(addr);
 //   if (Vdp2Internal.ColorMode == 0)
 //      T1WriteWord(Vdp2ColorRam, addr + 0x800, val);
 }
@@ -133,6 +199,8 @@ void FASTCALL Vdp2ColorRamWriteWord(u32 addr, u16 val) {
 void FASTCALL Vdp2ColorRamWriteLong(u32 addr, u32 val) {
    addr &= 0xFFF;
    T2WriteLong(Vdp2ColorRam, addr, val);
+   Vdp2ColorRamUpdateLut(addr);
+   Vdp2ColorRamUpdateLut((addr + 2) & 0xFFF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -215,6 +283,7 @@ int Vdp2Init(void) {
 
    if ((Vdp2Ram = T1MemoryInit(0x80000)) == NULL)
       return -1;
+   Vdp2RamMarkAllDirty();
 
    if ((Vdp2ColorRam = T2MemoryInit(0x1000)) == NULL)
       return -1;
@@ -321,6 +390,7 @@ void Vdp2Reset(void) {
 
    yabsys.VBlankLineCount = 225;
    Vdp2Internal.ColorMode = 0;
+   Vdp2ColorRamRebuildLut();
 
    Vdp2External.disptoggle = 0xFF;
 }
@@ -640,7 +710,11 @@ void FASTCALL Vdp2WriteWord(u32 addr, u16 val) {
          return;
       case 0x00E:
          Vdp2Regs->RAMCTL = val;
-         Vdp2Internal.ColorMode = (val >> 12) & 0x3;
+         if (Vdp2Internal.ColorMode != ((val >> 12) & 0x3))
+         {
+            Vdp2Internal.ColorMode = (val >> 12) & 0x3;
+            Vdp2ColorRamRebuildLut();
+         }
          return;
       case 0x010:
          Vdp2Regs->CYCA0L = val;
@@ -1135,12 +1209,14 @@ int Vdp2LoadState(const void * stream, UNUSED int version, int size)
 
    // Read VDP2 ram
    MemStateRead((void *)Vdp2Ram, 0x80000, 1, stream);
+   Vdp2RamMarkAllDirty();
 
    // Read CRAM
    MemStateRead((void *)Vdp2ColorRam, 0x1000, 1, stream);
 
    // Read internal variables
    MemStateRead((void *)&Vdp2Internal, sizeof(Vdp2Internal_struct), 1, stream);
+   Vdp2ColorRamRebuildLut();
 
    return size;
 }
@@ -35,6 +35,25 @@ void FASTCALL   Vdp2RamWriteByte(u32, u8);
 void FASTCALL   Vdp2RamWriteWord(u32, u16);
 void FASTCALL   Vdp2RamWriteLong(u32, u32);
 
+// VDP2 ram is tracked in 4KB pages; a set bit means the page was written
+// since the threaded renderer last took a copy of it
+#define VDP2_RAM_PAGE_SHIFT 12
+#define VDP2_RAM_PAGE_SIZE  (1 << VDP2_RAM_PAGE_SHIFT)
+#define VDP2_RAM_PAGES      (0x80000 >> VDP2_RAM_PAGE_SHIFT)
+
+extern u32 Vdp2RamDirty[VDP2_RAM_PAGES / 32];
+
+#define VDP2_RAM_MARK_DIRTY(addr) \
+   (Vdp2RamDirty[(addr) >> (VDP2_RAM_PAGE_SHIFT + 5)] |= \
+    1U << (((addr) >> VDP2_RAM_PAGE_SHIFT) & 31))
+
+void Vdp2RamMarkDirty(u32 addr, u32 size);
+void Vdp2RamMarkAllDirty(void);
+
+// Color RAM converted to host colors for the current color mode, one entry
+// per color number; kept up to date by the color RAM writes
+extern u32 Vdp2ColorRamLut[0x800];
+
 u8 FASTCALL     Vdp2ColorRamReadByte(u32);
 u16 FASTCALL    Vdp2ColorRamReadWord(u32);
 u32 FASTCALL    Vdp2ColorRamReadLong(u32);
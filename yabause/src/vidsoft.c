@@ -45,6 +45,12 @@
 #include <stdlib.h>
 #include <limits.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #if defined WORDS_BIGENDIAN
 static INLINE u32 COLSAT2YAB16(int priority,u32 temp)            { return (priority | (temp & 0x7C00) << 1 | (temp & 0x3E0) << 14 | (temp & 0x1F) << 27); }
 static INLINE u32 COLSAT2YAB32(int priority,u32 temp)            { return (((temp & 0xFF) << 24) | ((temp & 0xFF00) << 8) | ((temp & 0xFF0000) >> 8) | priority); }
@@ -71,6 +77,33 @@ static INLINE u32 COLSATSTRIPPRIORITY(u32 pixel) { return (0xFF000000 | pixel);
 				(l & 0xFF000000)
 #endif
 
+// 8x8 character cell as fetched by Vdp2FetchPixel, indexed by y * 8 + x.
+// Only the low bits of a dot are looked at once its color is known
+typedef struct
+{
+   u32 addr;
+   u32 key;
+   u32 gen;
+   u8 opaque[64];
+   u8 dot[64];
+   u32 color[64];
+} vidsoft_cell_struct;
+
+typedef struct
+{
+   vidsoft_cell_struct * cells;
+   u32 mask;
+} vidsoft_cell_cache_struct;
+
+// Screen lines [start, end) drawn by one layer draw call, and the cell
+// cache it may use without locking
+typedef struct
+{
+   int start;
+   int end;
+   vidsoft_cell_cache_struct * cell_cache;
+} vidsoft_band_struct;
+
 
 int VIDSoftInit(void);
 int VIDSoftSetupGL(void);
@@ -99,7 +132,7 @@ void VIDSoftVdp2SetResolution(u16 TVMD);
 void VIDSoftGetGlSize(int *width, int *height);
 void VIDSoftVdp1SwapFrameBuffer(void);
 void VIDSoftVdp1EraseFrameBuffer(Vdp1* regs, u8 * back_framebuffer);
-void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * sprite_window_mask, u8* vdp1_front_framebuffer, u8 * vdp2_ram, Vdp1* vdp1_regs, Vdp2* vdp2_lines, u8*color_ram);
+void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * sprite_window_mask, u8* vdp1_front_framebuffer, u8 * vdp2_ram, Vdp1* vdp1_regs, Vdp2* vdp2_lines, u32* color_ram, vidsoft_band_struct * band);
 void VIDSoftGetNativeResolution(int *width, int *height, int*interlace);
 void VIDSoftVdp2DispOff(void);
 
@@ -167,18 +200,166 @@ int vdp2_interlace = 0;
 static int rbg0height = 0;
 int bilinear = 0;
 int vidsoft_num_layer_threads = 0;
+static u32 vidsoft_snapshot_ram_bytes = 0;
+static u32 vidsoft_snapshot_total_bytes = 0;
 int bad_cycle_setting[6] = { 0 };
+static vidsoft_band_struct vidsoft_full_band = { 0, INT_MAX, NULL };
+
+// Bumped for every VDP2 ram page written and every color ram change, so
+// that a cached cell is only reused while its source data is unchanged
+static u32 vidsoft_cell_page_gen[VDP2_RAM_PAGES];
+static u32 vidsoft_cell_cram_gen = 0;
+static u8 vidsoft_cell_cram[0x1000];
+static int vidsoft_cell_color_mode = -1;
+
+// Everything the last composed frame was drawn from. A frame that starts
+// with all of it unchanged leaves the layers and Titan alone and shows
+// dispbuffer again as it is
+static struct
+{
+   int enabled;
+   int valid;
+   int unchanged_frames;
+   int skip_layers;
+   u32 skipped_frames;
+   u16 vdp1_tvmr;
+   int vdp1_disptoggle;
+   int vdp2_disptoggle;
+   Vdp2 regs;
+   Vdp2 end_regs;
+   Vdp2 lines[270];
+   struct CellScrollData cell_scroll_data[270];
+   u32 color_ram[0x800];
+   u8 vdp1_front_framebuffer[0x40000];
+} vidsoft_frame_check = { 1 };
 
+// A sprite texture decoded the way Vdp1ReadTexel reads it, one u32 per
+// dot: the dot's color, with bit 16 set for an end code
+typedef struct
+{
+   u32 addr;
+   u32 key;
+   u16 colr;
+   int width;
+   u32 serial; // when it was decoded, 0 if the entry is unused
+   u32 * texels;
+   u8 * rowendcodes;
+} vidsoft_vdp1_texture_struct;
+
+// A drawing command from the list, with the clipping and local coordinates
+// in effect when it is reached
+typedef struct
+{
+   u32 addr;
+   u16 command;
+   s16 localX;
+   s16 localY;
+   u16 systemclipX2;
+   u16 systemclipY2;
+   u16 userclipX1;
+   u16 userclipY1;
+   u16 userclipX2;
+   u16 userclipY2;
+   // A copy, a later lookup can hand its cache entry to another texture.
+   // texels is NULL when it wasn't cached
+   vidsoft_vdp1_texture_struct texture;
+} vidsoft_vdp1_command_struct;
+
+// Same limit as Vdp1DrawCommands
+#define VIDSOFT_MAX_VDP1_COMMANDS 2000
+
 struct VidsoftVdp1ThreadContext
 {
-   volatile int draw_finished;
-   volatile int need_draw;
+   YabCounter * done;
+   YabCounter * bands_done;
    Vdp1 regs;
    u8 ram[0x80000];
-   u8 back_framebuffer[0x40000];
+   // The back framebuffer itself, it's drawn to in place and nothing else
+   // touches it until the job is waited for
+   u8 * back_framebuffer;
+   vidsoft_vdp1_command_struct commands[VIDSOFT_MAX_VDP1_COMMANDS];
+   int num_commands;
 }vidsoft_vdp1_thread_context;
 
 int vidsoft_vdp1_thread_enabled = 0;
+static int vidsoft_num_vdp1_threads = 0;
+
+static void VidsoftVdp1DrawBands(void);
+
+// Decoded sprite textures. Entries are checked against the VDP1 ram pages
+// the texture (and lookup table) was read from, and the texel storage is
+// only reused between frames, so what a lookup returns stays put until the
+// frame is drawn
+#define VIDSOFT_VDP1_TEXTURES     4096
+#define VIDSOFT_VDP1_TEXEL_ARENA  (1 << 20)
+
+static struct
+{
+   vidsoft_vdp1_texture_struct entries[VIDSOFT_VDP1_TEXTURES];
+   u32 * arena;
+   u32 used;
+   u32 serial;
+   u32 page_serial[VDP1_RAM_PAGES];
+   u32 hits;
+   u32 misses;
+   u32 last_hits;
+   u32 last_misses;
+} vidsoft_vdp1_textures;
+
+// Called before each frame's command list is drawn, with no drawing going on
+static void VidsoftUpdateVdp1TextureCache(void)
+{
+   int bumped = 0;
+   int i, j;
+
+   vidsoft_vdp1_textures.last_hits = vidsoft_vdp1_textures.hits;
+   vidsoft_vdp1_textures.last_misses = vidsoft_vdp1_textures.misses;
+   vidsoft_vdp1_textures.hits = vidsoft_vdp1_textures.misses = 0;
+
+   for (i = 0; i < VDP1_RAM_PAGES / 32; i++)
+   {
+      u32 dirty = Vdp1RamDirty[i];
+
+      if (dirty == 0)
+         continue;
+
+      if (!bumped)
+      {
+         vidsoft_vdp1_textures.serial++;
+         bumped = 1;
+      }
+
+      for (j = 0; j < 32; j++)
+      {
+         if (dirty & (1U << j))
+            vidsoft_vdp1_textures.page_serial[(i << 5) + j] = vidsoft_vdp1_textures.serial;
+      }
+
+      Vdp1RamDirty[i] = 0;
+   }
+
+   // Start over once the storage is mostly used up
+   if (vidsoft_vdp1_textures.used > VIDSOFT_VDP1_TEXEL_ARENA / 4 * 3)
+   {
+      for (i = 0; i < VIDSOFT_VDP1_TEXTURES; i++)
+         vidsoft_vdp1_textures.entries[i].serial = 0;
+      vidsoft_vdp1_textures.used = 0;
+   }
+}
+
+static int VidsoftVdp1TexturePagesChanged(u32 addr, u32 size, u32 serial)
+{
+   u32 page = (addr & 0x7FFFF) >> VDP1_RAM_PAGE_SHIFT;
+   u32 last = ((addr & 0x7FFFF) + size - 1) >> VDP1_RAM_PAGE_SHIFT;
+
+   for (; page <= last; page++)
+   {
+      if (vidsoft_vdp1_textures.page_serial[page & (VDP1_RAM_PAGES - 1)] > serial)
+         return 1;
+   }
+
+   return 0;
+}
 
 typedef struct { s16 x; s16 y; } vdp1vertex;
 
@@ -196,35 +377,11 @@ typedef struct
 
 //////////////////////////////////////////////////////////////////////////////
 
-static INLINE u32 FASTCALL Vdp2ColorRamGetColor(u32 addr, u8* vdp2_color_ram)
+static INLINE u32 FASTCALL Vdp2ColorRamGetColor(u32 addr, u32* vdp2_color_ram)
 {
-   switch(Vdp2Internal.ColorMode)
-   {
-      case 0:
-      {
-         u32 tmp;
-         addr <<= 1;
-         tmp = T2ReadWord(vdp2_color_ram, addr & 0xFFF);
-         /* we preserve MSB for special color calculation mode 3 (see Vdp2 user's manual 3.4 and 12.3) */
-         return (((tmp & 0x1F) << 3) | ((tmp & 0x03E0) << 6) | ((tmp & 0x7C00) << 9)) | ((tmp & 0x8000) << 16);
-      }
-      case 1:
-      {
-         u32 tmp;
-         addr <<= 1;
-         tmp = T2ReadWord(vdp2_color_ram, addr & 0xFFF);
-         /* we preserve MSB for special color calculation mode 3 (see Vdp2 user's manual 3.4 and 12.3) */
-         return (((tmp & 0x1F) << 3) | ((tmp & 0x03E0) << 6) | ((tmp & 0x7C00) << 9)) | ((tmp & 0x8000) << 16);
-      }
-      case 2:
-      {
-         addr <<= 2;   
-         return T2ReadLong(vdp2_color_ram, addr & 0xFFF);
-      }
-      default: break;
-   }
-
-   return 0;
+   // vdp2_color_ram is Vdp2ColorRamLut or a copy of it, already converted
+   // for the current color mode
+   return vdp2_color_ram[addr & 0x7FF];
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -375,7 +532,7 @@ static INLINE void ReadVdp2ColorOffset(Vdp2 * regs, vdp2draw_struct *info, int c
 
 //////////////////////////////////////////////////////////////////////////////
 
-static INLINE int Vdp2FetchPixel(vdp2draw_struct *info, int x, int y, u32 *color, u32 *dot, u8 * ram, int charaddr, int paladdr, u8* vdp2_color_ram)
+static INLINE int Vdp2FetchPixel(vdp2draw_struct *info, int x, int y, u32 *color, u32 *dot, u8 * ram, int charaddr, int paladdr, u32* vdp2_color_ram)
 {
    switch(info->colornumber)
    {
@@ -427,6 +584,139 @@ static INLINE int Vdp2FetchPixel(vdp2draw_struct *info, int x, int y, u32 *color
 
 //////////////////////////////////////////////////////////////////////////////
 
+static vidsoft_cell_cache_struct * VidsoftCreateCellCache(u32 num_cells)
+{
+   vidsoft_cell_cache_struct * cache;
+
+   if ((cache = (vidsoft_cell_cache_struct *)calloc(1, sizeof(vidsoft_cell_cache_struct))) == NULL)
+      return NULL;
+
+   if ((cache->cells = (vidsoft_cell_struct *)malloc(num_cells * sizeof(vidsoft_cell_struct))) == NULL)
+   {
+      free(cache);
+      return NULL;
+   }
+
+   // Cell addresses are masked to VDP2 ram, so 0xFFFFFFFF never matches
+   memset(cache->cells, 0xFF, num_cells * sizeof(vidsoft_cell_struct));
+   cache->mask = num_cells - 1;
+   return cache;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void VidsoftFreeCellCache(vidsoft_cell_cache_struct * cache)
+{
+   if (cache == NULL)
+      return;
+
+   free(cache->cells);
+   free(cache);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void VidsoftDecodeCell(vdp2draw_struct *info, vidsoft_cell_struct *cell, u8 * ram, u32 addr, int paladdr, u32* vdp2_color_ram)
+{
+   int transparencyenable = info->transparencyenable;
+   int cellw = info->cellw;
+   int i;
+
+   info->transparencyenable = 0;
+   info->cellw = 8;
+
+   for (i = 0; i < 64; i++)
+   {
+      u32 dot = 0;
+
+      Vdp2FetchPixel(info, i & 7, i >> 3, &cell->color[i], &dot, ram, addr, paladdr, vdp2_color_ram);
+      cell->dot[i] = (u8)dot;
+
+      switch(info->colornumber)
+      {
+         case 0: cell->opaque[i] = (dot & 0xF) != 0; break;
+         case 1: cell->opaque[i] = (dot & 0xFF) != 0; break;
+         case 2: cell->opaque[i] = dot != 0; break;
+         case 3: cell->opaque[i] = (dot & 0x8000) != 0; break;
+         default: cell->opaque[i] = (dot & 0x80000000) != 0; break;
+      }
+   }
+
+   info->transparencyenable = transparencyenable;
+   info->cellw = cellw;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Returns the decoded 8x8 cell at the given cell row of a character
+// pattern, decoding it again only if its VDP2 or color ram has changed
+static vidsoft_cell_struct * VidsoftLookupCell(vdp2draw_struct *info, vidsoft_cell_cache_struct *cache, int row, u8 * ram, int charaddr, int paladdr, u32* vdp2_color_ram)
+{
+   static const u8 cell_size_bits[8] = { 5, 6, 7, 7, 8, 0, 0, 0 };
+   int size_bits = cell_size_bits[info->colornumber & 7];
+   u32 addr = (charaddr + (row << size_bits)) & 0x7FFFF;
+   u32 last = (addr + (1 << size_bits) - 1) & 0x7FFFF;
+   u32 key = info->colornumber;
+   u32 gen;
+   vidsoft_cell_struct * cell;
+
+   if (info->colornumber < 2)
+      key |= (info->coloroffset + paladdr) << 4;
+   else if (info->colornumber == 2)
+      key |= info->coloroffset << 4;
+
+   gen = vidsoft_cell_page_gen[addr >> VDP2_RAM_PAGE_SHIFT] +
+      vidsoft_cell_page_gen[last >> VDP2_RAM_PAGE_SHIFT] + vidsoft_cell_cram_gen;
+
+   cell = &cache->cells[((addr >> 5) ^ (addr >> 13) ^ (key >> 4)) & cache->mask];
+   if (cell->addr != addr || cell->key != key || cell->gen != gen)
+   {
+      VidsoftDecodeCell(info, cell, ram, addr, paladdr, vdp2_color_ram);
+      cell->addr = addr;
+      cell->key = key;
+      cell->gen = gen;
+   }
+
+   return cell;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Called before the layers are drawn. When the layer threads are used, the
+// snapshot copy clears the dirty flags after this instead
+static void VidsoftUpdateCellCache(int clear_dirty)
+{
+   int i;
+
+   for (i = 0; i < VDP2_RAM_PAGES / 32; i++)
+   {
+      u32 dirty = Vdp2RamDirty[i];
+      int j;
+
+      if (dirty == 0)
+         continue;
+
+      for (j = 0; j < 32; j++)
+      {
+         if (dirty & (1U << j))
+            vidsoft_cell_page_gen[(i << 5) + j]++;
+      }
+
+      if (clear_dirty)
+         Vdp2RamDirty[i] = 0;
+   }
+
+   if (vidsoft_cell_color_mode != Vdp2Internal.ColorMode ||
+      memcmp(vidsoft_cell_cram, Vdp2ColorRam, 0x1000))
+   {
+      memcpy(vidsoft_cell_cram, Vdp2ColorRam, 0x1000);
+      vidsoft_cell_color_mode = Vdp2Internal.ColorMode;
+      vidsoft_cell_cram_gen++;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 static INLINE int TestWindow(int wctl, int enablemask, int inoutmask, clipping_struct *clip, int x, int y)
 {
    if (wctl & enablemask) 
@@ -548,6 +838,65 @@ static INLINE int TestBothWindow(int wctl, clipping_struct *clip, int x, int y)
 
 //////////////////////////////////////////////////////////////////////////////
 
+// Sets mask[x] to TestBothWindow(wctl, clip, x, y) for the dots of line y and
+// returns how many of them pass. Unless the sprite window is involved the
+// result can only change at the window edges, so it is worked out once per
+// span and not once per dot.
+static int VidsoftWindowLine(int wctl, clipping_struct *clip, int y, int width, u8 * mask)
+{
+   int edges[6];
+   int num_edges = 0;
+   int count = 0;
+   int i, k;
+
+   if (wctl & 0x20)
+   {
+      for (i = 0; i < width; i++)
+      {
+         mask[i] = TestBothWindow(wctl, clip, i, y) ? 1 : 0;
+         count += mask[i];
+      }
+      return count;
+   }
+
+   edges[num_edges++] = clip[0].xstart;
+   edges[num_edges++] = clip[0].xend + 1;
+   edges[num_edges++] = clip[1].xstart;
+   edges[num_edges++] = clip[1].xend + 1;
+   edges[num_edges++] = width;
+
+   // Sorted list of span starts, the first span always starts at 0
+   for (i = 0; i < num_edges; i++)
+   {
+      int edge = edges[i];
+
+      if (edge < 0)
+         edge = 0;
+      else if (edge > width)
+         edge = width;
+
+      for (k = i; k > 0 && edges[k - 1] > edge; k--)
+         edges[k] = edges[k - 1];
+      edges[k] = edge;
+   }
+
+   for (i = 0, k = 0; k < num_edges; k++)
+   {
+      if (edges[k] > i)
+      {
+         int visible = TestBothWindow(wctl, clip, i, y) ? 1 : 0;
+
+         memset(mask + i, visible, edges[k] - i);
+         count += visible * (edges[k] - i);
+         i = edges[k];
+      }
+   }
+
+   return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 static INLINE void GeneratePlaneAddrTable(vdp2draw_struct *info, u32 *planetbl, void FASTCALL (* PlaneAddr)(void *, int, Vdp2* ), Vdp2* regs)
 {
    int i;
@@ -819,7 +1168,169 @@ void Vdp2GetInterlaceInfo(int * start_line, int * line_increment)
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+// Per-line state handed to the specialized scroll kernels below
+typedef struct
+{
+   vdp2draw_struct * info;
+   screeninfo_struct * sinfo;
+   Vdp2 * regs;
+   u8 * ram;
+   u32 * color_ram;
+   vidsoft_cell_cache_struct * cell_cache;
+   u8 * window_mask;
+   u8 * colorcalc_mask;
+   int * mosaic_x;
+   int linescrollx;
+   int y;
+   int output_y;
+} vidsoft_scroll_line_struct;
+
+typedef void (*VidsoftScrollKernel)(vidsoft_scroll_line_struct * line);
+
+// Set to 0 to always use the generic dot loop in Vdp2DrawScroll
+static int vidsoft_scroll_kernels = 1;
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Draws one line of a cell (non-bitmap) scroll screen from the cell cache.
+// The flags are compile time constants so each kernel only keeps the work
+// its case needs:
+//    Z = x zoom or mosaic (otherwise x steps by exactly one dot)
+//    O = color offset
+//    P = per-dot special priority
+#define DEFINE_SCROLL_KERNEL(tag,Z,O,P)                                      \
+static void VidsoftScrollKernel_##tag(vidsoft_scroll_line_struct * line)     \
+{                                                                            \
+   vdp2draw_struct * info = line->info;                                      \
+   const u8 * window_mask = line->window_mask;                               \
+   const u8 * colorcalc_mask = line->colorcalc_mask;                         \
+   const int xmask = line->sinfo->xmask;                                     \
+   const int linescrollx = line->linescrollx;                                \
+   const int transparencyenable = info->transparencyenable;                  \
+   vidsoft_cell_struct * cell = NULL;                                        \
+   int cell_x = -1, cell_row = 0, cell_flip = 0;                             \
+   int i;                                                                    \
+                                                                             \
+   for (i = 0; i < vdp2width; i++)                                           \
+   {                                                                         \
+      int x, index, priority;                                                \
+      u32 color, dot;                                                        \
+      u8 alpha;                                                              \
+                                                                             \
+      if (!window_mask[i])                                                   \
+         continue;                                                           \
+                                                                             \
+      if (Z)                                                                 \
+         x = info->x + line->mosaic_x[i] * info->coordincx;                  \
+      else                                                                   \
+         x = info->x + i;                                                    \
+      x &= xmask;                                                            \
+      if (linescrollx)                                                       \
+      {                                                                      \
+         x += linescrollx;                                                   \
+         x &= 0x3FF;                                                         \
+      }                                                                      \
+                                                                             \
+      if ((x >> 3) != cell_x)                                                \
+      {                                                                      \
+         int cellx = x;                                                      \
+         int y = line->y;                                                    \
+                                                                             \
+         Vdp2MapCalcXY(info, &cellx, &y, line->sinfo, line->regs, line->ram, 0); \
+         cell = VidsoftLookupCell(info, line->cell_cache, y >> 3, line->ram, info->charaddr, info->paladdr, line->color_ram); \
+         cell_x = x >> 3;                                                    \
+         cell_row = (y & 7) << 3;                                            \
+         cell_flip = (cellx ^ x) & 7;                                        \
+      }                                                                      \
+                                                                             \
+      index = cell_row | ((x & 7) ^ cell_flip);                              \
+      if (!cell->opaque[index] && transparencyenable)                        \
+         continue;                                                           \
+      dot = cell->dot[index];                                                \
+      color = cell->color[index];                                            \
+                                                                             \
+      priority = info->priority;                                             \
+      if (P)                                                                 \
+      {                                                                      \
+         priority &= 0xE;                                                    \
+         if ((info->specialfunction & 1) && PixelIsSpecialPriority(info->specialcode, dot)) \
+            priority |= 1;                                                   \
+      }                                                                      \
+                                                                             \
+      if (!colorcalc_mask[i])                                                \
+         alpha = 0x3F;                                                       \
+      else                                                                   \
+         alpha = GetAlpha(info, color, dot);                                 \
+                                                                             \
+      color = COLSAT2YAB32(alpha, color);                                    \
+      if (O)                                                                 \
+         color = COLOR_ADD(color, info->cor, info->cog, info->cob);          \
+      TitanPutPixel(priority, i, line->output_y, color, info->linescreen, info); \
+   }                                                                         \
+}
+
+// Named after the flags, uppercase when the flag is set
+DEFINE_SCROLL_KERNEL(zop, 0,0,0)
+DEFINE_SCROLL_KERNEL(zoP, 0,0,1)
+DEFINE_SCROLL_KERNEL(zOp, 0,1,0)
+DEFINE_SCROLL_KERNEL(zOP, 0,1,1)
+DEFINE_SCROLL_KERNEL(Zop, 1,0,0)
+DEFINE_SCROLL_KERNEL(ZoP, 1,0,1)
+DEFINE_SCROLL_KERNEL(ZOp, 1,1,0)
+DEFINE_SCROLL_KERNEL(ZOP, 1,1,1)
+
+#undef DEFINE_SCROLL_KERNEL
+
+// vidsoft_scroll_kernel_table[Z][O][P]
+static const VidsoftScrollKernel vidsoft_scroll_kernel_table[2][2][2] = {
+   {
+      { VidsoftScrollKernel_zop, VidsoftScrollKernel_zoP },
+      { VidsoftScrollKernel_zOp, VidsoftScrollKernel_zOP }
+   },
+   {
+      { VidsoftScrollKernel_Zop, VidsoftScrollKernel_ZoP },
+      { VidsoftScrollKernel_ZOp, VidsoftScrollKernel_ZOP }
+   }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Picks the kernel for the current line parameters, or NULL if the line has
+// to go through the generic dot loop
+static VidsoftScrollKernel VidsoftSelectScrollKernel(vdp2draw_struct * info, vidsoft_cell_cache_struct * cell_cache)
+{
+   int zoom;
+
+   if (!vidsoft_scroll_kernels || cell_cache == NULL)
+      return NULL;
+
+   zoom = info->mosaicxmask > 1 || info->coordincx != 1.0f;
+   return vidsoft_scroll_kernel_table[zoom]
+                                     [info->PostPixelFetchCalc == &DoColorOffset]
+                                     [info->specialprimode == 2];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Dot or line i of a mosaic of size m + 1 is drawn from mosaic_table[m][i].
+// Filled by VIDSoftInit, before any band can read it.
+static int vidsoft_mosaic_table[16][1024];
+
+static void VidsoftInitMosaicTable(void)
+{
+   int i, j;
+
+   for (i = 0; i < 16; i++)
+   {
+      int m = i + 1;
+      for (j = 0; j < 1024; j++)
+         vidsoft_mosaic_table[i][j] = j / m * m;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_band_struct * band)
 {
    int i, j;
    int x, y;
@@ -827,6 +1338,13 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
    u32 linewnd0addr, linewnd1addr;
    u32 line_window_base[2] = { 0 };
    screeninfo_struct sinfo;
+   vidsoft_cell_cache_struct * cell_cache = NULL;
+   vidsoft_cell_struct * cell = NULL;
+   int cell_x = -1, cell_row = 0, cell_flip = 0;
+   u8 window_mask[704];
+   u8 colorcalc_mask[704];
+   vidsoft_scroll_line_struct line;
+   VidsoftScrollKernel kernel;
    int scrolly;
    int *mosaic_y, *mosaic_x;
    clipping_struct colorcalcwindow[2];
@@ -852,25 +1370,26 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
    line_window_base[1] = linewnd1addr;
    /* color calculation window: in => no color calc, out => color calc */
    ReadWindowData(regs->WCTLD >> 8, colorcalcwindow, regs);
-   {
-	   static int tables_initialized = 0;
-	   static int mosaic_table[16][1024];
-	   if(!tables_initialized)
-	   {
-		   tables_initialized = 1;
-			for(i=0;i<16;i++)
-			{
-				int m = i+1;
-				for(j=0;j<1024;j++)
-					mosaic_table[i][j] = j/m*m;
-			}
-	   }
-	   mosaic_x = mosaic_table[info->mosaicxmask-1];
-	   mosaic_y = mosaic_table[info->mosaicymask-1];
-   }
+   mosaic_x = vidsoft_mosaic_table[info->mosaicxmask-1];
+   mosaic_y = vidsoft_mosaic_table[info->mosaicymask-1];
 
    Vdp2GetInterlaceInfo(&start_line, &line_increment);
 
+   // The bad cycle pipeline may change the character between two dots of
+   // the same cell
+   if (!info->isbitmap && !bad_cycle && info->colornumber <= 4)
+      cell_cache = band->cell_cache;
+
+   line.info = info;
+   line.sinfo = &sinfo;
+   line.regs = regs;
+   line.ram = ram;
+   line.color_ram = color_ram;
+   line.cell_cache = cell_cache;
+   line.window_mask = window_mask;
+   line.colorcalc_mask = colorcalc_mask;
+   line.mosaic_x = mosaic_x;
+
    if (regs->SCRCTL & 1)
       num_vertical_cell_scroll_enabled++;
    if (regs->SCRCTL & 0x100)
@@ -915,6 +1434,10 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
    {
       int Y;
       int linescrollx = 0;
+
+      if (j >= band->end)
+         break;
+
       // precalculate the coordinate for the line(it's faster) and do line
       // scroll
       if (info->islinescroll)
@@ -995,6 +1518,32 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
       if (!info->enable)
          continue;
 
+      // Lines above the band still have to go through the per-line setup
+      if (j < band->start)
+      {
+         output_y++;
+         continue;
+      }
+
+      // Nothing to draw if the whole line is clipped
+      if (VidsoftWindowLine(info->wctl, clip, j, vdp2width, window_mask) == 0)
+      {
+         output_y++;
+         continue;
+      }
+      VidsoftWindowLine(regs->WCTLD >> 8, colorcalcwindow, j, vdp2width, colorcalc_mask);
+
+      if ((kernel = VidsoftSelectScrollKernel(info, cell_cache)) != NULL)
+      {
+         line.linescrollx = linescrollx;
+         line.y = Y;
+         line.output_y = output_y++;
+         kernel(&line);
+         continue;
+      }
+
+      cell_x = -1;
+
       for (i = 0; i < vdp2width; i++)
       {
          u32 color, dot;
@@ -1004,7 +1553,7 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
 			int priority;
 
          // See if screen position is clipped, if it isn't, continue
-         if (!TestBothWindow(info->wctl, clip, i, j))
+         if (!window_mask[i])
          {
             continue;
          }
@@ -1019,27 +1568,53 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
          }
 
          // Fetch Pixel, if it isn't transparent, continue
-         if (!info->isbitmap)
+         if (cell_cache)
          {
-            // Tile
-            y=Y;
-            Vdp2MapCalcXY(info, &x, &y, &sinfo, regs, ram, bad_cycle);
-         }
+            int index;
 
-         if (!bad_cycle)
-         {
-            charaddr = info->charaddr;
-            paladdr = info->paladdr;
+            // The rest of a cell's row comes straight from the cached cell
+            if ((x >> 3) != cell_x)
+            {
+               int cellx = x;
+
+               y = Y;
+               Vdp2MapCalcXY(info, &cellx, &y, &sinfo, regs, ram, 0);
+               cell = VidsoftLookupCell(info, cell_cache, y >> 3, ram, info->charaddr, info->paladdr, color_ram);
+               cell_x = x >> 3;
+               cell_row = (y & 7) << 3;
+               cell_flip = (cellx ^ x) & 7;
+            }
+
+            index = cell_row | ((x & 7) ^ cell_flip);
+            dot = cell->dot[index];
+            if (!cell->opaque[index] && info->transparencyenable)
+               continue;
+            color = cell->color[index];
          }
          else
          {
-            charaddr = info->pipe[0].charaddr;
-            paladdr = info->pipe[0].paladdr;
-         }
+            if (!info->isbitmap)
+            {
+               // Tile
+               y=Y;
+               Vdp2MapCalcXY(info, &x, &y, &sinfo, regs, ram, bad_cycle);
+            }
 
-         if (!Vdp2FetchPixel(info, x, y, &color, &dot, ram, charaddr, paladdr,color_ram))
-         {
-            continue;
+            if (!bad_cycle)
+            {
+               charaddr = info->charaddr;
+               paladdr = info->paladdr;
+            }
+            else
+            {
+               charaddr = info->pipe[0].charaddr;
+               paladdr = info->pipe[0].paladdr;
+            }
+
+            if (!Vdp2FetchPixel(info, x, y, &color, &dot, ram, charaddr, paladdr,color_ram))
+            {
+               continue;
+            }
          }
 
          priority = info->priority;
@@ -1066,7 +1641,7 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
          {
             u8 alpha;
             /* if we're in the valid area of the color calculation window, don't do color calculation */
-            if (!TestBothWindow(regs->WCTLD >> 8, colorcalcwindow, i, j))
+            if (!colorcalc_mask[i])
                alpha = 0x3F;
             else
                alpha = GetAlpha(info, color, dot);
@@ -1080,24 +1655,17 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
 
 //////////////////////////////////////////////////////////////////////////////
 
-void Rbg0PutHiresPixel(vdp2draw_struct *info, u32 color, u32 dot, int i, int j)
+static INLINE void Rbg0PutPixel(vdp2draw_struct *info, u32 color, u32 dot, int i, int j)
 {
    u32 pixel = info->PostPixelFetchCalc(info, COLSAT2YAB32(GetAlpha(info, color, dot), color));
-   int x_pos = i * 2;
-   TitanPutPixel(info->priority, x_pos, j, pixel, info->linescreen, info);
-   TitanPutPixel(info->priority, x_pos + 1, j, pixel, info->linescreen, info);
-}
 
-//////////////////////////////////////////////////////////////////////////////
-
-void Rbg0PutPixel(vdp2draw_struct *info, u32 color, u32 dot, int i, int j)
-{
    if (vdp2_x_hires)
    {
-      Rbg0PutHiresPixel(info, color, dot, i, j);
+      TitanPutPixel(info->priority, i * 2, j, pixel, info->linescreen, info);
+      TitanPutPixel(info->priority, i * 2 + 1, j, pixel, info->linescreen, info);
    }
    else
-      TitanPutPixel(info->priority, i, j, info->PostPixelFetchCalc(info, COLSAT2YAB32(GetAlpha(info, color, dot), color)), info->linescreen, info);
+      TitanPutPixel(info->priority, i, j, pixel, info->linescreen, info);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1129,9 +1697,55 @@ int Rbg0CheckRam(Vdp2* regs)
    return 0;
 }
 
-static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparameterfp_struct *parameter, Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+//////////////////////////////////////////////////////////////////////////////
+
+// Generates the screen coordinates of a whole line for parameters that don't
+// change within it, giving the same values as GenerateRotatedXPosFP and
+// GenerateRotatedYPosFP. kx * (Xsp + dX * dot) is stepped as a 64-bit value,
+// which is exact as long as Xsp + dX * dot itself doesn't wrap.
+static void Vdp2GenerateRotatedLineFP(vdp2rotationparameterfp_struct *p, fixed32 xmul, fixed32 ymul, fixed32 C, fixed32 F, int width, u16 *xpos, u16 *ypos)
+{
+   fixed32 Xsp = mulfixed(p->A, xmul) + mulfixed(p->B, ymul) + C;
+   fixed32 Ysp = mulfixed(p->D, xmul) + mulfixed(p->E, ymul) + F;
+   s64 lastx = (s64)Xsp + (s64)p->dX * (width - 1);
+   s64 lasty = (s64)Ysp + (s64)p->dY * (width - 1);
+   int i;
+
+   if (lastx == (fixed32)lastx && lasty == (fixed32)lasty)
+   {
+      s64 kx = (s64)p->kx * Xsp;
+      s64 ky = (s64)p->ky * Ysp;
+      s64 kdx = (s64)p->kx * p->dX;
+      s64 kdy = (s64)p->ky * p->dY;
+      fixed32 Xp = p->Xp;
+      fixed32 Yp = p->Yp;
+
+      for (i = 0; i < width; i++)
+      {
+         xpos[i] = touint((fixed32)(kx >> FP_SIZE) + Xp);
+         ypos[i] = touint((fixed32)(ky >> FP_SIZE) + Yp);
+         kx += kdx;
+         ky += kdy;
+      }
+   }
+   else
+   {
+      for (i = 0; i < width; i++)
+      {
+         xpos[i] = GenerateRotatedXPosFP(p, i, xmul, ymul, C);
+         ypos[i] = GenerateRotatedYPosFP(p, i, xmul, ymul, F);
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparameterfp_struct *parameter, Vdp2* lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_band_struct * band)
 {
    int i, j;
+   int line_width;
+   u8 window_mask[704];
+   u16 xpos[704], ypos[704];
    int x, y;
    screeninfo_struct sinfo;
    vdp2rotationparameterfp_struct *p=&parameter[info->rotatenum];
@@ -1168,20 +1782,27 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
 
          SetupScreenVars(info, &sinfo, info->PlaneAddr, regs);
 
-         for (j = 0; j < vdp2height; j++)
+         for (j = 0; j < vdp2height && j < band->end; j++)
          {
             info->LoadLineParams(info, &sinfo, j, lines);
             ReadLineWindowClip(info->islinewindow, clip, &linewnd0addr, &linewnd1addr, ram, regs);
 
-            for (i = 0; i < rbg0width; i++)
+            // Lines above the band only advance the rotation values
+            line_width = (j < band->start) ? 0 : rbg0width;
+            if (line_width && VidsoftWindowLine(info->wctl, clip, j, line_width, window_mask) == 0)
+               line_width = 0;
+
+            Vdp2GenerateRotatedLineFP(p, xmul, ymul, C, F, line_width, xpos, ypos);
+
+            for (i = 0; i < line_width; i++)
             {
                u32 color, dot;
 
-               if (!TestBothWindow(info->wctl, clip, i, j))
+               if (!window_mask[i])
                   continue;
 
-               x = GenerateRotatedXPosFP(p, i, xmul, ymul, C) & sinfo.xmask;
-               y = GenerateRotatedYPosFP(p, i, xmul, ymul, F) & sinfo.ymask;
+               x = xpos[i] & sinfo.xmask;
+               y = ypos[i] & sinfo.ymask;
 
                // Convert coordinates into graphics
                if (!info->isbitmap)
@@ -1218,8 +1839,11 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
       u32 rcoefx2, rcoefy2;
       screeninfo_struct sinfo2;
       vdp2rotationparameterfp_struct *p2 = NULL;
+      u16 xpos2[704], ypos2[704];
+      int per_dot;
 
       clipping_struct rpwindow[2];
+      u8 rpwindow_mask[704];
       int userpwindow = 0;
       int isrplinewindow = 0;
       u32 rplinewnd0addr, rplinewnd1addr;
@@ -1268,6 +1892,10 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
          }
       }
 
+      // With a coefficient per dot kx, ky and Xp change along the line, so
+      // the coordinates have to be worked out for each dot
+      per_dot = p->deltaKAx != 0 || (p2 != NULL && p2->coefenab && p2->deltaKAx != 0);
+
       if (info->linescreen)
       {
          if ((info->rotatenum == 0) && (regs->KTCTL & 0x10))
@@ -1282,7 +1910,7 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
          lineInc = regs->LCTA.part.U & 0x8000 ? 2 : 0;
       }
 
-      for (j = 0; j < rbg0height; j++)
+      for (j = 0; j < rbg0height && j < band->end; j++)
       {
          if (p->deltaKAx == 0)
          {
@@ -1304,7 +1932,8 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
             lineColorAddr = (T1ReadWord(ram, lineAddr) & 0x780) | p->linescreen;
             lineColor = Vdp2ColorRamGetColor(lineColorAddr, color_ram);
             lineAddr += lineInc;
-            TitanPutLineHLine(info->linescreen, j, COLSAT2YAB32(0x3F, lineColor));
+            if (j >= band->start)
+               TitanPutLineHLine(info->linescreen, j, COLSAT2YAB32(0x3F, lineColor));
          }
 
          info->LoadLineParams(info, &sinfo, j, lines);
@@ -1313,18 +1942,45 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
          if (userpwindow)
             ReadLineWindowClip(isrplinewindow, rpwindow, &rplinewnd0addr, &rplinewnd1addr, ram, regs);
 
-         for (i = 0; i < rbg0width; i++)
+         if (j < band->start)
          {
-            u32 color, dot;
-
-            if (p->deltaKAx != 0)
-            {
+            // Lines above the band are skipped, but the coefficient read
+            // for their last dot is still the one the next line starts with
+            line_width = 0;
+            if (p->deltaKAx != 0 && rbg0width > 0)
                Vdp2ReadCoefficientFP(p,
                                      p->coeftbladdr +
-                                     (coefy + coefx + toint(rcoefx + rcoefy)) *
+                                     (coefy + (rbg0width - 1) * toint(p->deltaKAx) +
+                                      toint((rbg0width - 1) * decipart(p->deltaKAx) + rcoefy)) *
                                      p->coefdatasize, ram);
-               coefx += toint(p->deltaKAx);
-               rcoefx += decipart(p->deltaKAx);
+         }
+         else
+         {
+            line_width = rbg0width;
+            VidsoftWindowLine(info->wctl, clip, j, line_width, window_mask);
+            if (userpwindow)
+               VidsoftWindowLine(regs->WCTLD, rpwindow, j, line_width, rpwindow_mask);
+
+            if (!per_dot)
+            {
+               Vdp2GenerateRotatedLineFP(p, xmul, ymul, C, F, line_width, xpos, ypos);
+               if (p2 != NULL)
+                  Vdp2GenerateRotatedLineFP(p2, xmul2, ymul2, C2, F2, line_width, xpos2, ypos2);
+            }
+         }
+
+         for (i = 0; i < line_width; i++)
+         {
+            u32 color, dot;
+
+            if (p->deltaKAx != 0)
+            {
+               Vdp2ReadCoefficientFP(p,
+                                     p->coeftbladdr +
+                                     (coefy + coefx + toint(rcoefx + rcoefy)) *
+                                     p->coefdatasize, ram);
+               coefx += toint(p->deltaKAx);
+               rcoefx += decipart(p->deltaKAx);
             }
             if ((p2 != NULL) && p2->coefenab && (p2->deltaKAx != 0))
             {
@@ -1336,15 +1992,23 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
                rcoefx2 += decipart(p2->deltaKAx);
             }
 
-            if (!TestBothWindow(info->wctl, clip, i, j))
+            if (!window_mask[i])
                continue;
 
-            if (((! userpwindow) && p->msb) || (userpwindow && (! TestBothWindow(regs->WCTLD, rpwindow, i, j))))
+            if (((! userpwindow) && p->msb) || (userpwindow && (! rpwindow_mask[i])))
             {
                if ((p2 == NULL) || (p2->coefenab && p2->msb)) continue;
 
-               x = GenerateRotatedXPosFP(p2, i, xmul2, ymul2, C2);
-               y = GenerateRotatedYPosFP(p2, i, xmul2, ymul2, F2);
+               if (per_dot)
+               {
+                  x = GenerateRotatedXPosFP(p2, i, xmul2, ymul2, C2);
+                  y = GenerateRotatedYPosFP(p2, i, xmul2, ymul2, F2);
+               }
+               else
+               {
+                  x = xpos2[i];
+                  y = ypos2[i];
+               }
 
                switch(p2->screenover) {
                   case 0:
@@ -1373,8 +2037,16 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
             else if (p->msb) continue;
             else
             {
-               x = GenerateRotatedXPosFP(p, i, xmul, ymul, C);
-               y = GenerateRotatedYPosFP(p, i, xmul, ymul, F);
+               if (per_dot)
+               {
+                  x = GenerateRotatedXPosFP(p, i, xmul, ymul, C);
+                  y = GenerateRotatedYPosFP(p, i, xmul, ymul, F);
+               }
+               else
+               {
+                  x = xpos[i];
+                  y = ypos[i];
+               }
 
                switch(p->screenover) {
                   case 0:
@@ -1432,7 +2104,7 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
       return;
    }
 
-   Vdp2DrawScroll(info, lines, regs, ram, color_ram, cell_data);
+   Vdp2DrawScroll(info, lines, regs, ram, color_ram, cell_data, band);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1511,7 +2183,7 @@ static void Vdp2DrawLineScreen(void)
       for (i = 0; i < vdp2height; i++)
       {
          color = T1ReadWord(Vdp2Ram, scrAddr) & 0x7FF;
-         dot = Vdp2ColorRamGetColor(color, Vdp2ColorRam);
+         dot = Vdp2ColorRamGetColor(color, Vdp2ColorRamLut);
          scrAddr += 2;
 
          TitanPutLineHLine(1, i, COLSAT2YAB32(alpha, dot));
@@ -1521,7 +2193,7 @@ static void Vdp2DrawLineScreen(void)
    {
       /* single color, implemented but not tested... */
       color = T1ReadWord(Vdp2Ram, scrAddr) & 0x7FF;
-      dot = Vdp2ColorRamGetColor(color, Vdp2ColorRam);
+      dot = Vdp2ColorRamGetColor(color, Vdp2ColorRamLut);
       for (i = 0; i < vdp2height; i++)
          TitanPutLineHLine(1, i, COLSAT2YAB32(alpha, dot));
    }
@@ -1543,7 +2215,7 @@ static void LoadLineParamsNBG0(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawNBG0(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawNBG0(Vdp2* lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_band_struct * band)
 {
    vdp2draw_struct info = { 0 };
    vdp2rotationparameterfp_struct parameter[2];
@@ -1668,12 +2340,12 @@ static void Vdp2DrawNBG0(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
    if (info.enable == 1)
    {
       // NBG0 draw
-      Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data);
+      Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data, band);
    }
    else
    {
       // RBG1 draw
-      Vdp2DrawRotationFP(&info, parameter, lines, regs, ram, color_ram, cell_data);
+      Vdp2DrawRotationFP(&info, parameter, lines, regs, ram, color_ram, cell_data, band);
    }
 }
 
@@ -1693,7 +2365,7 @@ static void LoadLineParamsNBG1(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawNBG1(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawNBG1(Vdp2* lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_band_struct * band)
 {
    vdp2draw_struct info = { 0 };
 
@@ -1780,7 +2452,7 @@ static void Vdp2DrawNBG1(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
 
    info.LoadLineParams = (void(*)(void *, void*, int, Vdp2*)) LoadLineParamsNBG1;
 
-   Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data);
+   Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data, band);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1799,7 +2471,7 @@ static void LoadLineParamsNBG2(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawNBG2(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawNBG2(Vdp2* lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_band_struct * band)
 {
    vdp2draw_struct info = { 0 };
 
@@ -1852,7 +2524,7 @@ static void Vdp2DrawNBG2(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
 
    info.LoadLineParams = (void(*)(void *,void*, int, Vdp2*)) LoadLineParamsNBG2;
 
-   Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data);
+   Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data, band);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1871,7 +2543,7 @@ static void LoadLineParamsNBG3(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawNBG3(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawNBG3(Vdp2* lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_band_struct * band)
 {
    vdp2draw_struct info = { 0 };
 
@@ -1926,7 +2598,7 @@ static void Vdp2DrawNBG3(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
 
    info.LoadLineParams = (void(*)(void *, void*, int, Vdp2*)) LoadLineParamsNBG3;
 
-   Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data);
+   Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data, band);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1943,7 +2615,7 @@ static void LoadLineParamsRBG0(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawRBG0(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawRBG0(Vdp2* lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_band_struct * band)
 {
    vdp2draw_struct info = { 0 };
    vdp2rotationparameterfp_struct parameter[2];
@@ -2050,7 +2722,7 @@ static void Vdp2DrawRBG0(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
 
    info.LoadLineParams = (void(*)(void *, void*, int, Vdp2*)) LoadLineParamsRBG0;
 
-   Vdp2DrawRotationFP(&info, parameter, lines, regs, ram, color_ram, cell_data);
+   Vdp2DrawRotationFP(&info, parameter, lines, regs, ram, color_ram, cell_data, band);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -2067,68 +2739,137 @@ static void LoadLineParamsSprite(vdp2draw_struct * info, int line, Vdp2* lines)
 //////////////////////////////////////////////////////////////////////////////
 
 struct {
-   volatile int need_draw[6];
-   volatile int draw_finished[6];
+   YabCounter * done;
    Vdp2 lines[270];
    Vdp2 regs;
    u8 ram[0x80000];
-   u8 color_ram[0x1000];
+   u32 color_ram[0x800];
    struct CellScrollData cell_scroll_data[270];
 }vidsoft_thread_context;
 
-#define DECLARE_THREAD(NAME, LAYER, FUNC) \
-void NAME(void * data) \
-{ \
-   for (;;) \
-   { \
-      if (vidsoft_thread_context.need_draw[LAYER]) \
-      { \
-         vidsoft_thread_context.need_draw[LAYER] = 0; \
-         FUNC(vidsoft_thread_context.lines, &vidsoft_thread_context.regs, vidsoft_thread_context.ram, vidsoft_thread_context.color_ram, vidsoft_thread_context.cell_scroll_data); \
-         vidsoft_thread_context.draw_finished[LAYER] = 1; \
-      } \
-      YabThreadSleep(); \
-   } \
-}
-
-DECLARE_THREAD(VidsoftRbg0Thread, TITAN_RBG0, Vdp2DrawRBG0)
-DECLARE_THREAD(VidsoftNbg0Thread, TITAN_NBG0, Vdp2DrawNBG0)
-DECLARE_THREAD(VidsoftNbg1Thread, TITAN_NBG1, Vdp2DrawNBG1)
-DECLARE_THREAD(VidsoftNbg2Thread, TITAN_NBG2, Vdp2DrawNBG2)
-DECLARE_THREAD(VidsoftNbg3Thread, TITAN_NBG3, Vdp2DrawNBG3)
+typedef void (*VidsoftLayerFunc)(Vdp2* lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_band_struct * band);
+
+// Each layer is split into horizontal bands of screen lines, all queued at
+// once. Whichever worker is free takes the next band, so one heavy layer
+// (usually RBG0) no longer keeps a single thread busy while the others idle.
+#define VIDSOFT_MAX_BANDS 8
+#define VIDSOFT_MIN_BAND_HEIGHT 16
+
+typedef struct
+{
+   VidsoftLayerFunc layer_func; // NULL for the sprite layer
+   vidsoft_band_struct band;
+} vidsoft_band_job_struct;
+
+static vidsoft_band_job_struct vidsoft_band_jobs[6 * VIDSOFT_MAX_BANDS];
+static int vidsoft_num_band_jobs = 0;
+
+static void VidsoftBandJob(void * data)
+{
+   vidsoft_band_job_struct * job = (vidsoft_band_job_struct *)data;
+
+   if (job->layer_func == NULL)
+      VidsoftDrawSprite(&vidsoft_thread_context.regs, sprite_window_mask, vdp1frontframebuffer, vidsoft_thread_context.ram, Vdp1Regs, vidsoft_thread_context.lines, vidsoft_thread_context.color_ram, &job->band);
+   else
+      job->layer_func(vidsoft_thread_context.lines, &vidsoft_thread_context.regs, vidsoft_thread_context.ram, vidsoft_thread_context.color_ram, vidsoft_thread_context.cell_scroll_data, &job->band);
+}
 
 //////////////////////////////////////////////////////////////////////////////
 
 void VIDSoftSetNumLayerThreads(int num)
 {
+   // The copy in vidsoft_thread_context may be stale by now
+   if (num > 0 && vidsoft_num_layer_threads == 0)
+      Vdp2RamMarkAllDirty();
+
+   if (num > 0)
+      YabThreadPoolStart(num);
    vidsoft_num_layer_threads = num;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-void VidsoftVdp1Thread(void* data)
+void VIDSoftSetScrollKernels(int enable)
+{
+   vidsoft_scroll_kernels = enable;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void VIDSoftSetSkipUnchanged(int enable)
+{
+   vidsoft_frame_check.enabled = enable;
+   vidsoft_frame_check.valid = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 VIDSoftGetSkippedFrames(void)
 {
-   for (;;)
+   return vidsoft_frame_check.skipped_frames;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 VidsoftCopyDirtyVdp2Ram(void)
+{
+   u32 copied = 0;
+   int i;
+
+   for (i = 0; i < VDP2_RAM_PAGES / 32; i++)
    {
-      if (vidsoft_vdp1_thread_context.need_draw)
+      u32 dirty = Vdp2RamDirty[i];
+      Vdp2RamDirty[i] = 0;
+
+      // Copy each run of dirty pages with a single memcpy
+      while (dirty)
       {
-         vidsoft_vdp1_thread_context.need_draw = 0;
-         Vdp1DrawCommands(vidsoft_vdp1_thread_context.ram, &vidsoft_vdp1_thread_context.regs, vidsoft_vdp1_thread_context.back_framebuffer);
-         memcpy(vdp1backframebuffer, vidsoft_vdp1_thread_context.back_framebuffer, 0x40000);
-         vidsoft_vdp1_thread_context.draw_finished = 1;
-      }
+         int first = 0, count = 0;
+         u32 offset, size;
+
+         while (!(dirty & (1U << first)))
+            first++;
+         while (first + count < 32 && (dirty & (1U << (first + count))))
+         {
+            dirty &= ~(1U << (first + count));
+            count++;
+         }
 
-      YabThreadSleep();
+         offset = ((i << 5) + first) << VDP2_RAM_PAGE_SHIFT;
+         size = count << VDP2_RAM_PAGE_SHIFT;
+         memcpy(vidsoft_thread_context.ram + offset, Vdp2Ram + offset, size);
+         copied += size;
+      }
    }
+
+   return copied;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void VIDSoftGetSnapshotStats(u32 * ram_bytes, u32 * total_bytes)
+{
+   if (ram_bytes)
+      *ram_bytes = vidsoft_snapshot_ram_bytes;
+   if (total_bytes)
+      *total_bytes = vidsoft_snapshot_total_bytes;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void VidsoftVdp1Job(UNUSED void * data)
+{
+   VidsoftVdp1DrawBands();
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
 void VidsoftWaitForVdp1Thread()
 {
-   if (vidsoft_vdp1_thread_enabled)
+   // The counter is gone while another video core is active
+   if (vidsoft_vdp1_thread_enabled && vidsoft_vdp1_thread_context.done != NULL)
    {
-      while (!vidsoft_vdp1_thread_context.draw_finished){}
+      YabThreadCounterWait(vidsoft_vdp1_thread_context.done);
    }
 }
 
@@ -2136,33 +2877,44 @@ void VidsoftWaitForVdp1Thread()
 
 void VIDSoftSetVdp1ThreadEnable(int b)
 {
+   // A draw still going on owns the back framebuffer
+   VidsoftWaitForVdp1Thread();
    vidsoft_vdp1_thread_enabled = b;
+}
+
+//////////////////////////////////////////////////////////////////////////////
 
+void VIDSoftSetNumVdp1Threads(int num)
+{
+   if (num > 0)
+      YabThreadPoolStart(num);
+   vidsoft_num_vdp1_threads = num;
 }
 
-void VidsoftSpriteThread(void * data)
+//////////////////////////////////////////////////////////////////////////////
+
+void VIDSoftGetVdp1TextureStats(u32 * hits, u32 * misses)
 {
-   for (;;)
-   {
-      if (vidsoft_thread_context.need_draw[TITAN_SPRITE])
-      {
-         vidsoft_thread_context.need_draw[TITAN_SPRITE] = 0;
-         VidsoftDrawSprite(&vidsoft_thread_context.regs, sprite_window_mask, vdp1frontframebuffer, vidsoft_thread_context.ram, Vdp1Regs,vidsoft_thread_context.lines, vidsoft_thread_context.color_ram);
-         vidsoft_thread_context.draw_finished[TITAN_SPRITE] = 1;
-      }
-      YabThreadSleep();
-   }
+   if (hits)
+      *hits = vidsoft_vdp1_textures.last_hits;
+   if (misses)
+      *misses = vidsoft_vdp1_textures.last_misses;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
 int VIDSoftInit(void)
 {
-   int i;
+   // Layer, sprite, VDP1 and Titan priority jobs all run on the pool. The
+   // thread count setters start more workers if they need them.
+   if (yabsys.UseThreads)
+      YabThreadPoolStart(yabsys.NumThreads);
 
    if (TitanInit() == -1)
       return -1;
 
+   VidsoftInitMosaicTable();
+
    if ((dispbuffer = (pixel_t *)calloc(sizeof(pixel_t), 704 * 512)) == NULL)
       return -1;
 
@@ -2178,6 +2930,7 @@ int VIDSoftInit(void)
    vdp1frontframebuffer = vdp1framebuffer[1];
    rbg0width = vdp2width = 320;
    vdp2height = 224;
+   vidsoft_frame_check.valid = 0;
 
 #ifdef USE_OPENGL
    if (VideoUseGL)
@@ -2185,22 +2938,26 @@ int VIDSoftInit(void)
          return -1;
 #endif
 
-   for (i = 0; i < 6; i++)
-   {
-      vidsoft_thread_context.draw_finished[i] = 1;
-      vidsoft_thread_context.need_draw[i] = 0;
-   }
+   if ((vidsoft_thread_context.done = YabThreadCreateCounter()) == NULL)
+      return -1;
+   Vdp2RamMarkAllDirty();
+
+   // Drawing works without it, just slower
+   vidsoft_full_band.cell_cache = VidsoftCreateCellCache(4096);
+
+   if ((vidsoft_vdp1_thread_context.done = YabThreadCreateCounter()) == NULL)
+      return -1;
 
-   vidsoft_vdp1_thread_context.need_draw = 0;
-   vidsoft_vdp1_thread_context.draw_finished = 1;
-   YabThreadStart(YAB_THREAD_VIDSOFT_VDP1, VidsoftVdp1Thread, 0);
+   if ((vidsoft_vdp1_thread_context.bands_done = YabThreadCreateCounter()) == NULL)
+      return -1;
+
+   // VIDSoftDeInit turned it off, keep the thread count set before that
+   vidsoft_vdp1_thread_enabled = vidsoft_num_vdp1_threads > 1;
 
-   YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_RBG0, VidsoftRbg0Thread, 0);
-   YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_NBG0, VidsoftNbg0Thread, 0);
-   YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_NBG1, VidsoftNbg1Thread, 0);
-   YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_NBG2, VidsoftNbg2Thread, 0);
-   YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_NBG3, VidsoftNbg3Thread, 0);
-   YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_SPRITE, VidsoftSpriteThread, 0);
+   // Sprites are read from VDP1 ram as they are drawn without it
+   memset(vidsoft_vdp1_textures.entries, 0, sizeof(vidsoft_vdp1_textures.entries));
+   vidsoft_vdp1_textures.arena = (u32 *)malloc(VIDSOFT_VDP1_TEXEL_ARENA * sizeof(u32));
+   vidsoft_vdp1_textures.used = 0;
 
    return 0;
 }
@@ -2329,6 +3086,43 @@ int VIDSoftSetupGL(void)
 
 void VIDSoftDeInit(void)
 {
+   int i;
+
+   // Don't free anything a job may still be using
+   if (vidsoft_vdp1_thread_context.done)
+   {
+      YabThreadCounterWait(vidsoft_vdp1_thread_context.done);
+      YabThreadFreeCounter(vidsoft_vdp1_thread_context.done);
+      vidsoft_vdp1_thread_context.done = NULL;
+   }
+   vidsoft_vdp1_thread_enabled = 0;
+
+   if (vidsoft_vdp1_thread_context.bands_done)
+   {
+      YabThreadFreeCounter(vidsoft_vdp1_thread_context.bands_done);
+      vidsoft_vdp1_thread_context.bands_done = NULL;
+   }
+
+   free(vidsoft_vdp1_textures.arena);
+   vidsoft_vdp1_textures.arena = NULL;
+
+   if (vidsoft_thread_context.done)
+   {
+      YabThreadCounterWait(vidsoft_thread_context.done);
+      YabThreadFreeCounter(vidsoft_thread_context.done);
+      vidsoft_thread_context.done = NULL;
+   }
+
+   VidsoftFreeCellCache(vidsoft_full_band.cell_cache);
+   vidsoft_full_band.cell_cache = NULL;
+   for (i = 0; i < 6 * VIDSOFT_MAX_BANDS; i++)
+   {
+      VidsoftFreeCellCache(vidsoft_band_jobs[i].band.cell_cache);
+      vidsoft_band_jobs[i].band.cell_cache = NULL;
+   }
+
+   TitanDeInit();
+
    if (dispbuffer)
    {
       free(dispbuffer);
@@ -2393,6 +3187,8 @@ int VIDSoftVdp1Reset(void)
 
 void VIDSoftVdp1DrawStartBody(Vdp1* regs, u8 * back_framebuffer)
 {
+   VidsoftUpdateVdp1TextureCache();
+
    if (regs->FBCR & 8)
       vdp1interlace = 2;
    else
@@ -2439,14 +3235,12 @@ void VIDSoftVdp1DrawStart()
       //take a snapshot of the vdp1 state, to be used by the thread
       memcpy(vidsoft_vdp1_thread_context.ram, Vdp1Ram, 0x80000);
       memcpy(&vidsoft_vdp1_thread_context.regs, Vdp1Regs, sizeof(Vdp1));
-      memcpy(vidsoft_vdp1_thread_context.back_framebuffer, vdp1backframebuffer, 0x40000);
+      vidsoft_vdp1_thread_context.back_framebuffer = vdp1backframebuffer;
 
       VIDSoftVdp1DrawStartBody(&vidsoft_vdp1_thread_context.regs, vidsoft_vdp1_thread_context.back_framebuffer);
 
       //start thread
-      vidsoft_vdp1_thread_context.draw_finished = 0;
-      vidsoft_vdp1_thread_context.need_draw = 1;
-      YabThreadWake(YAB_THREAD_VIDSOFT_VDP1);
+      YabThreadPoolSubmit(vidsoft_vdp1_thread_context.done, VidsoftVdp1Job, NULL);
 
       Vdp1FakeDrawCommands(Vdp1Ram, Vdp1Regs);
    }
@@ -2514,138 +3308,315 @@ typedef struct _COLOR_PARAMS
 	double r,g,b;
 } COLOR_PARAMS;
 
-COLOR_PARAMS leftColumnColor;
+typedef union _COLOR { // xbgr x555
+	struct {
+#ifdef WORDS_BIGENDIAN
+	u16 x:1;
+	u16 b:5;
+	u16 g:5;
+	u16 r:5;
+#else
+     u16 r:5;
+     u16 g:5;
+     u16 b:5;
+     u16 x:1;
+#endif
+	};
+	u16 value;
+} COLOR;
+
+// Everything the VDP1 drawing functions change as they go. Each band
+// thread has its own copy and replays every command, so whatever one
+// command leaves behind for the next comes out the same in every band
+typedef struct
+{
+   COLOR_PARAMS leftColumnColor;
+   int currentPixel;
+   int currentPixelIsVisible;
+   int characterWidth;
+   int characterHeight;
+   COLOR gouraudA;
+   COLOR gouraudB;
+   COLOR gouraudC;
+   COLOR gouraudD;
+   int xleft[1000];
+   int yleft[1000];
+   int xright[1000];
+   int yright[1000];
+   // Framebuffer lines [bandstart, bandend) the state may draw to
+   int bandstart;
+   int bandend;
+   // Decoded texture of the command being drawn, if it's in the cache
+   const vidsoft_vdp1_texture_struct * texture;
+   // How horizontal lines of the command being drawn are written, one of
+   // VIDSOFT_SPAN_*
+   int spankernel;
+} vidsoft_vdp1_state_struct;
+
+static vidsoft_vdp1_state_struct vidsoft_vdp1_state = { { 0, 0, 0 }, 0, 0, 0, 0, { { 0 } }, { { 0 } }, { { 0 } }, { { 0 } }, { 0 }, { 0 }, { 0 }, { 0 }, INT_MIN, INT_MAX, NULL, 0 };
+
+// What DrawLine needs to know about the command and the texture line it
+// draws, worked out once per line instead of for every dot
+typedef struct
+{
+   vidsoft_vdp1_state_struct * state;
+   const u32 * texels; // the row in the texture cache, NULL to read ram
+   u32 rowaddr;
+   u16 colorbank;
+   u32 colorlut;
+   int colormode;
+   int textured;
+   int endcodes;
+   int spd;
+   int hflip;
+   int visible;
+   // texture x is i * width / length, stepped with a remainder; where that
+   // lands exactly on a texel boundary the double product i * (width /
+   // length) decides, as it can round either way there
+   int index;
+   int whole;
+   int frac;
+   int remainder;
+   int length;
+   int i;
+   double texturestep;
+   int gouraud;
+   double xredstep;
+   double xgreenstep;
+   double xbluestep;
+   int endcodesdetected;
+   int previousStep;
+   // the line crosses the edge of the band and has no end codes to look
+   // for, dots outside the band can be stepped over
+   int skipoutside;
+} vidsoft_vdp1_line_struct;
+
+static INLINE u32 Vdp1TextureRowAddress(u32 characterAddress, int linenumber, int width, int colormode) {
+
+   switch (colormode)
+   {
+      case 0x0:
+      case 0x1:
+         return characterAddress + (linenumber*(width >> 1));
+      case 0x5:
+      case 0x6:
+         return characterAddress + (linenumber*width * 2);
+      default:
+         return characterAddress + (linenumber*width);
+   }
+}
 
+static void Vdp1SetupLineFormat(vidsoft_vdp1_line_struct * line, vdp1cmd_struct *cmd) {
 
+   int currentShape = cmd->CMDCTRL & 0x7;
+   static const int visible[8] = { 0xf, 0xffff, 0x3f, 0x7f, 0xff, 0xffff, 0xffff, -1 };
 
-int currentPixel;
-int currentPixelIsVisible;
-int characterWidth;
-int characterHeight;
+   line->colorbank = cmd->CMDCOLR;
+   line->colorlut = (u32)line->colorbank << 3;
+   line->colormode = (cmd->CMDPMOD >> 3) & 0x7;
+   line->spd = ((cmd->CMDPMOD & 0x40) != 0);//show the actual color of transparent pixels if 1 (they won't be drawn transparent)
+   line->hflip = (cmd->CMDCTRL >> 4) & 1;
+   line->visible = visible[line->colormode];
 
-static int getpixel(int linenumber, int currentlineindex, vdp1cmd_struct *cmd, u8 * ram) {
+   //4 polygon, 5 polyline or 6 line
+   line->textured = !(currentShape == 4 || currentShape == 5 || currentShape == 6);
+   line->endcodes = line->textured && ((cmd->CMDPMOD & 0x80) == 0);
+}
 
-	u32 characterAddress;
-	u32 colorlut;
-	u16 colorbank;
-	u8 SPD;
-	int endcode;
-	int endcodesEnabled;
-	int untexturedColor = 0;
-	int isTextured = 1;
-	int currentShape = cmd->CMDCTRL & 0x7;
-	int flip;
+static void Vdp1SetupLineTexture(vidsoft_vdp1_line_struct * line, int linenumber, vdp1cmd_struct *cmd) {
 
-   characterAddress = cmd->CMDSRCA << 3;
-   colorbank = cmd->CMDCOLR;
-	colorlut = (u32)colorbank << 3;
-   SPD = ((cmd->CMDPMOD & 0x40) != 0);//show the actual color of transparent pixels if 1 (they won't be drawn transparent)
-   endcodesEnabled = ((cmd->CMDPMOD & 0x80) == 0) ? 1 : 0;
-   flip = (cmd->CMDCTRL & 0x30) >> 4;
+   vidsoft_vdp1_state_struct * state = line->state;
+   const vidsoft_vdp1_texture_struct * texture = state->texture;
 
-	//4 polygon, 5 polyline or 6 line
-	if(currentShape == 4 || currentShape == 5 || currentShape == 6) {
-		isTextured = 0;
-      untexturedColor = cmd->CMDCOLR;
-	}
+   Vdp1SetupLineFormat(line, cmd);
 
-	switch( flip ) {
-		case 1:
-			// Horizontal flipping
-			currentlineindex = characterWidth - currentlineindex-1;
-			break;
-		case 2:
-			// Vertical flipping
-			linenumber = characterHeight - linenumber-1;
+   // Vertical flipping
+   if (cmd->CMDCTRL & 0x20)
+      linenumber = state->characterHeight - linenumber - 1;
 
-			break;
-		case 3:
-			// Horizontal/Vertical flipping
-			linenumber = characterHeight - linenumber-1;
-			currentlineindex = characterWidth - currentlineindex-1;
-			break;
-	}
+   line->rowaddr = Vdp1TextureRowAddress(cmd->CMDSRCA << 3, linenumber, state->characterWidth, line->colormode);
 
-   switch ((cmd->CMDPMOD >> 3) & 0x7)
-	{
-		case 0x0: //4bpp bank
-			endcode = 0xf;
-			currentPixel = Vdp1ReadPattern16( characterAddress + (linenumber*(characterWidth>>1)), currentlineindex , ram);
-			if(isTextured && endcodesEnabled && currentPixel == endcode)
-				return 1;
-			if (!((currentPixel == 0) && !SPD)) 
-				currentPixel = (colorbank &0xfff0)| currentPixel;
-			currentPixelIsVisible = 0xf;
-			break;
+   if (texture)
+   {
+      line->texels = texture->texels + linenumber * texture->width;
+      // rows without an end code can't end the line early
+      line->endcodes = line->endcodes && texture->rowendcodes[linenumber];
+   }
+   else
+      line->texels = NULL;
+}
 
-		case 0x1://4bpp lut
-			endcode = 0xf;
-         currentPixel = Vdp1ReadPattern16(characterAddress + (linenumber*(characterWidth >> 1)), currentlineindex, ram);
-			if(isTextured && endcodesEnabled && currentPixel == endcode)
-				return 1;
-			if (!(currentPixel == 0 && !SPD))
-				currentPixel = T1ReadWord(ram, (currentPixel * 2 + colorlut) & 0x7FFFF);
-			currentPixelIsVisible = 0xffff;
-			break;
-		case 0x2://8pp bank (64 color)
-			//is there a hardware bug with endcodes in this color mode?
-			//there are white lines around some characters in scud
-			//using an endcode of 63 eliminates the white lines
-			//but also causes some dropout due to endcodes being triggered that aren't triggered on hardware
-			//the closest thing i can do to match the hardware is make all pixels with color index 63 transparent
-			//this needs more hardware testing
-
-			endcode = 63;
-         currentPixel = Vdp1ReadPattern64(characterAddress + (linenumber*(characterWidth)), currentlineindex, ram);
-			if(isTextured && endcodesEnabled && currentPixel == endcode)
-				currentPixel = 0;
-		//		return 1;
-			if (!((currentPixel == 0) && !SPD)) 
-				currentPixel = (colorbank&0xffc0) | currentPixel;
-			currentPixelIsVisible = 0x3f;
-			break;
-		case 0x3://128 color
-			endcode = 0xff;
-         currentPixel = Vdp1ReadPattern128(characterAddress + (linenumber*characterWidth), currentlineindex, ram);
-			if(isTextured && endcodesEnabled && currentPixel == endcode)
-				return 1;
-			if (!((currentPixel == 0) && !SPD)) 
-				currentPixel = (colorbank&0xff80) | currentPixel;//dead or alive needs colorbank to be masked
-			currentPixelIsVisible = 0x7f;
-			break;
-		case 0x4://256 color
-			endcode = 0xff;
-         currentPixel = Vdp1ReadPattern256(characterAddress + (linenumber*characterWidth), currentlineindex, ram);
-			if(isTextured && endcodesEnabled && currentPixel == endcode)
-				return 1;
-			currentPixelIsVisible = 0xff;
-			if (!((currentPixel == 0) && !SPD)) 
-				currentPixel = (colorbank&0xff00) | currentPixel;
-			break;
-		case 0x5://16bpp bank
-		case 0x6://prohibited, used by (at least) Beach de Reach and seems to behave like 0x5
-			endcode = 0x7fff;
-         currentPixel = Vdp1ReadPattern64k(characterAddress + (linenumber*characterWidth * 2), currentlineindex, ram);
-			if(isTextured && endcodesEnabled && currentPixel == endcode)
-				return 1;
-
-			/* the transparent pixel in 16bpp is supposed to be 0x0000
-			but some games use pixels with invalid values and expect
-			them to be transparent (see vdp1 doc p. 92) */
-			if (!(currentPixel & 0x8000) && !SPD)
-				currentPixel = 0;
-
-			currentPixelIsVisible = 0xffff;
-			break;
-	}
+// Reads a dot of the texture row into pixel, returns 1 for an end code. The
+// prohibited mode 7 leaves pixel as it was
+static INLINE int Vdp1DecodeTexel(const vidsoft_vdp1_line_struct * line, int currentlineindex, u8 * ram, int * pixel) {
+
+   switch (line->colormode)
+   {
+      case 0x0: //4bpp bank
+         *pixel = Vdp1ReadPattern16(line->rowaddr, currentlineindex, ram);
+         if (line->endcodes && *pixel == 0xf)
+            return 1;
+         if (!((*pixel == 0) && !line->spd))
+            *pixel = (line->colorbank & 0xfff0) | *pixel;
+         break;
+      case 0x1://4bpp lut
+         *pixel = Vdp1ReadPattern16(line->rowaddr, currentlineindex, ram);
+         if (line->endcodes && *pixel == 0xf)
+            return 1;
+         if (!(*pixel == 0 && !line->spd))
+            *pixel = T1ReadWord(ram, (*pixel * 2 + line->colorlut) & 0x7FFFF);
+         break;
+      case 0x2://8pp bank (64 color)
+         //is there a hardware bug with endcodes in this color mode?
+         //there are white lines around some characters in scud
+         //using an endcode of 63 eliminates the white lines
+         //but also causes some dropout due to endcodes being triggered that aren't triggered on hardware
+         //the closest thing i can do to match the hardware is make all pixels with color index 63 transparent
+         //this needs more hardware testing
+         *pixel = Vdp1ReadPattern64(line->rowaddr, currentlineindex, ram);
+         if (line->endcodes && *pixel == 63)
+            *pixel = 0;
+         if (!((*pixel == 0) && !line->spd))
+            *pixel = (line->colorbank & 0xffc0) | *pixel;
+         break;
+      case 0x3://128 color
+         *pixel = Vdp1ReadPattern128(line->rowaddr, currentlineindex, ram);
+         if (line->endcodes && *pixel == 0xff)
+            return 1;
+         if (!((*pixel == 0) && !line->spd))
+            *pixel = (line->colorbank & 0xff80) | *pixel;//dead or alive needs colorbank to be masked
+         break;
+      case 0x4://256 color
+         *pixel = Vdp1ReadPattern256(line->rowaddr, currentlineindex, ram);
+         if (line->endcodes && *pixel == 0xff)
+            return 1;
+         if (!((*pixel == 0) && !line->spd))
+            *pixel = (line->colorbank & 0xff00) | *pixel;
+         break;
+      case 0x5://16bpp bank
+      case 0x6://prohibited, used by (at least) Beach de Reach and seems to behave like 0x5
+         *pixel = Vdp1ReadPattern64k(line->rowaddr, currentlineindex, ram);
+         if (line->endcodes && *pixel == 0x7fff)
+            return 1;
+
+         /* the transparent pixel in 16bpp is supposed to be 0x0000
+         but some games use pixels with invalid values and expect
+         them to be transparent (see vdp1 doc p. 92) */
+         if (!(*pixel & 0x8000) && !line->spd)
+            *pixel = 0;
+         break;
+   }
+
+   return 0;
+}
 
-	if(!isTextured)
-		currentPixel = untexturedColor;
+// Sets currentPixel and currentPixelIsVisible for a dot, returns 1 for an
+// end code
+static INLINE int Vdp1ReadTexel(const vidsoft_vdp1_line_struct * line, int currentlineindex, u8 * ram) {
 
-	//force the MSB to be on if MSBON is set
-	//currentPixel |= cmd.CMDPMOD & (1 << 15);
+   vidsoft_vdp1_state_struct * state = line->state;
 
-	return 0;
+   //the prohibited mode 7 leaves both as they were
+   if (line->visible != -1)
+      state->currentPixelIsVisible = line->visible;
+
+   if (!line->textured)
+   {
+      state->currentPixel = line->colorbank;
+      return 0;
+   }
+
+   // Horizontal flipping
+   if (line->hflip)
+      currentlineindex = state->characterWidth - currentlineindex - 1;
+
+   if (line->texels)
+   {
+      u32 texel = line->texels[currentlineindex];
+
+      state->currentPixel = texel & 0xFFFF;
+      return texel >> 16;
+   }
+
+   return Vdp1DecodeTexel(line, currentlineindex, ram, &state->currentPixel);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Returns the decoded texture of the sprite command at addr, or NULL if it
+// has to be read from VDP1 ram as it is drawn
+static const vidsoft_vdp1_texture_struct * VidsoftLookupVdp1Texture(u8 * ram, u32 addr)
+{
+   static const int bytes_per_dot_x2[8] = { 1, 1, 2, 2, 2, 4, 4, 0 };
+   vidsoft_vdp1_texture_struct * texture;
+   vidsoft_vdp1_line_struct line;
+   vdp1cmd_struct cmd;
+   u32 key, size;
+   u16 colr;
+   int width, height;
+   int x, y;
+
+   if (vidsoft_vdp1_textures.arena == NULL)
+      return NULL;
+
+   Vdp1ReadCommand(&cmd, addr, ram);
+   width = ((cmd.CMDSIZE >> 8) & 0x3F) * 8;
+   height = cmd.CMDSIZE & 0xFF;
+   Vdp1SetupLineFormat(&line, &cmd);
+
+   if (!line.textured || line.colormode == 7 || width == 0 || height == 0)
+      return NULL;
+
+   // Width, height, color mode, SPD and ECD
+   key = width | (height << 9) | ((cmd.CMDPMOD & 0xF8) << 14);
+   colr = (line.colormode == 5 || line.colormode == 6) ? 0 : cmd.CMDCOLR;
+   size = width * height * bytes_per_dot_x2[line.colormode] / 2;
+   addr = cmd.CMDSRCA << 3;
+
+   texture = &vidsoft_vdp1_textures.entries[((addr >> 5) ^ (addr >> 15) ^ colr ^ (key >> 3)) & (VIDSOFT_VDP1_TEXTURES - 1)];
+   if (texture->serial && texture->addr == addr && texture->key == key && texture->colr == colr &&
+      !VidsoftVdp1TexturePagesChanged(addr, size, texture->serial) &&
+      !(line.colormode == 1 && VidsoftVdp1TexturePagesChanged(line.colorlut, 32, texture->serial)))
+   {
+      vidsoft_vdp1_textures.hits++;
+      return texture;
+   }
+
+   vidsoft_vdp1_textures.misses++;
+   texture->serial = 0;
+
+   // Texels, then one end code flag per row
+   size = width * height + (height + 3) / 4;
+   if (vidsoft_vdp1_textures.used + size > VIDSOFT_VDP1_TEXEL_ARENA)
+      return NULL;
+
+   texture->texels = vidsoft_vdp1_textures.arena + vidsoft_vdp1_textures.used;
+   texture->rowendcodes = (u8 *)(texture->texels + width * height);
+   vidsoft_vdp1_textures.used += size;
+
+   for (y = 0; y < height; y++)
+   {
+      u32 * row = texture->texels + y * width;
+
+      line.rowaddr = Vdp1TextureRowAddress(addr, y, width, line.colormode);
+      texture->rowendcodes[y] = 0;
+
+      for (x = 0; x < width; x++)
+      {
+         int pixel = 0;
+         int endcode = Vdp1DecodeTexel(&line, x, ram, &pixel);
+
+         row[x] = (pixel & 0xFFFF) | (endcode << 16);
+         texture->rowendcodes[y] |= endcode;
+      }
+   }
+
+   texture->addr = addr;
+   texture->key = key;
+   texture->colr = colr;
+   texture->width = width;
+   texture->serial = vidsoft_vdp1_textures.serial;
+   return texture;
 }
 
 static int gouraudAdjust( int color, int tableValue )
@@ -2659,7 +3630,7 @@ static int gouraudAdjust( int color, int tableValue )
 }
 
 
-static int CheckDil(int y, Vdp1 * regs)
+static INLINE int CheckDil(int y, Vdp1 * regs)
 {
    int dil = (regs->FBCR >> 2) & 1;
 
@@ -2696,7 +3667,7 @@ static INLINE int IsSystemClipped(int x, int y, Vdp1* regs)
       y <= regs->systemclipY2);
 }
 
-int IsClipped(int x, int y, Vdp1* regs, vdp1cmd_struct * cmd)
+static INLINE int IsClipped(int x, int y, Vdp1* regs, vdp1cmd_struct * cmd)
 {
    if (cmd->CMDPMOD & 0x0400)//user clipping enabled
    {
@@ -2713,9 +3684,9 @@ int IsClipped(int x, int y, Vdp1* regs, vdp1cmd_struct * cmd)
    }
 }
 
-static void putpixel8(int x, int y, Vdp1 * regs, vdp1cmd_struct *cmd, u8 * back_framebuffer) {
+static INLINE void putpixel8(int x, int y, vidsoft_vdp1_state_struct * state, Vdp1 * regs, vdp1cmd_struct *cmd, u8 * back_framebuffer) {
 
-    int y2 = y / vdp1interlace;
+    int y2 = (vdp1interlace == 2) ? y / 2 : y;
     u8 * iPix = &back_framebuffer[(y2 * vdp1width) + x];
     int mesh = cmd->CMDPMOD & 0x0100;
     int SPD = ((cmd->CMDPMOD & 0x40) != 0);//show the actual color of transparent pixels if 1 (they won't be drawn transparent)
@@ -2723,10 +3694,13 @@ static void putpixel8(int x, int y, Vdp1 * regs, vdp1cmd_struct *cmd, u8 * back_
     if (iPix >= (back_framebuffer + 0x40000))
         return;
 
+    if (y2 < state->bandstart || y2 >= state->bandend)
+        return;
+
     if (CheckDil(y, regs))
        return;
 
-    currentPixel &= 0xFF;
+    state->currentPixel &= 0xFF;
 
     if (mesh && ((x ^ y2) & 1)) {
        return;
@@ -2735,20 +3709,20 @@ static void putpixel8(int x, int y, Vdp1 * regs, vdp1cmd_struct *cmd, u8 * back_
     if (IsClipped(x, y, regs, cmd))
        return;
 
-    if ( SPD || (currentPixel & currentPixelIsVisible))
+    if ( SPD || (state->currentPixel & state->currentPixelIsVisible))
     {
         switch( cmd->CMDPMOD & 0x7 )//we want bits 0,1,2
         {
         default:
         case 0:	// replace
-            if (!((currentPixel == 0) && !SPD))
-                *(iPix) = currentPixel;
+            if (!((state->currentPixel == 0) && !SPD))
+                *(iPix) = state->currentPixel;
             break;
         }
     }
 }
 
-static void putpixel(int x, int y, Vdp1* regs, vdp1cmd_struct * cmd, u8 * back_framebuffer) {
+static INLINE void putpixel(int x, int y, vidsoft_vdp1_state_struct * state, Vdp1* regs, vdp1cmd_struct * cmd, u8 * back_framebuffer) {
 
 	u16* iPix;
 	int mesh = cmd->CMDPMOD & 0x0100;
@@ -2758,12 +3732,16 @@ static void putpixel(int x, int y, Vdp1* regs, vdp1cmd_struct * cmd, u8 * back_f
    if (CheckDil(y, regs))
       return;
 
-	y /= vdp1interlace;
+	if (vdp1interlace == 2)
+		y /= 2;
    iPix = &((u16 *)back_framebuffer)[(y * vdp1width) + x];
 
    if (iPix >= (u16*)(back_framebuffer + 0x40000))
 		return;
 
+   if (y < state->bandstart || y >= state->bandend)
+      return;
+
 	if(mesh && (x^y)&1)
 		return;
 
@@ -2772,32 +3750,32 @@ static void putpixel(int x, int y, Vdp1* regs, vdp1cmd_struct * cmd, u8 * back_f
 
 	if (cmd->CMDPMOD & (1 << 15))
 	{
-		if (currentPixel) {
+		if (state->currentPixel) {
 			*iPix |= 0x8000;
 			return;
 		}
 	}
 
-	if ( SPD || (currentPixel & currentPixelIsVisible))
+	if ( SPD || (state->currentPixel & state->currentPixelIsVisible))
 	{
 		switch( cmd->CMDPMOD & 0x7 )//we want bits 0,1,2
 		{
 		case 0:	// replace
-			if (!((currentPixel == 0) && !SPD)) 
-				*(iPix) = currentPixel;
+			if (!((state->currentPixel == 0) && !SPD)) 
+				*(iPix) = state->currentPixel;
 			break;
 		case 1: // shadow
 			if (*(iPix) & (1 << 15)) // only if MSB of framebuffer data is set
 				*(iPix) = alphablend16(*(iPix), 0, (1 << 7)) | (1 << 15);
 			break;
 		case 2: // half luminance
-			*(iPix) = ((currentPixel & ~0x8421) >> 1) | (1 << 15);
+			*(iPix) = ((state->currentPixel & ~0x8421) >> 1) | (1 << 15);
 			break;
 		case 3: // half transparent
 			if ( *(iPix) & (1 << 15) )//only if MSB of framebuffer data is set 
-				*(iPix) = alphablend16( *(iPix), currentPixel, (1 << 7) ) | (1 << 15);
+				*(iPix) = alphablend16( *(iPix), state->currentPixel, (1 << 7) ) | (1 << 15);
 			else
-				*(iPix) = currentPixel;
+				*(iPix) = state->currentPixel;
 			break;
 		case 4: //gouraud
 			#define COLOR(r,g,b)    (((r)&0x1F)|(((g)&0x1F)<<5)|(((b)&0x1F)<<10) |0x8000 )
@@ -2807,74 +3785,245 @@ static void putpixel(int x, int y, Vdp1* regs, vdp1cmd_struct * cmd, u8 * back_f
 			if(
 				(((cmd->CMDPMOD >> 3) & 0x7) != 5) &&
 				(((cmd->CMDPMOD >> 3) & 0x7) != 1) && 
-				(int)leftColumnColor.g == 16 && 
-				(int)leftColumnColor.b == 16) 
+				(int)state->leftColumnColor.g == 16 && 
+				(int)state->leftColumnColor.b == 16) 
 			{
-				int c = (int)(leftColumnColor.r-0x10);
+				int c = (int)(state->leftColumnColor.r-0x10);
 				if(c < 0) c = 0;
-				currentPixel = currentPixel+c;
-				*(iPix) = currentPixel;
+				state->currentPixel = state->currentPixel+c;
+				*(iPix) = state->currentPixel;
 				break;
 			}
 			*(iPix) = COLOR(
 				gouraudAdjust(
-				currentPixel&0x001F,
-				(int)leftColumnColor.r),
+				state->currentPixel&0x001F,
+				(int)state->leftColumnColor.r),
 
 				gouraudAdjust(
-				(currentPixel&0x03e0) >> 5,
-				(int)leftColumnColor.g),
+				(state->currentPixel&0x03e0) >> 5,
+				(int)state->leftColumnColor.g),
 
 				gouraudAdjust(
-				(currentPixel&0x7c00) >> 10,
-				(int)leftColumnColor.b)
+				(state->currentPixel&0x7c00) >> 10,
+				(int)state->leftColumnColor.b)
 				);
 			break;
 		default:
-			*(iPix) = alphablend16( COLOR((int)leftColumnColor.r,(int)leftColumnColor.g, (int)leftColumnColor.b), currentPixel, (1 << 7) ) | (1 << 15);
+			*(iPix) = alphablend16( COLOR((int)state->leftColumnColor.r,(int)state->leftColumnColor.g, (int)state->leftColumnColor.b), state->currentPixel, (1 << 7) ) | (1 << 15);
 			break;
 		}
 	}
 }
 
-static int iterateOverLine(int x1, int y1, int x2, int y2, int greedy, void *data,
-   int(*line_callback)(int x, int y, int i, void *data, Vdp1* regs, vdp1cmd_struct * cmd, u8* ram, u8* back_framebuffer), Vdp1* regs, vdp1cmd_struct * cmd, u8 * ram, u8* back_framebuffer) {
-	int i, a, ax, ay, dx, dy;
+// Horizontal lines in the common color calculation modes are written a span
+// at a time instead of through putpixel. Mesh, MSB on and user clipping's
+// outside mode are left to putpixel, as is the 8 bit framebuffer
+#define VIDSOFT_SPAN_NONE     0
+#define VIDSOFT_SPAN_REPLACE  1
+#define VIDSOFT_SPAN_SHADOW   2
+#define VIDSOFT_SPAN_HALF     3
+#define VIDSOFT_SPAN_GOURAUD  4
 
-	a = i = 0;
-	dx = x2 - x1;
-	dy = y2 - y1;
-	ax = (dx >= 0) ? 1 : -1;
-	ay = (dy >= 0) ? 1 : -1;
+// Longest line DrawLine draws
+#define VIDSOFT_MAX_SPAN 1000
 
-	//burning rangers tries to draw huge shapes
-	//this will at least let it run
-	if(abs(dx) > 999 || abs(dy) > 999)
-		return INT_MAX;
+static int Vdp1SpanKernel(u16 pmod)
+{
+   if ((pmod & 0x8100) || (pmod & 0x0600) == 0x0600 || ((pmod >> 3) & 0x7) == 0x7)
+      return VIDSOFT_SPAN_NONE;
 
-	if (abs(dx) > abs(dy)) {
-		if (ax != ay) dx = -dx;
+   switch (pmod & 0x7)
+   {
+      case 0:
+         return VIDSOFT_SPAN_REPLACE;
+      case 1:
+         return VIDSOFT_SPAN_SHADOW;
+      case 3:
+         return VIDSOFT_SPAN_HALF;
+      case 4:
+         return VIDSOFT_SPAN_GOURAUD;
+      default:
+         return VIDSOFT_SPAN_NONE;
+   }
+}
 
-		for (; x1 != x2; x1 += ax, i++) {
-         if (line_callback && line_callback(x1, y1, i, data, regs, cmd, ram, back_framebuffer) != 0) return i + 1;
+// What gouraudAdjust adds to a color component, clamped to what can make a
+// difference so it fits a 16 bit lane
+static INLINE s16 SpanGouraudOffset(double color)
+{
+   int offset = (int)color - 0x10;
 
-			a += dy;
-			if (abs(a) >= abs(dx)) {
-				a -= dx;
-				y1 += ay;
+   if (offset < -0x20) offset = -0x20;
+   if (offset > 0x20) offset = 0x20;
 
-				// Make sure we 'fill holes' the same as the Saturn
-				if (greedy) {
-					i ++;
-					if (ax == ay) {
-						if (line_callback &&
-                     line_callback(x1 + ax, y1 - ay, i, data, regs, cmd, ram, back_framebuffer) != 0)
-							return i + 1;
-					} else {
-						if (line_callback &&
-                     line_callback(x1, y1, i, data, regs, cmd, ram, back_framebuffer) != 0)
-							return i + 1;
-					}
+   return offset;
+}
+
+static INLINE int SpanComponent(int color, int offset)
+{
+   color += offset;
+
+   if (color < 0) color = 0;
+   if (color > 0x1f) color = 0x1f;
+
+   return color;
+}
+
+// The new framebuffer dot for one that passed the checks, same as putpixel
+static INLINE u16 SpanPixel(int kernel, u16 pixel, u16 dot, s16 r, s16 g, s16 b)
+{
+   switch (kernel)
+   {
+      case VIDSOFT_SPAN_SHADOW:
+         return ((dot >> 1) & 0x3DEF) | 0x8000;
+      case VIDSOFT_SPAN_HALF:
+         // alphablend16 at half level, both halves rounded down
+         if (dot & 0x8000)
+            return ((pixel & dot) + (((pixel ^ dot) & 0x7BDE) >> 1)) | 0x8000;
+         return pixel;
+      case VIDSOFT_SPAN_GOURAUD:
+         return SpanComponent(pixel & 0x1F, r) | (SpanComponent((pixel >> 5) & 0x1F, g) << 5) |
+            (SpanComponent((pixel >> 10) & 0x1F, b) << 10) | 0x8000;
+      default:
+         return pixel;
+   }
+}
+
+static void Vdp1DrawSpanKernel(int kernel, u16 * dst, const u16 * pixels, const u16 * mask, const s16 * r, const s16 * g, const s16 * b, int count)
+{
+   int i = 0;
+
+#if defined(__SSE2__)
+   const __m128i msb = _mm_set1_epi16((short)0x8000);
+   const __m128i component = _mm_set1_epi16(0x1F);
+   const __m128i zero = _mm_setzero_si128();
+
+   for (; i + 8 <= count; i += 8)
+   {
+      __m128i p = _mm_loadu_si128((const __m128i *)(pixels + i));
+      __m128i m = _mm_loadu_si128((const __m128i *)(mask + i));
+      __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+      __m128i dmsb = _mm_srai_epi16(d, 15);
+      __m128i c, cr, cg, cb;
+
+      switch (kernel)
+      {
+         case VIDSOFT_SPAN_SHADOW:
+            c = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(d, 1), _mm_set1_epi16(0x3DEF)), msb);
+            m = _mm_and_si128(m, dmsb);
+            break;
+         case VIDSOFT_SPAN_HALF:
+            c = _mm_add_epi16(_mm_and_si128(p, d), _mm_srli_epi16(_mm_and_si128(_mm_xor_si128(p, d), _mm_set1_epi16(0x7BDE)), 1));
+            c = _mm_or_si128(c, msb);
+            c = _mm_or_si128(_mm_and_si128(dmsb, c), _mm_andnot_si128(dmsb, p));
+            break;
+         case VIDSOFT_SPAN_GOURAUD:
+            cr = _mm_add_epi16(_mm_and_si128(p, component), _mm_loadu_si128((const __m128i *)(r + i)));
+            cg = _mm_add_epi16(_mm_and_si128(_mm_srli_epi16(p, 5), component), _mm_loadu_si128((const __m128i *)(g + i)));
+            cb = _mm_add_epi16(_mm_and_si128(_mm_srli_epi16(p, 10), component), _mm_loadu_si128((const __m128i *)(b + i)));
+            cr = _mm_min_epi16(_mm_max_epi16(cr, zero), component);
+            cg = _mm_min_epi16(_mm_max_epi16(cg, zero), component);
+            cb = _mm_min_epi16(_mm_max_epi16(cb, zero), component);
+            c = _mm_or_si128(_mm_or_si128(cr, _mm_slli_epi16(cg, 5)), _mm_or_si128(_mm_slli_epi16(cb, 10), msb));
+            break;
+         default:
+            c = p;
+            break;
+      }
+
+      _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_and_si128(m, c), _mm_andnot_si128(m, d)));
+   }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+   const uint16x8_t msb = vdupq_n_u16(0x8000);
+   const int16x8_t component = vdupq_n_s16(0x1F);
+   const int16x8_t zero = vdupq_n_s16(0);
+
+   for (; i + 8 <= count; i += 8)
+   {
+      uint16x8_t p = vld1q_u16(pixels + i);
+      uint16x8_t m = vld1q_u16(mask + i);
+      uint16x8_t d = vld1q_u16(dst + i);
+      uint16x8_t dmsb = vtstq_u16(d, msb);
+      uint16x8_t c;
+      int16x8_t cr, cg, cb;
+
+      switch (kernel)
+      {
+         case VIDSOFT_SPAN_SHADOW:
+            c = vorrq_u16(vandq_u16(vshrq_n_u16(d, 1), vdupq_n_u16(0x3DEF)), msb);
+            m = vandq_u16(m, dmsb);
+            break;
+         case VIDSOFT_SPAN_HALF:
+            c = vaddq_u16(vandq_u16(p, d), vshrq_n_u16(vandq_u16(veorq_u16(p, d), vdupq_n_u16(0x7BDE)), 1));
+            c = vbslq_u16(dmsb, vorrq_u16(c, msb), p);
+            break;
+         case VIDSOFT_SPAN_GOURAUD:
+            cr = vaddq_s16(vreinterpretq_s16_u16(vandq_u16(p, vdupq_n_u16(0x1F))), vld1q_s16(r + i));
+            cg = vaddq_s16(vreinterpretq_s16_u16(vandq_u16(vshrq_n_u16(p, 5), vdupq_n_u16(0x1F))), vld1q_s16(g + i));
+            cb = vaddq_s16(vreinterpretq_s16_u16(vandq_u16(vshrq_n_u16(p, 10), vdupq_n_u16(0x1F))), vld1q_s16(b + i));
+            cr = vminq_s16(vmaxq_s16(cr, zero), component);
+            cg = vminq_s16(vmaxq_s16(cg, zero), component);
+            cb = vminq_s16(vmaxq_s16(cb, zero), component);
+            c = vorrq_u16(vorrq_u16(vreinterpretq_u16_s16(cr), vshlq_n_u16(vreinterpretq_u16_s16(cg), 5)),
+               vorrq_u16(vshlq_n_u16(vreinterpretq_u16_s16(cb), 10), msb));
+            break;
+         default:
+            c = p;
+            break;
+      }
+
+      vst1q_u16(dst + i, vbslq_u16(m, c, d));
+   }
+#endif
+
+   for (; i < count; i++)
+   {
+      if (!mask[i])
+         continue;
+      if (kernel == VIDSOFT_SPAN_SHADOW && !(dst[i] & 0x8000))
+         continue;
+      dst[i] = SpanPixel(kernel, pixels[i], dst[i], r[i], g[i], b[i]);
+   }
+}
+
+static int iterateOverLine(int x1, int y1, int x2, int y2, int greedy, void *data,
+   int(*line_callback)(int x, int y, int i, void *data, Vdp1* regs, vdp1cmd_struct * cmd, u8* ram, u8* back_framebuffer), Vdp1* regs, vdp1cmd_struct * cmd, u8 * ram, u8* back_framebuffer) {
+	int i, a, ax, ay, dx, dy;
+
+	a = i = 0;
+	dx = x2 - x1;
+	dy = y2 - y1;
+	ax = (dx >= 0) ? 1 : -1;
+	ay = (dy >= 0) ? 1 : -1;
+
+	//burning rangers tries to draw huge shapes
+	//this will at least let it run
+	if(abs(dx) > 999 || abs(dy) > 999)
+		return INT_MAX;
+
+	if (abs(dx) > abs(dy)) {
+		if (ax != ay) dx = -dx;
+
+		for (; x1 != x2; x1 += ax, i++) {
+         if (line_callback && line_callback(x1, y1, i, data, regs, cmd, ram, back_framebuffer) != 0) return i + 1;
+
+			a += dy;
+			if (abs(a) >= abs(dx)) {
+				a -= dx;
+				y1 += ay;
+
+				// Make sure we 'fill holes' the same as the Saturn
+				if (greedy) {
+					i ++;
+					if (ax == ay) {
+						if (line_callback &&
+                     line_callback(x1 + ax, y1 - ay, i, data, regs, cmd, ram, back_framebuffer) != 0)
+							return i + 1;
+					} else {
+						if (line_callback &&
+                     line_callback(x1, y1, i, data, regs, cmd, ram, back_framebuffer) != 0)
+							return i + 1;
+					}
 				}
 			}
 		}
@@ -2919,55 +4068,268 @@ static int iterateOverLine(int x1, int y1, int x2, int y2, int greedy, void *dat
 	return i;
 }
 
-typedef struct {
-	double linenumber;
-	double texturestep;
-	double xredstep;
-	double xgreenstep;
-	double xbluestep;
-	int endcodesdetected;
-	int previousStep;
-} DrawLineData;
+// Dot count of a greedy line, same as iterateOverLine without a callback
+static INLINE int LineLength(int x1, int y1, int x2, int y2) {
+
+   int dx = abs(x2 - x1);
+   int dy = abs(y2 - y1);
 
-static int DrawLineCallback(int x, int y, int i, void *data, Vdp1* regs, vdp1cmd_struct * cmd, u8* ram, u8* back_framebuffer)
+   if (dx > 999 || dy > 999)
+      return INT_MAX;
+
+   return dx + dy + 1;
+}
+
+// Steps on to the next dot of the line and reads its texel into
+// currentPixel. Returns 1 if the dot is drawn, 0 for an end code or a dot
+// outside the band
+static INLINE int NextLineTexel(vidsoft_vdp1_line_struct * line, int y, u8* ram)
 {
-	int currentStep;
-	DrawLineData *linedata = data;
-
-	leftColumnColor.r += linedata->xredstep;
-	leftColumnColor.g += linedata->xgreenstep;
-	leftColumnColor.b += linedata->xbluestep;
-
-	currentStep = (int)i * linedata->texturestep;
-	if (getpixel(linedata->linenumber, currentStep, cmd, ram)) {
-		if (currentStep != linedata->previousStep) {
-			linedata->previousStep = currentStep;
-			linedata->endcodesdetected ++;
-		}
-	} else if (vdp1pixelsize == 2) {
-		putpixel(x, y, regs, cmd, back_framebuffer);
-	} else {
-      putpixel8(x, y, regs, cmd, back_framebuffer);
-    }
+   int currentStep = line->index;
 
-	if (linedata->endcodesdetected == 2) return -1;
+   //the colors are only read back for gouraud shading
+   if (line->gouraud)
+   {
+      line->state->leftColumnColor.r += line->xredstep;
+      line->state->leftColumnColor.g += line->xgreenstep;
+      line->state->leftColumnColor.b += line->xbluestep;
+   }
 
-	return 0;
+   if (line->remainder == 0 && line->frac != 0 && currentStep != 0)
+      currentStep = (int)(line->i * line->texturestep);
+
+   line->i++;
+   line->index += line->whole;
+   line->remainder += line->frac;
+   if (line->remainder >= line->length)
+   {
+      line->remainder -= line->length;
+      line->index++;
+   }
+
+   if (line->skipoutside)
+   {
+      int fby = (vdp1interlace == 2) ? y / 2 : y;
+
+      if (fby < line->state->bandstart || fby >= line->state->bandend)
+         return 0;
+   }
+
+   if (Vdp1ReadTexel(line, currentStep, ram)) {
+      if (currentStep != line->previousStep) {
+         line->previousStep = currentStep;
+         line->endcodesdetected++;
+      }
+      return 0;
+   }
+
+   return 1;
+}
+
+static INLINE int DrawLineDot(vidsoft_vdp1_line_struct * line, int x, int y, Vdp1* regs, vdp1cmd_struct * cmd, u8* ram, u8* back_framebuffer)
+{
+   if (NextLineTexel(line, y, ram)) {
+      if (vdp1pixelsize == 2)
+         putpixel(x, y, line->state, regs, cmd, back_framebuffer);
+      else
+         putpixel8(x, y, line->state, regs, cmd, back_framebuffer);
+   }
+
+   return line->endcodesdetected == 2;
+}
+
+// Draws a horizontal line from x1 to x2. The texels are read dot by dot the
+// same as DrawLineDot does, then the dots that pass the clipping are written
+// with the span kernel in one go. Returns the dots gone through, as DrawLine
+static int DrawSpan(vidsoft_vdp1_line_struct * line, int x1, int x2, int y, Vdp1* regs, vdp1cmd_struct * cmd, u8 * ram, u8* back_framebuffer)
+{
+   vidsoft_vdp1_state_struct * state = line->state;
+   u16 pixels[VIDSOFT_MAX_SPAN];
+   u16 mask[VIDSOFT_MAX_SPAN];
+   s16 gouraud[3][VIDSOFT_MAX_SPAN];
+   int ax = (x2 >= x1) ? 1 : -1;
+   int left = (x1 < x2) ? x1 : x2;
+   int count = abs(x2 - x1) + 1;
+   int SPD = ((cmd->CMDPMOD & 0x40) != 0);
+   int y2 = (vdp1interlace == 2) ? y / 2 : y;
+   // putpixel's gouraud shading adjusts the color index instead where green
+   // and blue are both 16
+   int adjustindex = line->gouraud && line->colormode != 1 && line->colormode != 5;
+   u16 * dst = (u16 *)back_framebuffer + y2 * vdp1width;
+   int clipleft = 0;
+   int clipright = regs->systemclipX2;
+   int first, last, i, x;
+
+   // The clipping is the same for the whole line
+   if (CheckDil(y, regs) || y < 0 || y > regs->systemclipY2)
+      clipright = -1;
+
+   if (cmd->CMDPMOD & 0x0400)
+   {
+      if (y < regs->userclipY1 || y > regs->userclipY2)
+         clipright = -1;
+      if (clipleft < regs->userclipX1)
+         clipleft = regs->userclipX1;
+      if (clipright > regs->userclipX2)
+         clipright = regs->userclipX2;
+   }
+
+   if (clipright >= 0x20000 - y2 * vdp1width)
+      clipright = 0x20000 - y2 * vdp1width - 1;
+
+   for (i = 0, x = x1; i < count; x += ax)
+   {
+      int draw = NextLineTexel(line, y, ram);
+
+      draw = draw && x >= clipleft && x <= clipright && (SPD || (state->currentPixel & state->currentPixelIsVisible));
+
+      if (draw && line->gouraud)
+      {
+         if (adjustindex && (int)state->leftColumnColor.g == 16 && (int)state->leftColumnColor.b == 16)
+         {
+            int c = (int)(state->leftColumnColor.r - 0x10);
+
+            if (c < 0) c = 0;
+            state->currentPixel = state->currentPixel + c;
+            dst[x] = state->currentPixel;
+            draw = 0;
+         }
+         else
+         {
+            gouraud[0][x - left] = SpanGouraudOffset(state->leftColumnColor.r);
+            gouraud[1][x - left] = SpanGouraudOffset(state->leftColumnColor.g);
+            gouraud[2][x - left] = SpanGouraudOffset(state->leftColumnColor.b);
+         }
+      }
+
+      pixels[x - left] = state->currentPixel;
+      mask[x - left] = draw ? 0xFFFF : 0;
+
+      i++;
+      if (line->endcodesdetected == 2)
+         break;
+   }
+
+   // The dots gone through that can have been drawn
+   first = (ax > 0) ? x1 : x1 - i + 1;
+   last = (ax > 0) ? x1 + i - 1 : x1;
+   if (first < clipleft)
+      first = clipleft;
+   if (last > clipright)
+      last = clipright;
+
+   if (first <= last)
+      Vdp1DrawSpanKernel(state->spankernel, dst + first,
+         pixels + first - left, mask + first - left,
+         gouraud[0] + first - left, gouraud[1] + first - left, gouraud[2] + first - left,
+         last - first + 1);
+
+   return i;
 }
 
-static int DrawLine(int x1, int y1, int x2, int y2, int greedy, double linenumber, double texturestep, double xredstep, double xgreenstep, double xbluestep, Vdp1* regs, vdp1cmd_struct *cmd, u8 * ram, u8* back_framebuffer)
+// Walks the line the same way as iterateOverLine, the texture x coordinate
+// goes from 0 to texturewidth over linelength dots
+static int DrawLine(int x1, int y1, int x2, int y2, int greedy, double linenumber, int texturewidth, int linelength, double xredstep, double xgreenstep, double xbluestep, vidsoft_vdp1_state_struct * state, Vdp1* regs, vdp1cmd_struct *cmd, u8 * ram, u8* back_framebuffer)
 {
-	DrawLineData data;
+   vidsoft_vdp1_line_struct line;
+   int i, a, ax, ay, dx, dy;
+   int top = y1 < y2 ? y1 : y2;
+   int bottom = y1 < y2 ? y2 : y1;
+
+   // Nothing a line leaves behind is used by the next one(color mode 7
+   // aside, which isn't split into bands), so a band can leave out the
+   // lines that don't reach it
+   if (vdp1interlace == 2)
+   {
+      top /= 2;
+      bottom /= 2;
+   }
+   if (bottom < state->bandstart || top >= state->bandend)
+      return 0;
 
-	data.linenumber = linenumber;
-	data.texturestep = texturestep;
-	data.xredstep = xredstep;
-	data.xgreenstep = xgreenstep;
-	data.xbluestep = xbluestep;
-	data.endcodesdetected = 0;
-	data.previousStep = 123456789;
+   line.state = state;
+   Vdp1SetupLineTexture(&line, (int)linenumber, cmd);
+   line.index = 0;
+   line.whole = texturewidth / linelength;
+   line.frac = texturewidth % linelength;
+   line.remainder = 0;
+   line.length = linelength;
+   line.i = 0;
+   line.texturestep = (double)texturewidth / linelength;
+   line.gouraud = (cmd->CMDPMOD & 0x4) != 0;
+   line.xredstep = xredstep;
+   line.xgreenstep = xgreenstep;
+   line.xbluestep = xbluestep;
+   line.endcodesdetected = 0;
+   line.previousStep = 123456789;
+   line.skipoutside = !line.endcodes && (top < state->bandstart || bottom >= state->bandend);
+
+   a = i = 0;
+   dx = x2 - x1;
+   dy = y2 - y1;
+   ax = (dx >= 0) ? 1 : -1;
+   ay = (dy >= 0) ? 1 : -1;
+
+   //burning rangers tries to draw huge shapes
+   //this will at least let it run
+   if (abs(dx) > 999 || abs(dy) > 999)
+      return INT_MAX;
+
+   if (dy == 0 && dx != 0 && state->spankernel != VIDSOFT_SPAN_NONE && vdp1pixelsize == 2)
+      return DrawSpan(&line, x1, x2, y1, regs, cmd, ram, back_framebuffer);
+
+   if (abs(dx) > abs(dy)) {
+      if (ax != ay) dx = -dx;
+
+      for (; x1 != x2; x1 += ax, i++) {
+         if (DrawLineDot(&line, x1, y1, regs, cmd, ram, back_framebuffer)) return i + 1;
+
+         a += dy;
+         if (abs(a) >= abs(dx)) {
+            a -= dx;
+            y1 += ay;
+
+            // Make sure we 'fill holes' the same as the Saturn
+            if (greedy) {
+               i++;
+               if (ax == ay) {
+                  if (DrawLineDot(&line, x1 + ax, y1 - ay, regs, cmd, ram, back_framebuffer))
+                     return i + 1;
+               } else {
+                  if (DrawLineDot(&line, x1, y1, regs, cmd, ram, back_framebuffer))
+                     return i + 1;
+               }
+            }
+         }
+      }
+   } else {
+      if (ax != ay) dy = -dy;
+
+      for (; y1 != y2; y1 += ay, i++) {
+         if (DrawLineDot(&line, x1, y1, regs, cmd, ram, back_framebuffer)) return i + 1;
+
+         a += dx;
+         if (abs(a) >= abs(dy)) {
+            a -= dy;
+            x1 += ax;
+
+            if (greedy) {
+               i++;
+               if (ay == ax) {
+                  if (DrawLineDot(&line, x1, y1, regs, cmd, ram, back_framebuffer))
+                     return i + 1;
+               } else {
+                  if (DrawLineDot(&line, x1 - ax, y1 + ay, regs, cmd, ram, back_framebuffer))
+                     return i + 1;
+               }
+            }
+         }
+      }
+   }
 
-   return iterateOverLine(x1, y1, x2, y2, greedy, &data, DrawLineCallback, regs, cmd, ram, back_framebuffer);
+   // If the line isn't greedy here, we end up with gaps that don't occur on the Saturn
+   DrawLineDot(&line, x2, y2, regs, cmd, ram, back_framebuffer);
+   return i + 1;
 }
 
 static INLINE double interpolate(double start, double end, int numberofsteps) {
@@ -2982,29 +4344,7 @@ static INLINE double interpolate(double start, double end, int numberofsteps) {
 	return stepvalue;
 }
 
-typedef union _COLOR { // xbgr x555
-	struct {
-#ifdef WORDS_BIGENDIAN
-	u16 x:1;
-	u16 b:5;
-	u16 g:5;
-	u16 r:5;
-#else
-     u16 r:5;
-     u16 g:5;
-     u16 b:5;
-     u16 x:1;
-#endif
-	};
-	u16 value;
-} COLOR;
-
-COLOR gouraudA;
-COLOR gouraudB;
-COLOR gouraudC;
-COLOR gouraudD;
-
-static void gouraudTable(u8* ram, Vdp1* regs, vdp1cmd_struct * cmd)
+static void gouraudTable(vidsoft_vdp1_state_struct * state, u8* ram, Vdp1* regs, vdp1cmd_struct * cmd)
 {
 	int gouraudTableAddress;
 
@@ -3012,17 +4352,12 @@ static void gouraudTable(u8* ram, Vdp1* regs, vdp1cmd_struct * cmd)
 
 	gouraudTableAddress = (((unsigned int)cmd->CMDGRDA) << 3);
 
-   gouraudA.value = T1ReadWord(ram, gouraudTableAddress);
-   gouraudB.value = T1ReadWord(ram, gouraudTableAddress + 2);
-   gouraudC.value = T1ReadWord(ram, gouraudTableAddress + 4);
-   gouraudD.value = T1ReadWord(ram, gouraudTableAddress + 6);
+   state->gouraudA.value = T1ReadWord(ram, gouraudTableAddress);
+   state->gouraudB.value = T1ReadWord(ram, gouraudTableAddress + 2);
+   state->gouraudC.value = T1ReadWord(ram, gouraudTableAddress + 4);
+   state->gouraudD.value = T1ReadWord(ram, gouraudTableAddress + 6);
 }
 
-int xleft[1000];
-int yleft[1000];
-int xright[1000];
-int yright[1000];
-
 static int
 storeLineCoords(int x, int y, int i, void *arrays, Vdp1* regs, vdp1cmd_struct * cmd, u8* ram, u8* back_framebuffer) {
 	int **intArrays = arrays;
@@ -3076,7 +4411,7 @@ int is_pre_clipped(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y, s
 //this is why endcodes are possible
 //this is also the reason why half-transparent shading causes moire patterns
 //and the reason why gouraud shading can be applied to a single line draw command
-static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y, s16 br_x, s16 br_y, u8 * ram, Vdp1* regs, vdp1cmd_struct * cmd, u8* back_framebuffer){
+static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y, s16 br_x, s16 br_y, vidsoft_vdp1_state_struct * state, u8 * ram, Vdp1* regs, vdp1cmd_struct * cmd, u8* back_framebuffer){
 
 	int totalleft;
 	int totalright;
@@ -3096,12 +4431,13 @@ static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y,
    if (is_pre_clipped(tl_x, tl_y, bl_x, bl_y, tr_x, tr_y, br_x, br_y, regs))
       return;
 
-	characterWidth = ((cmd->CMDSIZE >> 8) & 0x3F) * 8;
-   characterHeight = cmd->CMDSIZE & 0xFF;
+	state->characterWidth = ((cmd->CMDSIZE >> 8) & 0x3F) * 8;
+   state->characterHeight = cmd->CMDSIZE & 0xFF;
+   state->spankernel = Vdp1SpanKernel(cmd->CMDPMOD);
 
-	intarrays[0] = xleft; intarrays[1] = yleft;
+	intarrays[0] = state->xleft; intarrays[1] = state->yleft;
    totalleft = iterateOverLine(tl_x, tl_y, bl_x, bl_y, 0, intarrays, storeLineCoords, regs, cmd, ram, back_framebuffer);
-	intarrays[0] = xright; intarrays[1] = yright;
+	intarrays[0] = state->xright; intarrays[1] = state->yright;
    totalright = iterateOverLine(tr_x, tr_y, br_x, br_y, 0, intarrays, storeLineCoords, regs, cmd, ram, back_framebuffer);
 
 	//just for now since burning rangers will freeze up trying to draw huge shapes
@@ -3113,9 +4449,9 @@ static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y,
 
    if (cmd->CMDPMOD & (1 << 2)) {
 
-		gouraudTable(ram, regs, cmd);
+		gouraudTable(state, ram, regs, cmd);
 
-		{ colors[0] = gouraudA; colors[1] = gouraudD; colors[2] = gouraudB; colors[3] = gouraudC; }
+		{ colors[0] = state->gouraudA; colors[1] = state->gouraudD; colors[2] = state->gouraudB; colors[3] = state->gouraudC; }
 
 		topLeftToBottomLeftColorStep.r = interpolate(colors[0].r,colors[1].r,total);
 		topLeftToBottomLeftColorStep.g = interpolate(colors[0].g,colors[1].g,total);
@@ -3143,7 +4479,6 @@ static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y,
 
 		int xlinelength;
 
-		double xtexturestep;
 		double ytexturestep;
 
 		COLOR_PARAMS rightColumnColor;
@@ -3151,18 +4486,14 @@ static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y,
 		COLOR_PARAMS leftToRightStep = {0,0,0};
 
 		//get the length of the line we are about to draw
-		xlinelength = iterateOverLine(
-			xleft[(int)(i*leftLineStep)],
-			yleft[(int)(i*leftLineStep)],
-			xright[(int)(i*rightLineStep)],
-			yright[(int)(i*rightLineStep)],
-         1, NULL, NULL, regs, cmd, ram, back_framebuffer);
-
-		//so from 0 to the width of the texture / the length of the line is how far we need to step
-		xtexturestep=interpolate(0,characterWidth,xlinelength);
+		xlinelength = LineLength(
+			state->xleft[(int)(i*leftLineStep)],
+			state->yleft[(int)(i*leftLineStep)],
+			state->xright[(int)(i*rightLineStep)],
+			state->yright[(int)(i*rightLineStep)]);
 
 		//now we need to interpolate the y texture coordinate across multiple lines
-		ytexturestep=interpolate(0,characterHeight,total);
+		ytexturestep=interpolate(0,state->characterHeight,total);
 
 		//gouraud interpolation
 		if(cmd->CMDPMOD & (1 << 2)) {
@@ -3171,31 +4502,34 @@ static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y,
 			//and add the orignal color + the number of steps taken times the step value to the bottom of the shape
 			//to get the current colors to use to interpolate across the line
 
-			leftColumnColor.r = colors[0].r +(topLeftToBottomLeftColorStep.r*i);
-			leftColumnColor.g = colors[0].g +(topLeftToBottomLeftColorStep.g*i);
-			leftColumnColor.b = colors[0].b +(topLeftToBottomLeftColorStep.b*i);
+			state->leftColumnColor.r = colors[0].r +(topLeftToBottomLeftColorStep.r*i);
+			state->leftColumnColor.g = colors[0].g +(topLeftToBottomLeftColorStep.g*i);
+			state->leftColumnColor.b = colors[0].b +(topLeftToBottomLeftColorStep.b*i);
 
 			rightColumnColor.r = colors[2].r +(topRightToBottomRightColorStep.r*i);
 			rightColumnColor.g = colors[2].g +(topRightToBottomRightColorStep.g*i);
 			rightColumnColor.b = colors[2].b +(topRightToBottomRightColorStep.b*i);
 
 			//interpolate colors across to get the right step values
-			leftToRightStep.r = interpolate(leftColumnColor.r,rightColumnColor.r,xlinelength);
-			leftToRightStep.g = interpolate(leftColumnColor.g,rightColumnColor.g,xlinelength);
-			leftToRightStep.b = interpolate(leftColumnColor.b,rightColumnColor.b,xlinelength);
+			leftToRightStep.r = interpolate(state->leftColumnColor.r,rightColumnColor.r,xlinelength);
+			leftToRightStep.g = interpolate(state->leftColumnColor.g,rightColumnColor.g,xlinelength);
+			leftToRightStep.b = interpolate(state->leftColumnColor.b,rightColumnColor.b,xlinelength);
 		}
 
 		DrawLine(
-			xleft[(int)(i*leftLineStep)],
-			yleft[(int)(i*leftLineStep)],
-			xright[(int)(i*rightLineStep)],
-			yright[(int)(i*rightLineStep)],
+			state->xleft[(int)(i*leftLineStep)],
+			state->yleft[(int)(i*leftLineStep)],
+			state->xright[(int)(i*rightLineStep)],
+			state->yright[(int)(i*rightLineStep)],
 			1,
 			ytexturestep*i, 
-			xtexturestep,
+			//so from 0 to the width of the texture over the length of the line
+			state->characterWidth,
+			xlinelength,
 			leftToRightStep.r,
 			leftToRightStep.g,
 			leftToRightStep.b,
+         state,
          regs,
          cmd,
          ram, back_framebuffer
@@ -3203,7 +4537,7 @@ static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y,
 	}
 }
 
-void VIDSoftVdp1NormalSpriteDraw(u8 * ram, Vdp1 * regs, u8 * back_framebuffer) {
+static void Vdp1NormalSpriteDraw(vidsoft_vdp1_state_struct * state, u8 * ram, Vdp1 * regs, u8 * back_framebuffer) {
 
 	s16 topLeftx,topLefty,topRightx,topRighty,bottomRightx,bottomRighty,bottomLeftx,bottomLefty;
 	int spriteWidth;
@@ -3223,10 +4557,10 @@ void VIDSoftVdp1NormalSpriteDraw(u8 * ram, Vdp1 * regs, u8 * back_framebuffer) {
 	bottomLeftx = topLeftx;
 	bottomLefty = topLefty + (spriteHeight - 1);
 
-   drawQuad(topLeftx, topLefty, bottomLeftx, bottomLefty, topRightx, topRighty, bottomRightx, bottomRighty, ram, regs, &cmd, back_framebuffer);
+   drawQuad(topLeftx, topLefty, bottomLeftx, bottomLefty, topRightx, topRighty, bottomRightx, bottomRighty, state, ram, regs, &cmd, back_framebuffer);
 }
 
-void VIDSoftVdp1ScaledSpriteDraw(u8* ram, Vdp1*regs, u8 * back_framebuffer){
+static void Vdp1ScaledSpriteDraw(vidsoft_vdp1_state_struct * state, u8* ram, Vdp1*regs, u8 * back_framebuffer){
 
 	s32 topLeftx,topLefty,topRightx,topRighty,bottomRightx,bottomRighty,bottomLeftx,bottomLefty;
 	int x0,y0,x1,y1;
@@ -3321,10 +4655,10 @@ void VIDSoftVdp1ScaledSpriteDraw(u8* ram, Vdp1*regs, u8 * back_framebuffer){
 	bottomLeftx = topLeftx;
 	bottomLefty = y1+y0 - 1;
 
-   drawQuad(topLeftx, topLefty, bottomLeftx, bottomLefty, topRightx, topRighty, bottomRightx, bottomRighty, ram, regs, &cmd, back_framebuffer);
+   drawQuad(topLeftx, topLefty, bottomLeftx, bottomLefty, topRightx, topRighty, bottomRightx, bottomRighty, state, ram, regs, &cmd, back_framebuffer);
 }
 
-void VIDSoftVdp1DistortedSpriteDraw(u8* ram, Vdp1*regs, u8 * back_framebuffer) {
+static void Vdp1DistortedSpriteDraw(vidsoft_vdp1_state_struct * state, u8* ram, Vdp1*regs, u8 * back_framebuffer) {
 
 	s32 xa,ya,xb,yb,xc,yc,xd,yd;
    vdp1cmd_struct cmd;
@@ -3343,23 +4677,23 @@ void VIDSoftVdp1DistortedSpriteDraw(u8* ram, Vdp1*regs, u8 * back_framebuffer) {
     xd = (s32)(cmd.CMDXD + regs->localX);
     yd = (s32)(cmd.CMDYD + regs->localY);
 
-    drawQuad(xa, ya, xd, yd, xb, yb, xc, yc, ram, regs, &cmd, back_framebuffer);
+    drawQuad(xa, ya, xd, yd, xb, yb, xc, yc, state, ram, regs, &cmd, back_framebuffer);
 }
 
-static void gouraudLineSetup(double * redstep, double * greenstep, double * bluestep, int length, COLOR table1, COLOR table2, u8* ram, Vdp1* regs, vdp1cmd_struct * cmd, u8 * back_framebuffer) {
+static void gouraudLineSetup(double * redstep, double * greenstep, double * bluestep, int length, COLOR table1, COLOR table2, vidsoft_vdp1_state_struct * state, u8* ram, Vdp1* regs, vdp1cmd_struct * cmd, u8 * back_framebuffer) {
 
-	gouraudTable(ram ,regs, cmd);
+	gouraudTable(state, ram ,regs, cmd);
 
 	*redstep =interpolate(table1.r,table2.r,length);
 	*greenstep =interpolate(table1.g,table2.g,length);
 	*bluestep =interpolate(table1.b,table2.b,length);
 
-	leftColumnColor.r = table1.r;
-	leftColumnColor.g = table1.g;
-	leftColumnColor.b = table1.b;
+	state->leftColumnColor.r = table1.r;
+	state->leftColumnColor.g = table1.g;
+	state->leftColumnColor.b = table1.b;
 }
 
-void VIDSoftVdp1PolylineDraw(u8* ram, Vdp1*regs, u8 * back_framebuffer)
+static void Vdp1PolylineDraw(vidsoft_vdp1_state_struct * state, u8* ram, Vdp1*regs, u8 * back_framebuffer)
 {
 	int X[4];
 	int Y[4];
@@ -3377,25 +4711,26 @@ void VIDSoftVdp1PolylineDraw(u8* ram, Vdp1*regs, u8 * back_framebuffer)
 	Y[2] = (int)regs->localY + (int)((s16)T1ReadWord(ram, regs->addr + 0x16));
 	X[3] = (int)regs->localX + (int)((s16)T1ReadWord(ram, regs->addr + 0x18));
 	Y[3] = (int)regs->localY + (int)((s16)T1ReadWord(ram, regs->addr + 0x1A));
+   state->spankernel = Vdp1SpanKernel(cmd.CMDPMOD);
 
-   length = iterateOverLine(X[0], Y[0], X[1], Y[1], 1, NULL, NULL, regs, &cmd, ram, back_framebuffer);
-   gouraudLineSetup(&redstep, &greenstep, &bluestep, length, gouraudA, gouraudB, ram, regs, &cmd, back_framebuffer);
-   DrawLine(X[0], Y[0], X[1], Y[1], 0, 0, 0, redstep, greenstep, bluestep, regs, &cmd, ram, back_framebuffer);
+   length = LineLength(X[0], Y[0], X[1], Y[1]);
+   gouraudLineSetup(&redstep, &greenstep, &bluestep, length, state->gouraudA, state->gouraudB, state, ram, regs, &cmd, back_framebuffer);
+   DrawLine(X[0], Y[0], X[1], Y[1], 0, 0, 0, 1, redstep, greenstep, bluestep, state, regs, &cmd, ram, back_framebuffer);
 
-   length = iterateOverLine(X[1], Y[1], X[2], Y[2], 1, NULL, NULL, regs, &cmd, ram, back_framebuffer);
-   gouraudLineSetup(&redstep, &greenstep, &bluestep, length, gouraudB, gouraudC, ram, regs, &cmd, back_framebuffer);
-   DrawLine(X[1], Y[1], X[2], Y[2], 0, 0, 0, redstep, greenstep, bluestep, regs, &cmd, ram, back_framebuffer);
+   length = LineLength(X[1], Y[1], X[2], Y[2]);
+   gouraudLineSetup(&redstep, &greenstep, &bluestep, length, state->gouraudB, state->gouraudC, state, ram, regs, &cmd, back_framebuffer);
+   DrawLine(X[1], Y[1], X[2], Y[2], 0, 0, 0, 1, redstep, greenstep, bluestep, state, regs, &cmd, ram, back_framebuffer);
 
-   length = iterateOverLine(X[2], Y[2], X[3], Y[3], 1, NULL, NULL, regs, &cmd, ram, back_framebuffer);
-   gouraudLineSetup(&redstep, &greenstep, &bluestep, length, gouraudD, gouraudC, ram, regs, &cmd, back_framebuffer);
-   DrawLine(X[3], Y[3], X[2], Y[2], 0, 0, 0, redstep, greenstep, bluestep, regs, &cmd, ram, back_framebuffer);
+   length = LineLength(X[2], Y[2], X[3], Y[3]);
+   gouraudLineSetup(&redstep, &greenstep, &bluestep, length, state->gouraudD, state->gouraudC, state, ram, regs, &cmd, back_framebuffer);
+   DrawLine(X[3], Y[3], X[2], Y[2], 0, 0, 0, 1, redstep, greenstep, bluestep, state, regs, &cmd, ram, back_framebuffer);
 
-   length = iterateOverLine(X[3], Y[3], X[0], Y[0], 1, NULL, NULL, regs, &cmd, ram, back_framebuffer);
-   gouraudLineSetup(&redstep, &greenstep, &bluestep, length, gouraudA, gouraudD, ram, regs, &cmd, back_framebuffer);
-   DrawLine(X[0], Y[0], X[3], Y[3], 0, 0, 0, redstep, greenstep, bluestep, regs, &cmd, ram, back_framebuffer);
+   length = LineLength(X[3], Y[3], X[0], Y[0]);
+   gouraudLineSetup(&redstep, &greenstep, &bluestep, length, state->gouraudA, state->gouraudD, state, ram, regs, &cmd, back_framebuffer);
+   DrawLine(X[0], Y[0], X[3], Y[3], 0, 0, 0, 1, redstep, greenstep, bluestep, state, regs, &cmd, ram, back_framebuffer);
 }
 
-void VIDSoftVdp1LineDraw(u8* ram, Vdp1*regs, u8* back_framebuffer)
+static void Vdp1LineDraw(vidsoft_vdp1_state_struct * state, u8* ram, Vdp1*regs, u8* back_framebuffer)
 {
 	int x1, y1, x2, y2;
 	double redstep = 0, greenstep = 0, bluestep = 0;
@@ -3408,10 +4743,78 @@ void VIDSoftVdp1LineDraw(u8* ram, Vdp1*regs, u8* back_framebuffer)
 	y1 = (int)regs->localY + (int)((s16)T1ReadWord(ram, regs->addr + 0x0E));
 	x2 = (int)regs->localX + (int)((s16)T1ReadWord(ram, regs->addr + 0x10));
 	y2 = (int)regs->localY + (int)((s16)T1ReadWord(ram, regs->addr + 0x12));
+   state->spankernel = Vdp1SpanKernel(cmd.CMDPMOD);
+
+   length = LineLength(x1, y1, x2, y2);
+   gouraudLineSetup(&redstep, &bluestep, &greenstep, length, state->gouraudA, state->gouraudB, state, ram, regs, &cmd, back_framebuffer);
+   DrawLine(x1, y1, x2, y2, 0, 0, 0, 1, redstep, greenstep, bluestep, state, regs, &cmd, ram, back_framebuffer);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void Vdp1DrawCommand(vidsoft_vdp1_state_struct * state, u16 command, u8 * ram, Vdp1 * regs, u8 * back_framebuffer)
+{
+   switch (command & 0x000F)
+   {
+   case 0: // normal sprite draw
+      Vdp1NormalSpriteDraw(state, ram, regs, back_framebuffer);
+      break;
+   case 1: // scaled sprite draw
+      Vdp1ScaledSpriteDraw(state, ram, regs, back_framebuffer);
+      break;
+   case 2: // distorted sprite draw
+   case 3: // invalid, drawn as a distorted sprite
+   case 4: // polygon draw
+      Vdp1DistortedSpriteDraw(state, ram, regs, back_framebuffer);
+      break;
+   case 5: // polyline draw
+   case 7: // undocumented mirror
+      Vdp1PolylineDraw(state, ram, regs, back_framebuffer);
+      break;
+   case 6: // line draw
+      Vdp1LineDraw(state, ram, regs, back_framebuffer);
+      break;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void VIDSoftVdp1NormalSpriteDraw(u8 * ram, Vdp1 * regs, u8 * back_framebuffer)
+{
+   vidsoft_vdp1_state.texture = VidsoftLookupVdp1Texture(ram, regs->addr);
+   Vdp1NormalSpriteDraw(&vidsoft_vdp1_state, ram, regs, back_framebuffer);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void VIDSoftVdp1ScaledSpriteDraw(u8 * ram, Vdp1 * regs, u8 * back_framebuffer)
+{
+   vidsoft_vdp1_state.texture = VidsoftLookupVdp1Texture(ram, regs->addr);
+   Vdp1ScaledSpriteDraw(&vidsoft_vdp1_state, ram, regs, back_framebuffer);
+}
+
+//////////////////////////////////////////////////////////////////////////////
 
-   length = iterateOverLine(x1, y1, x2, y2, 1, NULL, NULL, regs, &cmd, ram, back_framebuffer);
-   gouraudLineSetup(&redstep, &bluestep, &greenstep, length, gouraudA, gouraudB, ram, regs, &cmd, back_framebuffer);
-   DrawLine(x1, y1, x2, y2, 0, 0, 0, redstep, greenstep, bluestep, regs, &cmd, ram, back_framebuffer);
+void VIDSoftVdp1DistortedSpriteDraw(u8 * ram, Vdp1 * regs, u8 * back_framebuffer)
+{
+   vidsoft_vdp1_state.texture = VidsoftLookupVdp1Texture(ram, regs->addr);
+   Vdp1DistortedSpriteDraw(&vidsoft_vdp1_state, ram, regs, back_framebuffer);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void VIDSoftVdp1PolylineDraw(u8 * ram, Vdp1 * regs, u8 * back_framebuffer)
+{
+   vidsoft_vdp1_state.texture = NULL;
+   Vdp1PolylineDraw(&vidsoft_vdp1_state, ram, regs, back_framebuffer);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void VIDSoftVdp1LineDraw(u8 * ram, Vdp1 * regs, u8 * back_framebuffer)
+{
+   vidsoft_vdp1_state.texture = NULL;
+   Vdp1LineDraw(&vidsoft_vdp1_state, ram, regs, back_framebuffer);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -3444,6 +4847,178 @@ void VIDSoftVdp1LocalCoordinate(u8* ram, Vdp1*regs)
 
 //////////////////////////////////////////////////////////////////////////////
 
+// Follows the command list the same way as Vdp1DrawCommands, keeping each
+// drawing command with the clipping and local coordinates it is drawn with.
+// Returns 0 if a command uses the prohibited color mode 7, which takes the
+// color of the last dot drawn by the commands before it; that list has to
+// be drawn in one piece
+static int VidsoftVdp1DecodeCommands(u8 * ram, Vdp1 * regs)
+{
+   u16 command = T1ReadWord(ram, regs->addr);
+   u32 commandCounter = 0;
+   u32 returnAddr = 0xffffffff;
+   int can_split = 1;
+
+   vidsoft_vdp1_thread_context.num_commands = 0;
+
+   while (!(command & 0x8000) && commandCounter < VIDSOFT_MAX_VDP1_COMMANDS) {
+      // First, process the command
+      if (!(command & 0x4000)) { // if (!skip)
+         vidsoft_vdp1_command_struct * entry;
+         const vidsoft_vdp1_texture_struct * texture;
+
+         switch (command & 0x000F) {
+         case 0: // normal sprite draw
+         case 1: // scaled sprite draw
+         case 2: // distorted sprite draw
+         case 3: // invalid, drawn as a distorted sprite
+         case 4: // polygon draw
+         case 5: // polyline draw
+         case 6: // line draw
+         case 7: // undocumented polyline draw mirror
+            entry = &vidsoft_vdp1_thread_context.commands[vidsoft_vdp1_thread_context.num_commands++];
+            entry->command = command;
+            entry->addr = regs->addr;
+            entry->localX = regs->localX;
+            entry->localY = regs->localY;
+            entry->systemclipX2 = regs->systemclipX2;
+            entry->systemclipY2 = regs->systemclipY2;
+            entry->userclipX1 = regs->userclipX1;
+            entry->userclipY1 = regs->userclipY1;
+            entry->userclipX2 = regs->userclipX2;
+            entry->userclipY2 = regs->userclipY2;
+            // The texels are only read by the bands, nothing is added to
+            // the cache while they draw
+            texture = VidsoftLookupVdp1Texture(ram, regs->addr);
+            entry->texture.texels = NULL;
+            if (texture)
+               entry->texture = *texture;
+
+            if (((T1ReadWord(ram, regs->addr + 4) >> 3) & 0x7) == 0x7)
+               can_split = 0;
+            break;
+         case 8: // user clipping coordinates
+         case 11: // undocumented mirror
+            VIDSoftVdp1UserClipping(ram, regs);
+            break;
+         case 9: // system clipping coordinates
+            VIDSoftVdp1SystemClipping(ram, regs);
+            break;
+         case 10: // local coordinate
+            VIDSoftVdp1LocalCoordinate(ram, regs);
+            break;
+         default: // Abort
+            return can_split;
+         }
+      }
+
+      // Next, determine where to go next
+      switch ((command & 0x3000) >> 12) {
+      case 0: // NEXT, jump to following table
+         regs->addr += 0x20;
+         break;
+      case 1: // ASSIGN, jump to CMDLINK
+         regs->addr = T1ReadWord(ram, regs->addr + 2) * 8;
+         break;
+      case 2: // CALL, call a subroutine
+         if (returnAddr == 0xFFFFFFFF)
+            returnAddr = regs->addr + 0x20;
+
+         regs->addr = T1ReadWord(ram, regs->addr + 2) * 8;
+         break;
+      case 3: // RETURN, return from subroutine
+         if (returnAddr != 0xFFFFFFFF) {
+            regs->addr = returnAddr;
+            returnAddr = 0xFFFFFFFF;
+         }
+         else
+            regs->addr += 0x20;
+         break;
+      }
+
+      command = T1ReadWord(ram, regs->addr);
+      commandCounter++;
+   }
+
+   return can_split;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Draws every decoded command, only the part inside the state's band
+static void VidsoftVdp1BandJob(void * data)
+{
+   vidsoft_vdp1_state_struct * state = (vidsoft_vdp1_state_struct *)data;
+   Vdp1 regs = vidsoft_vdp1_thread_context.regs;
+   int i;
+
+   for (i = 0; i < vidsoft_vdp1_thread_context.num_commands; i++)
+   {
+      const vidsoft_vdp1_command_struct * entry = &vidsoft_vdp1_thread_context.commands[i];
+
+      regs.addr = entry->addr;
+      regs.localX = entry->localX;
+      regs.localY = entry->localY;
+      regs.systemclipX2 = entry->systemclipX2;
+      regs.systemclipY2 = entry->systemclipY2;
+      regs.userclipX1 = entry->userclipX1;
+      regs.userclipY1 = entry->userclipY1;
+      regs.userclipX2 = entry->userclipX2;
+      regs.userclipY2 = entry->userclipY2;
+      state->texture = entry->texture.texels ? &entry->texture : NULL;
+      Vdp1DrawCommand(state, entry->command, vidsoft_vdp1_thread_context.ram, &regs, vidsoft_vdp1_thread_context.back_framebuffer);
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static vidsoft_vdp1_state_struct vidsoft_vdp1_band_states[VIDSOFT_MAX_BANDS];
+
+// Draws the command list in vidsoft_vdp1_thread_context. The list is
+// decoded once, then every band of framebuffer lines replays all of it on
+// its own worker. Each line of the framebuffer is only written by one band,
+// in command order, so overlapping and half-transparent commands come out
+// the same as drawing the whole list on one thread.
+static void VidsoftVdp1DrawBands(void)
+{
+   Vdp1 regs = vidsoft_vdp1_thread_context.regs;
+   int num_bands = vidsoft_num_vdp1_threads;
+   int i;
+
+   if (num_bands > VIDSOFT_MAX_BANDS)
+      num_bands = VIDSOFT_MAX_BANDS;
+   if (num_bands > vdp1height / VIDSOFT_MIN_BAND_HEIGHT)
+      num_bands = vdp1height / VIDSOFT_MIN_BAND_HEIGHT;
+   if (!VidsoftVdp1DecodeCommands(vidsoft_vdp1_thread_context.ram, &regs))
+      num_bands = 1;
+
+   if (num_bands <= 1)
+   {
+      VidsoftVdp1BandJob(&vidsoft_vdp1_state);
+      return;
+   }
+
+   for (i = 0; i < num_bands; i++)
+   {
+      // Start from what the last frame left behind, like a single thread would
+      vidsoft_vdp1_band_states[i] = vidsoft_vdp1_state;
+      vidsoft_vdp1_band_states[i].bandstart = (i == 0) ? INT_MIN : vdp1height * i / num_bands;
+      vidsoft_vdp1_band_states[i].bandend = (i == num_bands - 1) ? INT_MAX : vdp1height * (i + 1) / num_bands;
+   }
+
+   for (i = 1; i < num_bands; i++)
+      YabThreadPoolSubmit(vidsoft_vdp1_thread_context.bands_done, VidsoftVdp1BandJob, &vidsoft_vdp1_band_states[i]);
+   VidsoftVdp1BandJob(&vidsoft_vdp1_band_states[0]);
+   YabThreadCounterWait(vidsoft_vdp1_thread_context.bands_done);
+
+   // Every band went through the same commands, any of them will do
+   vidsoft_vdp1_state = vidsoft_vdp1_band_states[0];
+   vidsoft_vdp1_state.bandstart = INT_MIN;
+   vidsoft_vdp1_state.bandend = INT_MAX;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void VIDSoftVdp1ReadFrameBuffer(u32 type, u32 addr, void * out)
 {
    u32 val;
@@ -3518,6 +5093,78 @@ int VIDSoftVdp2Reset(void)
 
 //////////////////////////////////////////////////////////////////////////////
 
+// Compares the registers, leaving out the status and counters, and keeps
+// the new ones when they differ
+static int VidsoftFrameRegsChanged(Vdp2 * saved, const Vdp2 * regs)
+{
+   Vdp2 cur;
+
+   memcpy(&cur, regs, sizeof(Vdp2));
+   cur.TVSTAT = 0;
+   cur.HCNT = 0;
+   cur.VCNT = 0;
+
+   if (memcmp(saved, &cur, sizeof(Vdp2)) == 0)
+      return 0;
+
+   memcpy(saved, &cur, sizeof(Vdp2));
+   return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int VidsoftFrameChanged(void)
+{
+   int changed = !vidsoft_frame_check.valid;
+   int i;
+
+   changed |= VidsoftFrameRegsChanged(&vidsoft_frame_check.regs, Vdp2Regs);
+   for (i = 0; i < 270; i++)
+      changed |= VidsoftFrameRegsChanged(&vidsoft_frame_check.lines[i], &Vdp2Lines[i]);
+
+   if (memcmp(vidsoft_frame_check.cell_scroll_data, cell_scroll_data, sizeof(cell_scroll_data)))
+   {
+      memcpy(vidsoft_frame_check.cell_scroll_data, cell_scroll_data, sizeof(cell_scroll_data));
+      changed = 1;
+   }
+
+   if (memcmp(vidsoft_frame_check.color_ram, Vdp2ColorRamLut, sizeof(Vdp2ColorRamLut)))
+   {
+      memcpy(vidsoft_frame_check.color_ram, Vdp2ColorRamLut, sizeof(Vdp2ColorRamLut));
+      changed = 1;
+   }
+
+   // The dirty pages are only cleared once the layers are drawn
+   for (i = 0; i < VDP2_RAM_PAGES / 32; i++)
+   {
+      if (Vdp2RamDirty[i])
+         changed = 1;
+   }
+
+   if (vidsoft_frame_check.vdp1_tvmr != Vdp1Regs->TVMR ||
+      vidsoft_frame_check.vdp1_disptoggle != Vdp1External.disptoggle ||
+      vidsoft_frame_check.vdp2_disptoggle != Vdp2External.disptoggle)
+   {
+      vidsoft_frame_check.vdp1_tvmr = Vdp1Regs->TVMR;
+      vidsoft_frame_check.vdp1_disptoggle = Vdp1External.disptoggle;
+      vidsoft_frame_check.vdp2_disptoggle = Vdp2External.disptoggle;
+      changed = 1;
+   }
+
+   // Games that redraw the same sprites every frame still swap buffers, so
+   // look at what is in the front buffer rather than which one it is
+   if (memcmp(vidsoft_frame_check.vdp1_front_framebuffer, vdp1frontframebuffer, 0x40000))
+   {
+      memcpy(vidsoft_frame_check.vdp1_front_framebuffer, vdp1frontframebuffer, 0x40000);
+      changed = 1;
+   }
+
+   vidsoft_frame_check.valid = 1;
+   return changed;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void VIDSoftVdp2DrawStart(void)
 {
    int titanblendmode = TITAN_BLEND_TOP;
@@ -3525,6 +5172,25 @@ void VIDSoftVdp2DrawStart(void)
    else if (Vdp2Regs->CCCTL & 0x200) titanblendmode = TITAN_BLEND_BOTTOM;
    TitanSetBlendingMode(titanblendmode);
 
+   vidsoft_frame_check.skip_layers = 0;
+
+   // Messages drawn into dispbuffer would pile up on a reused frame
+   if (vidsoft_frame_check.enabled && !OSDUseBuffer())
+   {
+      if (VidsoftFrameChanged())
+         vidsoft_frame_check.unchanged_frames = 0;
+      else
+         vidsoft_frame_check.unchanged_frames++;
+
+      // An interlaced frame only draws one field, the other one has to be
+      // drawn from the same state as well
+      if (vidsoft_frame_check.unchanged_frames >= (vdp2_interlace ? 2 : 1))
+      {
+         vidsoft_frame_check.skip_layers = 1;
+         return;
+      }
+   }
+
    Vdp2DrawBackScreen();
    Vdp2DrawLineScreen();
 
@@ -3547,7 +5213,7 @@ void VIDSoftVdp2DrawStart(void)
 //////////////////////////////////////////////////////////////////////////////
 
 
-void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_framebuffer, u8 * vdp2_ram, Vdp1* vdp1_regs, Vdp2* vdp2_lines, u8*color_ram)
+void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_framebuffer, u8 * vdp2_ram, Vdp1* vdp1_regs, Vdp2* vdp2_lines, u32* color_ram, vidsoft_band_struct * band)
 {
    int i, i2;
    u16 pixel;
@@ -3564,6 +5230,8 @@ void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_fr
    int start_line = 0, line_increment = 0;
    int sprite_window_enabled = vdp2_regs->SPCTL & 0x10;
    int vdp1spritetype = 0;
+   u8 window_mask[704];
+   u8 colorcalc_mask[704];
 
    if (sprite_window_enabled)
    {
@@ -3622,7 +5290,7 @@ void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_fr
 
       Vdp2GetInterlaceInfo(&start_line, &line_increment);
 
-      for (i2 = start_line; i2 < vdp2height; i2 += line_increment)
+      for (i2 = start_line; i2 < vdp2height && i2 < band->end; i2 += line_increment)
       {
          float framebuffer_readout_pos = 0;
 
@@ -3643,6 +5311,24 @@ void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_fr
             y = i2;
          }
 
+         if (i2 < band->start)
+         {
+            output_y++;
+            continue;
+         }
+
+         // The sprite window mask is built while this loop runs, so windows
+         // are only looked up ahead of time when it isn't enabled
+         if (!sprite_window_enabled)
+         {
+            if (VidsoftWindowLine(wctl, clip, i2, vdp2width, window_mask) == 0)
+            {
+               output_y++;
+               continue;
+            }
+            VidsoftWindowLine(vdp2_regs->WCTLD >> 8, colorcalcwindow, i2, vdp2width, colorcalc_mask);
+         }
+
          for (i = 0; i < vdp2width; i++)
          {
 
@@ -3651,7 +5337,7 @@ void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_fr
             // See if screen position is clipped, if it isn't, continue
             if (!(vdp2_regs->SPCTL & 0x10))
             {
-               if (!TestBothWindow(wctl, clip, i, i2))
+               if (!window_mask[i])
                {
                   continue;
                }
@@ -3699,7 +5385,7 @@ void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_fr
                {
                   // 16 BPP               
                   u8 alpha = 0x3F;
-                  if (TestBothWindow(vdp2_regs->WCTLD >> 8, colorcalcwindow, i, i2) && (vdp2_regs->CCCTL & 0x40))
+                  if ((sprite_window_enabled ? TestBothWindow(vdp2_regs->WCTLD >> 8, colorcalcwindow, i, i2) : colorcalc_mask[i]) && (vdp2_regs->CCCTL & 0x40))
                   {
                      switch (SPCCCS) {
                      case 0:
@@ -3754,7 +5440,7 @@ void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_fr
 
                   dot = Vdp2ColorRamGetColor(vdp1coloroffset + pixel,color_ram);
 
-                  if (TestBothWindow(vdp2_regs->WCTLD >> 8, colorcalcwindow, i, i2) && (vdp2_regs->CCCTL & 0x40))
+                  if ((sprite_window_enabled ? TestBothWindow(vdp2_regs->WCTLD >> 8, colorcalcwindow, i, i2) : colorcalc_mask[i]) && (vdp2_regs->CCCTL & 0x40))
                   {
                      int transparent = 0;
 
@@ -3843,7 +5529,7 @@ void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_fr
 
                   dot = Vdp2ColorRamGetColor(vdp1coloroffset + pixel, color_ram);
 
-                  if (TestBothWindow(vdp2_regs->WCTLD >> 8, colorcalcwindow, i, i2) && (vdp2_regs->CCCTL & 0x40))
+                  if ((sprite_window_enabled ? TestBothWindow(vdp2_regs->WCTLD >> 8, colorcalcwindow, i, i2) : colorcalc_mask[i]) && (vdp2_regs->CCCTL & 0x40))
                   {
                      int transparent = 0;
 
@@ -3894,18 +5580,21 @@ void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_fr
 
 void VIDSoftVdp2DrawEnd(void)
 {
-   if (vidsoft_num_layer_threads > 0)
+   if (vidsoft_num_layer_threads > 0)
+   {
+      YabThreadCounterWait(vidsoft_thread_context.done);
+   }
+
+   // The registers may have changed again since the frame started
+   if (vidsoft_frame_check.skip_layers &&
+      !VidsoftFrameRegsChanged(&vidsoft_frame_check.end_regs, Vdp2Regs))
+      vidsoft_frame_check.skipped_frames++;
+   else
    {
-      while (!vidsoft_thread_context.draw_finished[TITAN_NBG0]){}
-      while (!vidsoft_thread_context.draw_finished[TITAN_NBG1]){}
-      while (!vidsoft_thread_context.draw_finished[TITAN_NBG2]){}
-      while (!vidsoft_thread_context.draw_finished[TITAN_NBG3]){}
-      while (!vidsoft_thread_context.draw_finished[TITAN_RBG0]){}
-      while (!vidsoft_thread_context.draw_finished[TITAN_SPRITE]){}
+      TitanRender(dispbuffer);
+      VidsoftFrameRegsChanged(&vidsoft_frame_check.end_regs, Vdp2Regs);
    }
 
-   TitanRender(dispbuffer);
-
    VIDSoftVdp1SwapFrameBuffer();
 
    if (OSDUseBuffer())
@@ -3929,23 +5618,45 @@ void VIDSoftVdp2DrawEnd(void)
 
 //////////////////////////////////////////////////////////////////////////////
 
-void VidsoftStartLayerThread(int * layer_priority, int * draw_priority_0, int * num_threads_dispatched, int which_layer, void(*layer_func) (Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data))
-{
+static void VidsoftStartLayerBands(VidsoftLayerFunc layer_func, int num_bands)
+{
+   int i;
+
+   if (num_bands > VIDSOFT_MAX_BANDS)
+      num_bands = VIDSOFT_MAX_BANDS;
+   if (num_bands > vdp2height / VIDSOFT_MIN_BAND_HEIGHT)
+      num_bands = vdp2height / VIDSOFT_MIN_BAND_HEIGHT;
+   if (num_bands < 1)
+      num_bands = 1;
+
+   for (i = 0; i < num_bands; i++)
+   {
+      vidsoft_band_job_struct * job = &vidsoft_band_jobs[vidsoft_num_band_jobs++];
+
+      if (job->band.cell_cache == NULL)
+         job->band.cell_cache = VidsoftCreateCellCache(512);
+
+      job->layer_func = layer_func;
+      job->band.start = vdp2height * i / num_bands;
+      // RBG0 may have more lines than vdp2height, the last band takes them
+      job->band.end = (i == num_bands - 1) ? INT_MAX : vdp2height * (i + 1) / num_bands;
+      YabThreadPoolSubmit(vidsoft_thread_context.done, VidsoftBandJob, job);
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void VidsoftStartLayerThread(int * layer_priority, int * draw_priority_0, int which_layer, VidsoftLayerFunc layer_func)
+{
    if (layer_priority[which_layer] > 0 || draw_priority_0[which_layer])
    {
-      if (*num_threads_dispatched < vidsoft_num_layer_threads)
-      {
-         vidsoft_thread_context.need_draw[which_layer] = 1;
-         vidsoft_thread_context.draw_finished[which_layer] = 0;
-         YabThreadWake(YAB_THREAD_VIDSOFT_LAYER_NBG3 + which_layer);
-         *num_threads_dispatched = *num_threads_dispatched + 1;
-      }
+      // The bad cycle pipeline carries over from one line to the next
+      if (bad_cycle_setting[which_layer])
+         VidsoftStartLayerBands(layer_func, 1);
       else
-      {
-        (*layer_func) (Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      }
-   }
-}
+         VidsoftStartLayerBands(layer_func, vidsoft_num_layer_threads);
+   }
+}
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -3981,7 +5692,9 @@ void VIDSoftVdp2DrawScreens(void)
 {
    int draw_priority_0[6] = { 0 };
    int layer_priority[6] = { 0 };
-   int num_threads_dispatched = 0;
+
+   if (vidsoft_frame_check.skip_layers)
+      return;
 
    VIDSoftVdp2SetResolution(Vdp2Regs->TVMD);
    layer_priority[TITAN_NBG0] = Vdp2Regs->PRINA & 0x7;
@@ -3992,6 +5705,8 @@ void VIDSoftVdp2DrawScreens(void)
 
    TitanErase();
 
+   VidsoftUpdateCellCache(vidsoft_num_layer_threads == 0);
+
    if (Vdp2Regs->SFPRMD & 0x3FF)
    {
       draw_priority_0[TITAN_NBG0] = (Vdp2Regs->SFPRMD >> 0) & 0x3;
@@ -4005,39 +5720,44 @@ void VIDSoftVdp2DrawScreens(void)
    {
       memcpy(vidsoft_thread_context.lines, Vdp2Lines, sizeof(Vdp2) * 270);
       memcpy(&vidsoft_thread_context.regs, Vdp2Regs, sizeof(Vdp2));
-      memcpy(vidsoft_thread_context.ram, Vdp2Ram, 0x80000);
-      memcpy(vidsoft_thread_context.color_ram, Vdp2ColorRam, 0x1000);
+      vidsoft_snapshot_ram_bytes = VidsoftCopyDirtyVdp2Ram();
+      memcpy(vidsoft_thread_context.color_ram, Vdp2ColorRamLut, sizeof(Vdp2ColorRamLut));
       memcpy(vidsoft_thread_context.cell_scroll_data, cell_scroll_data, sizeof(struct CellScrollData) * 270);
+      vidsoft_snapshot_total_bytes = vidsoft_snapshot_ram_bytes +
+         sizeof(Vdp2) * 271 + sizeof(Vdp2ColorRamLut) + sizeof(struct CellScrollData) * 270;
    }
 
+   vidsoft_num_band_jobs = 0;
+
    //draw vdp2 sprite layer on a thread if sprite window is not enabled
    if (CanUseSpriteThread() && vidsoft_num_layer_threads > 0)
    {
-      vidsoft_thread_context.need_draw[TITAN_SPRITE] = 1;
-      vidsoft_thread_context.draw_finished[TITAN_SPRITE] = 0;
-      YabThreadWake(YAB_THREAD_VIDSOFT_LAYER_SPRITE);
-      num_threads_dispatched++;
+      // The sprite window mask is cleared and filled for the whole screen
+      if (Vdp2Regs->SPCTL & 0x10)
+         VidsoftStartLayerBands(NULL, 1);
+      else
+         VidsoftStartLayerBands(NULL, vidsoft_num_layer_threads);
    }
    else
    {
-      VidsoftDrawSprite(Vdp2Regs, sprite_window_mask, vdp1frontframebuffer, Vdp2Ram, Vdp1Regs, Vdp2Lines, Vdp2ColorRam);
+      VidsoftDrawSprite(Vdp2Regs, sprite_window_mask, vdp1frontframebuffer, Vdp2Ram, Vdp1Regs, Vdp2Lines, Vdp2ColorRamLut, &vidsoft_full_band);
    }
 
    if (vidsoft_num_layer_threads > 0)
    {
-      VidsoftStartLayerThread(layer_priority, draw_priority_0, &num_threads_dispatched, TITAN_NBG0, Vdp2DrawNBG0);
-      VidsoftStartLayerThread(layer_priority, draw_priority_0, &num_threads_dispatched, TITAN_RBG0, Vdp2DrawRBG0);
-      VidsoftStartLayerThread(layer_priority, draw_priority_0, &num_threads_dispatched, TITAN_NBG1, Vdp2DrawNBG1);
-      VidsoftStartLayerThread(layer_priority, draw_priority_0, &num_threads_dispatched, TITAN_NBG2, Vdp2DrawNBG2);
-      VidsoftStartLayerThread(layer_priority, draw_priority_0, &num_threads_dispatched, TITAN_NBG3, Vdp2DrawNBG3);
+      VidsoftStartLayerThread(layer_priority, draw_priority_0, TITAN_NBG0, Vdp2DrawNBG0);
+      VidsoftStartLayerThread(layer_priority, draw_priority_0, TITAN_RBG0, Vdp2DrawRBG0);
+      VidsoftStartLayerThread(layer_priority, draw_priority_0, TITAN_NBG1, Vdp2DrawNBG1);
+      VidsoftStartLayerThread(layer_priority, draw_priority_0, TITAN_NBG2, Vdp2DrawNBG2);
+      VidsoftStartLayerThread(layer_priority, draw_priority_0, TITAN_NBG3, Vdp2DrawNBG3);
    }
    else
    {
-      Vdp2DrawNBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      Vdp2DrawNBG1(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      Vdp2DrawNBG2(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      Vdp2DrawNBG3(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      Vdp2DrawRBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+      Vdp2DrawNBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamLut, cell_scroll_data, &vidsoft_full_band);
+      Vdp2DrawNBG1(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamLut, cell_scroll_data, &vidsoft_full_band);
+      Vdp2DrawNBG2(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamLut, cell_scroll_data, &vidsoft_full_band);
+      Vdp2DrawNBG3(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamLut, cell_scroll_data, &vidsoft_full_band);
+      Vdp2DrawRBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamLut, cell_scroll_data, &vidsoft_full_band);
    }
 }
 
@@ -4045,24 +5765,28 @@ void VIDSoftVdp2DrawScreens(void)
 
 void VIDSoftVdp2DrawScreen(int screen)
 {
+   // Leaves the layers different from what the frame check remembers
+   vidsoft_frame_check.valid = 0;
+
    VIDSoftVdp2SetResolution(Vdp2Regs->TVMD);
+   VidsoftUpdateCellCache(0);
 
    switch(screen)
    {
       case 0:
-         Vdp2DrawNBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawNBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamLut, cell_scroll_data, &vidsoft_full_band);
          break;
       case 1:
-         Vdp2DrawNBG1(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawNBG1(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamLut, cell_scroll_data, &vidsoft_full_band);
          break;
       case 2:
-         Vdp2DrawNBG2(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawNBG2(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamLut, cell_scroll_data, &vidsoft_full_band);
          break;
       case 3:
-         Vdp2DrawNBG3(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawNBG3(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamLut, cell_scroll_data, &vidsoft_full_band);
          break;
       case 4:
-         Vdp2DrawRBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawRBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamLut, cell_scroll_data, &vidsoft_full_band);
          break;
    }
 }
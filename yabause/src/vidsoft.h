@@ -38,8 +38,30 @@ void Vdp2GetInterlaceInfo(int * start_line, int * line_increment);
 
 void VIDSoftSetNumLayerThreads(int num);
 
+// Bytes copied for the layer threads on the last frame, VDP2 ram only and
+// in total
+void VIDSoftGetSnapshotStats(u32 * ram_bytes, u32 * total_bytes);
+
 void VIDSoftSetVdp1ThreadEnable(int b);
 
+// Splits the VDP1 framebuffer into bands drawn on this many threads, when
+// the VDP1 thread is enabled
+void VIDSoftSetNumVdp1Threads(int num);
+
+// Sprite texture cache lookups on the last VDP1 frame, found already
+// decoded and decoded again
+void VIDSoftGetVdp1TextureStats(u32 * hits, u32 * misses);
+
+// Enables the specialized scroll screen kernels(on by default); turning them
+// off draws everything with the generic dot loop, for benchmarking
+void VIDSoftSetScrollKernels(int enable);
+
+// Reuses the last frame when nothing it was drawn from has changed(on by
+// default). The count of frames reused that way lets a port skip presenting
+// them again
+void VIDSoftSetSkipUnchanged(int enable);
+u32 VIDSoftGetSkippedFrames(void);
+
 void VidsoftWaitForVdp1Thread();
 
 #endif
@@ -43,6 +43,7 @@
 #include "scu.h"
 #include "sh2core.h"
 #include "smpc.h"
+#include "threads.h"
 #include "vidsoft.h"
 #include "vdp2.h"
 #include "yui.h"
@@ -114,6 +115,41 @@ u32 saved_scsp_cycles = 0;//fixed point
 u32 saved_m68k_cycles = 0;//fixed point
 u32 saved_sh1_cycles = 0;
 u32 saved_cdd_cycles = 0;
+
+// Device event scheduler. Times are in SH2 cycles(fixed point) since the
+// scheduler was last reset, and are rebased at the end of every frame.
+//
+// Only the SMPC and the CD block are run when they're due instead of every
+// deciline, and the 68k and SCSP once per line. The SH2s and the SCU (DMA,
+// DSP) still run in fixed deciline slices: the SH2 cores can't stop in the
+// middle of a slice when they start an SMPC or CD block command, so a
+// longer slice would delay the command and every interrupt raised during
+// it. SCU timer 0 still counts from HBlankIN, and timer 1 isn't emulated.
+enum
+{
+   SCHED_SMPC,
+   SCHED_CDB,
+   SCHED_DECILINE,
+   SCHED_HBLANKOUT,
+   SCHED_SOUND,
+   SCHED_NUM_EVENTS
+};
+
+#define SCHED_NEVER (~(u64)0)
+
+static u64 sched_time[SCHED_NUM_EVENTS];
+static u64 sched_now;
+static u64 sched_slice_start;
+static u64 sched_line_start;
+static u64 sched_line_usec;   // microseconds at sched_line_start, fixed point
+static u64 sched_smpc_usec;   // microseconds already given to SmpcExec
+static u64 sched_cdb_usec;    // microseconds already given to Cs2Exec
+static u64 sched_due_usec[SCHED_NUM_EVENTS];
+static int sched_smpc_idle;
+static int sched_valid = 0;
+
+static void SchedulerReset(void);
+
 //////////////////////////////////////////////////////////////////////////////
 
 #ifndef NO_CLI
@@ -154,6 +190,7 @@ void YabauseChangeTiming(int freqtype) {
    yabsys.SH2CycleFrac = 0;
    yabsys.DecilineUsec = (u32) (usec_shifted * deciline_time + 0.5);
    yabsys.UsecFrac = 0;
+   SchedulerReset();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -188,6 +225,11 @@ int YabauseInit(yabauseinit_struct *init)
       return -1;
    }
 
+   // Not every core or port can run the slave on its own thread, it just
+   // runs after the master then
+   if (init->use_ssh2_thread)
+      SH2ThreadStart(init->ssh2_thread_skew);
+
    if ((BiosRom = T2MemoryInit(0x80000)) == NULL)
       return -1;
 
@@ -285,6 +327,7 @@ int YabauseInit(yabauseinit_struct *init)
    }
 
    yabsys.use_scu_dsp_jit = init->use_scu_dsp_jit;
+   yabsys.use_scheduler = init->use_scheduler;
 
    if (ScuInit() != 0)
    {
@@ -422,12 +465,14 @@ int YabauseInit(yabauseinit_struct *init)
    {
       int num = yabsys.NumThreads < 1 ? 1 : yabsys.NumThreads;
       VIDSoftSetVdp1ThreadEnable(num == 1 ? 0 : 1);
+      VIDSoftSetNumVdp1Threads(num);
       VIDSoftSetNumLayerThreads(num);
       VIDSoftSetNumPriorityThreads(num);
    }
    else
    {
       VIDSoftSetVdp1ThreadEnable(0);
+      VIDSoftSetNumVdp1Threads(0);
       VIDSoftSetNumLayerThreads(0);
       VIDSoftSetNumPriorityThreads(0);
    }
@@ -482,11 +527,13 @@ void YabauseDeInit(void) {
    Cs2DeInit();
    ScuDeInit();
    ScspDeInit();
+   // The video core can still have jobs drawing from VDP1 and VDP2 memory
+   VideoDeInit();
    Vdp1DeInit();
    Vdp2DeInit();
    SmpcDeInit();
    PerDeInit();
-   VideoDeInit();
+   YabThreadPoolStop();
    CheatDeInit();
 }
 
@@ -594,6 +641,352 @@ static INLINE u32 get_cycles_per_line_division(u32 clock, int frames, int lines,
    return ((u64)(clock / frames) << SCSP_FRACTIONAL_BITS) / (lines * divisions_per_line);
 }
 
+//////////////////////////////////////////////////////////////////////////////
+
+static void YabauseExecSH2(u32 cycles)
+{
+   if (yabsys.IsSSH2Running && SH2ThreadRunning())
+   {
+      PROFILE_START("SH2");
+      SH2ExecParallel(cycles);
+      PROFILE_STOP("SH2");
+      return;
+   }
+
+   PROFILE_START("MSH2");
+   SH2Exec(MSH2, cycles);
+   PROFILE_STOP("MSH2");
+
+   PROFILE_START("SSH2");
+   if (yabsys.IsSSH2Running)
+      SH2Exec(SSH2, cycles);
+   PROFILE_STOP("SSH2");
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int YabauseEndLine(void)
+{
+   yabsys.DecilineCount = 0;
+   yabsys.LineCount++;
+   if (yabsys.LineCount == yabsys.VBlankLineCount)
+   {
+      PROFILE_START("vblankin");
+      // VBlankIN
+      SmpcINTBACKEnd();
+      Vdp2VBlankIN();
+      PROFILE_STOP("vblankin");
+      CheatDoPatches();
+   }
+   else if (yabsys.LineCount == yabsys.MaxLineCount)
+   {
+      // VBlankOUT
+      PROFILE_START("VDP1/VDP2");
+      Vdp2VBlankOUT();
+      set_mpeg_video_irq();//guessing: set video irq once per frame
+      yabsys.LineCount = 0;
+      PROFILE_STOP("VDP1/VDP2");
+      return 1;
+   }
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void SchedulerReset(void)
+{
+   int i;
+
+   for (i = 0; i < SCHED_NUM_EVENTS; i++)
+      sched_time[i] = SCHED_NEVER;
+
+   sched_now = 0;
+   sched_slice_start = 0;
+   sched_line_start = 0;
+   sched_line_usec = 0;
+   sched_smpc_usec = 0;
+   sched_cdb_usec = 0;
+   sched_smpc_idle = 1;
+
+   // Resume at the start of the line
+   yabsys.DecilineCount = 0;
+   sched_time[SCHED_DECILINE] = yabsys.DecilineStop;
+   sched_time[SCHED_HBLANKOUT] = (u64)yabsys.DecilineStop * 10;
+   sched_time[SCHED_SOUND] = (u64)yabsys.DecilineStop * 10;
+   sched_valid = 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE u64 SchedulerGetUsec(u64 time)
+{
+   if (time < sched_line_start)
+      time = sched_line_start;
+
+   return (sched_line_usec + (time - sched_line_start) * yabsys.DecilineUsec /
+           yabsys.DecilineStop) >> YABSYS_TIMING_BITS;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void SchedulerAddDeviceEvent(int event, u64 usec)
+{
+   u64 line_end = sched_line_start + (u64)yabsys.DecilineStop * 10;
+   u64 usec_fixed = usec << YABSYS_TIMING_BITS;
+   u64 time = sched_now;
+
+   // Everything due after the end of the line is caught up by HBlankOUT
+   if (usec_fixed > sched_line_usec)
+      time = sched_line_start + ((usec_fixed - sched_line_usec) * yabsys.DecilineStop +
+                                 yabsys.DecilineUsec - 1) / yabsys.DecilineUsec;
+
+   if (time < sched_now)
+      time = sched_now;
+
+   // Wait for the end of the current slice instead of splitting it
+   time = sched_line_start + (time - sched_line_start + yabsys.DecilineStop - 1) /
+          yabsys.DecilineStop * yabsys.DecilineStop;
+
+   if (time < line_end)
+   {
+      sched_time[event] = time;
+      sched_due_usec[event] = usec;
+   }
+   else
+      sched_time[event] = SCHED_NEVER;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void SchedulerSyncDevices(u64 smpc_usec, u64 cdb_usec)
+{
+   // The times are updated first, a clock change command resets the
+   // scheduler from inside SmpcExec
+   if (smpc_usec > sched_smpc_usec)
+   {
+      s32 usec = (s32)(smpc_usec - sched_smpc_usec);
+      sched_smpc_usec = smpc_usec;
+      PROFILE_START("SMPC");
+      SmpcExec(usec);
+      PROFILE_STOP("SMPC");
+   }
+
+   if (cdb_usec > sched_cdb_usec)
+   {
+      u32 usec = (u32)(cdb_usec - sched_cdb_usec);
+      sched_cdb_usec = cdb_usec;
+      PROFILE_START("CDB");
+      Cs2Exec(usec);
+      PROFILE_STOP("CDB");
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void SchedulerUpdateDevices(void)
+{
+   s32 smpc_time = SmpcGetTimeToNextEvent();
+   u32 cdb_time = Cs2GetTimeToNextEvent();
+
+   if (smpc_time < 0)
+   {
+      sched_time[SCHED_SMPC] = SCHED_NEVER;
+      sched_smpc_idle = 1;
+   }
+   else
+   {
+      // A command that was just issued has been running since the start of
+      // the slice it was issued in
+      if (sched_smpc_idle)
+      {
+         u64 usec = SchedulerGetUsec(sched_slice_start);
+         if (usec > sched_smpc_usec)
+            sched_smpc_usec = usec;
+         sched_smpc_idle = 0;
+      }
+      SchedulerAddDeviceEvent(SCHED_SMPC, sched_smpc_usec + smpc_time);
+   }
+
+   // Always move forward, even if the cd block is already late
+   if (cdb_time == 0)
+      cdb_time = 1;
+   SchedulerAddDeviceEvent(SCHED_CDB, sched_cdb_usec + cdb_time);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void YabauseEmulateEvents(void)
+{
+   int oneframeexec = 0;
+   int i;
+#ifndef USE_SCSP2
+   int frames = yabsys.IsPal ? 50 : 60;
+   int lines = yabsys.IsPal ? 313 : 263;
+   /* 11.2896MHz / 50Hz / 313 lines = 722.00 cycles/line
+      11.2896MHz / 60Hz / 263 lines = 716.20 cycles/line */
+   const u32 m68kcycles = yabsys.IsPal ? 722 : 716;
+   const u32 m68kcenticycles = yabsys.IsPal ? 0 : 20;
+   const u32 m68k_cycles_per_line = get_cycles_per_line_division(44100 * 256, frames, lines, 1);
+   const u32 scsp_cycles_per_line = get_cycles_per_line_division(44100 * 512, frames, lines, 1);
+#endif
+
+   if (!sched_valid)
+      SchedulerReset();
+
+   while (!oneframeexec)
+   {
+      u64 next = SCHED_NEVER;
+
+      PROFILE_START("Total Emulation");
+
+      for (i = 0; i < SCHED_NUM_EVENTS; i++)
+      {
+         if (sched_time[i] < next)
+            next = sched_time[i];
+      }
+
+      // Run the processors up to the next event
+      if (next > sched_now)
+      {
+         // Since we run the SCU with half the number of cycles we send
+         // to SH2Exec(), we always compute an even number of cycles here
+         // and leave any odd remainder in SH2CycleFrac.
+         u32 sh2cycles;
+         yabsys.SH2CycleFrac += (u32)(next - sched_now);
+         sh2cycles = (yabsys.SH2CycleFrac >> (YABSYS_TIMING_BITS + 1)) << 1;
+         yabsys.SH2CycleFrac &= ((YABSYS_TIMING_MASK << 1) | 1);
+
+         if (!yabsys.playing_ssf)
+            YabauseExecSH2(sh2cycles);
+
+         PROFILE_START("SCU");
+         ScuExec(sh2cycles);
+         PROFILE_STOP("SCU");
+
+         sched_slice_start = sched_now;
+         sched_now = next;
+
+         // The processors may have started an SMPC or CD block command
+         SchedulerUpdateDevices();
+      }
+
+      if (sched_time[SCHED_SMPC] <= sched_now)
+      {
+         sched_time[SCHED_SMPC] = SCHED_NEVER;
+         SchedulerSyncDevices(sched_due_usec[SCHED_SMPC], sched_cdb_usec);
+         SchedulerUpdateDevices();
+      }
+
+      if (sched_time[SCHED_CDB] <= sched_now)
+      {
+         sched_time[SCHED_CDB] = SCHED_NEVER;
+         SchedulerSyncDevices(sched_smpc_usec, sched_due_usec[SCHED_CDB]);
+         SchedulerUpdateDevices();
+      }
+
+      if (sched_time[SCHED_DECILINE] <= sched_now)
+      {
+         yabsys.DecilineCount++;
+         if (yabsys.DecilineCount == 9)
+         {
+            // HBlankIN
+            PROFILE_START("hblankin");
+            Vdp2HBlankIN();
+            PROFILE_STOP("hblankin");
+
+            // The next stop is HBlankOUT
+            sched_time[SCHED_DECILINE] = SCHED_NEVER;
+         }
+         else
+            sched_time[SCHED_DECILINE] += yabsys.DecilineStop;
+      }
+
+      if (sched_time[SCHED_HBLANKOUT] <= sched_now)
+      {
+         u64 usec;
+
+         PROFILE_START("hblankout");
+         Vdp2HBlankOUT();
+         PROFILE_STOP("hblankout");
+
+         oneframeexec = YabauseEndLine();
+
+         // Start the next line
+         sched_line_start = sched_time[SCHED_HBLANKOUT];
+         sched_line_usec += (u64)yabsys.DecilineUsec * 10;
+         sched_time[SCHED_DECILINE] = sched_line_start + yabsys.DecilineStop;
+         sched_time[SCHED_HBLANKOUT] = sched_line_start + (u64)yabsys.DecilineStop * 10;
+
+         // Bring the devices that had nothing due during the line up to date
+         usec = sched_line_usec >> YABSYS_TIMING_BITS;
+         SchedulerSyncDevices(usec, usec);
+         SchedulerUpdateDevices();
+      }
+
+      if (sched_time[SCHED_SOUND] <= sched_now)
+      {
+         sched_time[SCHED_SOUND] += (u64)yabsys.DecilineStop * 10;
+
+#ifdef USE_SCSP2
+         PROFILE_START("SCSP");
+         ScspExec(10);
+         PROFILE_STOP("SCSP");
+#else
+         PROFILE_START("68K");
+         M68KSync();  // Wait for the previous line to finish
+         PROFILE_STOP("68K");
+
+         PROFILE_START("SCSP");
+         ScspExec();
+         PROFILE_STOP("SCSP");
+
+         if(!use_new_scsp)
+         {
+            int cycles;
+
+            PROFILE_START("68K");
+            cycles = m68kcycles;
+            saved_centicycles += m68kcenticycles;
+            if (saved_centicycles >= 100) {
+               cycles++;
+               saved_centicycles -= 100;
+            }
+            M68KExec(cycles);
+            PROFILE_STOP("68K");
+         }
+         else
+         {
+            u32 m68k_integer_part = 0, scsp_integer_part = 0;
+            saved_m68k_cycles += m68k_cycles_per_line;
+            m68k_integer_part = saved_m68k_cycles >> SCSP_FRACTIONAL_BITS;
+            M68KExec(m68k_integer_part);
+            saved_m68k_cycles -= m68k_integer_part << SCSP_FRACTIONAL_BITS;
+
+            saved_scsp_cycles += scsp_cycles_per_line;
+            scsp_integer_part = saved_scsp_cycles >> SCSP_FRACTIONAL_BITS;
+            new_scsp_exec(scsp_integer_part);
+            saved_scsp_cycles -= scsp_integer_part << SCSP_FRACTIONAL_BITS;
+         }
+#endif
+      }
+
+      PROFILE_STOP("Total Emulation");
+   }
+
+   // Rebase the timeline so it never grows past one frame
+   for (i = 0; i < SCHED_NUM_EVENTS; i++)
+   {
+      if (sched_time[i] != SCHED_NEVER)
+         sched_time[i] -= sched_line_start;
+   }
+   sched_now -= sched_line_start;
+   sched_slice_start = sched_slice_start > sched_line_start ? sched_slice_start - sched_line_start : 0;
+   sched_line_start = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 int YabauseEmulate(void) {
    int oneframeexec = 0;
 
@@ -660,10 +1053,21 @@ int YabauseEmulate(void) {
        YabauseDynarecOneFrameExec(722,0); // m68kcycles,m68kcenticycles
      else
        YabauseDynarecOneFrameExec(716,20);
+     sh2_dynarec_count_idle();
      return 0;
    }
    #endif
 
+   // The scheduler only models the deciline mode, and the CD block LLE needs
+   // its SH1 stepped alongside the SH2s
+   if (yabsys.use_scheduler && yabsys.DecilineMode && !yabsys.use_cd_block_lle)
+   {
+      YabauseEmulateEvents();
+      oneframeexec = 1;
+   }
+   else
+      sched_valid = 0;
+
    while (!oneframeexec)
    {
       PROFILE_START("Total Emulation");
@@ -679,16 +1083,7 @@ int YabauseEmulate(void) {
          yabsys.SH2CycleFrac &= ((YABSYS_TIMING_MASK << 1) | 1);
 
          if (!yabsys.playing_ssf)
-         {
-            PROFILE_START("MSH2");
-            SH2Exec(MSH2, sh2cycles);
-            PROFILE_STOP("MSH2");
-
-            PROFILE_START("SSH2");
-            if (yabsys.IsSSH2Running)
-               SH2Exec(SSH2, sh2cycles);
-            PROFILE_STOP("SSH2");
-         }
+            YabauseExecSH2(sh2cycles);
 
 #ifdef USE_SCSP2
          PROFILE_START("SCSP");
@@ -717,30 +1112,14 @@ int YabauseEmulate(void) {
          sh2cycles = (yabsys.SH2CycleFrac >> (YABSYS_TIMING_BITS + 1)) << 1;
          yabsys.SH2CycleFrac &= ((YABSYS_TIMING_MASK << 1) | 1);
          if (!yabsys.playing_ssf)
-         {
-            PROFILE_START("MSH2");
-            SH2Exec(MSH2, sh2cycles - decilinecycles);
-            PROFILE_STOP("MSH2");
-            PROFILE_START("SSH2");
-            if (yabsys.IsSSH2Running)
-               SH2Exec(SSH2, sh2cycles - decilinecycles);
-            PROFILE_STOP("SSH2");
-         }
+            YabauseExecSH2(sh2cycles - decilinecycles);
 
          PROFILE_START("hblankin");
          Vdp2HBlankIN();
          PROFILE_STOP("hblankin");
 
          if (!yabsys.playing_ssf)
-         {
-            PROFILE_START("MSH2");
-            SH2Exec(MSH2, decilinecycles);
-            PROFILE_STOP("MSH2");
-            PROFILE_START("SSH2");
-            if (yabsys.IsSSH2Running)
-               SH2Exec(SSH2, decilinecycles);
-            PROFILE_STOP("SSH2");
-         }
+            YabauseExecSH2(decilinecycles);
 
 #ifdef USE_SCSP2
          PROFILE_START("SCSP");
@@ -771,27 +1150,7 @@ int YabauseEmulate(void) {
          ScspExec();
          PROFILE_STOP("SCSP");
 #endif
-         yabsys.DecilineCount = 0;
-         yabsys.LineCount++;
-         if (yabsys.LineCount == yabsys.VBlankLineCount)
-         {
-            PROFILE_START("vblankin");
-            // VBlankIN
-            SmpcINTBACKEnd();
-            Vdp2VBlankIN();
-            PROFILE_STOP("vblankin");
-            CheatDoPatches();
-         }
-         else if (yabsys.LineCount == yabsys.MaxLineCount)
-         {
-            // VBlankOUT
-            PROFILE_START("VDP1/VDP2");
-            Vdp2VBlankOUT();
-            set_mpeg_video_irq();//guessing: set video irq once per frame
-            yabsys.LineCount = 0;
-            oneframeexec = 1;
-            PROFILE_STOP("VDP1/VDP2");
-         }
+         oneframeexec = YabauseEndLine();
       }
 
       yabsys.UsecFrac += usecinc;
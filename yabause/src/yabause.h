@@ -61,6 +61,9 @@ typedef struct
    int sh2_cache_enabled;
    int use_scsp_dsp_dynarec;
    int use_scu_dsp_jit;
+   int use_scheduler;     // run the SMPC and CD block only when they have work due, the CPUs still run every deciline
+   int use_ssh2_thread;   // run the slave SH2 on its own thread, experimental, needs USE_SSH2_THREAD
+   int ssh2_thread_skew;  // most cycles the SH2s may drift apart on threads, 0 = a whole time slice
 } yabauseinit_struct;
 
 #define CLKTYPE_26MHZ           0
@@ -119,6 +122,7 @@ typedef struct
    int sh2_cache_enabled;
    int use_scsp_dsp_jit;
    int use_scu_dsp_jit;
+   int use_scheduler;
 } yabsys_struct;
 
 extern yabsys_struct yabsys;